@@ -0,0 +1,112 @@
+#ifndef __CPU_TOPOLOGY_H__
+#define __CPU_TOPOLOGY_H__
+
+#include "common.h"
+
+/**
+ * 线程亲和性模式
+ *
+ * 决定工作线程可以被放置到哪些逻辑 CPU 上；
+ * 除 AFFINITY_NONE 外，每个工作线程都会被固定到候选集合中的单个逻辑 CPU。
+ */
+typedef enum {
+    AFFINITY_NONE = 0,      // 不绑定，由调度器自由迁移（默认）
+    AFFINITY_CORES,         // 按拓扑顺序逐个绑定到所有可用逻辑 CPU
+    AFFINITY_NUMA_NODE,     // 只使用指定 NUMA 节点上的 CPU
+    AFFINITY_CPUSET         // 只使用 cpuset 列表中的 CPU（如 "0-3,8"）
+} thread_affinity_t;
+
+/**
+ * 单个逻辑 CPU 的拓扑信息
+ */
+typedef struct {
+    int cpu;                // 逻辑 CPU 编号
+    int core_id;            // 物理核编号（在 package 内）
+    int package_id;         // 物理封装（socket）编号
+    int node_id;            // NUMA 节点编号（无法获取时为 0）
+    int smt_index;          // 在 SMT 兄弟中的序号（0 表示物理核的第一个硬件线程）
+} cpu_info_t;
+
+/**
+ * CPU 拓扑结构体
+ *
+ * 数据来源：
+ *   /sys/devices/system/cpu/online
+ *   /sys/devices/system/cpu/cpuN/topology/{core_id,physical_package_id,thread_siblings_list}
+ *   /sys/devices/system/node/nodeN/cpulist
+ *
+ * cpus 数组按 (node, package, smt_index, core) 排序：
+ * 同一节点内先铺满各物理核的第一个硬件线程，再使用 SMT 兄弟，
+ * 因此前 N 个工作线程总是落在 N 个不同的物理核上。
+ */
+typedef struct {
+    cpu_info_t *cpus;       // 在线逻辑 CPU 数组
+    int num_cpus;           // 在线逻辑 CPU 数量
+    int num_cores;          // 物理核数量
+    int num_nodes;          // NUMA 节点数量
+} cpu_topology_t;
+
+/**
+ * @name cpu_topology_detect
+ * @brief 从 sysfs 读取当前机器的 CPU 拓扑
+ *
+ * @return
+ *      successful: 拓扑结构体指针
+ *      failed: NULL
+ */
+cpu_topology_t* cpu_topology_detect(void);
+
+
+/**
+ * @name cpu_topology_free
+ * @brief 释放拓扑结构体
+ *
+ * @param topo 拓扑结构体指针
+ *
+ * @return void
+ */
+void cpu_topology_free(cpu_topology_t *topo);
+
+
+/**
+ * @name cpu_topology_parse_list
+ * @brief 解析 Linux CPU 列表格式（如 "0-3,8,10-11"）
+ *
+ * @param list  列表字符串
+ * @param cpus  输出 CPU 编号数组
+ * @param max   输出数组容量
+ *
+ * @return
+ *      successful: 解析出的 CPU 数量（超出 max 的部分被截断）
+ *      failed: -1（格式错误）
+ */
+int cpu_topology_parse_list(const char *list, int *cpus, int max);
+
+
+/**
+ * @name cpu_topology_select
+ * @brief 按亲和性策略选出候选 CPU 列表
+ *
+ * 结果与进程当前允许的 CPU 掩码（sched_getaffinity）取交集，
+ * 因此在容器或 taskset 限制下同样有效。
+ *
+ * @param topo       拓扑结构体指针
+ * @param mode       亲和性模式
+ * @param avoid_smt  是否只使用每个物理核的第一个硬件线程
+ * @param numa_node  AFFINITY_NUMA_NODE 模式下的节点编号
+ * @param cpuset     AFFINITY_CPUSET 模式下的 CPU 列表字符串
+ * @param out        输出 CPU 编号数组（按拓扑顺序）
+ * @param max        输出数组容量
+ *
+ * @return
+ *      successful: 候选 CPU 数量（>0）
+ *      failed: -1
+ */
+int cpu_topology_select(const cpu_topology_t *topo,
+                        thread_affinity_t mode,
+                        bool avoid_smt,
+                        int numa_node,
+                        const char *cpuset,
+                        int *out, int max);
+
+#endif /* __CPU_TOPOLOGY_H__ */
@@ -109,6 +109,10 @@ void gpt2_free(gpt2_model_t *model);
  * @name gpt2_load_weights
  * @brief 从文件加载 GPT-2 模型权重
  * 
+ * 文件为 float32 原始数据，按 token/position embedding、各层
+ * (ln1, Q/K/V/O 权重与偏置, ln2, FFN)、最终 LayerNorm 的顺序紧密排列；
+ * lm_head 与 token_embedding 共享权重，加载后重新生成。
+ * 
  * @param model 指向 GPT-2 模型结构体的指针
  * @param checkpoint_path 权重文件路径
  * 
@@ -123,13 +127,34 @@ int gpt2_load_weights(gpt2_model_t *model, const char *checkpoint_path);
  * @name gpt2_forward
  * @brief 前向传播
  * 
+ * 没有 KV cache，每次调用都对整个序列重新计算（pre-LN，带因果掩码）。
+ * 
  * @param model 指向 GPT-2 模型结构体的指针
- * @param input_ids 输入 token ID 张量 [batch_size, seq_len]
- * @param output    输出 logits 张量 [batch_size, seq_len, vocab_size]
+ * @param input_ids 输入 token ID 张量 [batch_size, seq_len] 或 [seq_len]（以 float 存储）
+ * @param output    输出 logits 张量，元素数为 batch_size * seq_len * vocab_size
  * 
- * @return void
+ * @return int
+ *      0 - 成功
+ *     -1 - 失败（参数非法或某一层计算失败，output 内容未定义）
  */
-void gpt2_forward(gpt2_model_t *model, const Tensor *input_ids, Tensor *output);
+int gpt2_forward(gpt2_model_t *model, const Tensor *input_ids, Tensor *output);
+
+
+/**
+ * @name gpt2_gemm_shapes
+ * @brief 列出一次前向传播中用到的 GEMM 形状（用于自动调优）
+ *
+ * 每个形状为 {M, K, N}，即 [M x K] @ [K x N]，M 为序列长度。
+ * 包括 Q/K/V/O 投影、FFN 两层与 LM head，去重后输出。
+ *
+ * @param cfg     GPT-2 配置参数
+ * @param seq_len 序列长度（prefill 为 prompt 长度，decode 为 1）
+ * @param shapes  输出形状数组
+ * @param max     输出数组容量
+ *
+ * @return 写入的形状数
+ */
+size_t gpt2_gemm_shapes(const gpt2_config_t *cfg, size_t seq_len, size_t shapes[][3], size_t max);
 
 
 /* ========== Attention API ========== */
@@ -181,13 +206,15 @@ void attention_multi_head_serial(const Tensor *X,
  * @param mask      掩码张量 [seq_len, seq_len]，可选
  * @param output    输出向量 [seq_len, d_model]
  * 
- * @return void
+ * @return int
+ *      0 - 成功
+ *     -1 - 失败（偏置形状不匹配）
  */
-void attention_multi_head_parallel(const Tensor *X,
-                                   const attention_weights_t *weights,
-                                   size_t num_heads,
-                                   const Tensor *mask,
-                                   Tensor *output);
+int attention_multi_head_parallel(const Tensor *X,
+                                  const attention_weights_t *weights,
+                                  size_t num_heads,
+                                  const Tensor *mask,
+                                  Tensor *output);
 
 /**
  * @name create_causal_mask
@@ -236,13 +263,15 @@ void gelu(Tensor *x);
 
 /**
  * @name residual_add
- * @brief  残差连接
+ * @brief  残差连接（x += residual，两者形状必须相同）
  * 
  * @param x        输入输出张量
  * @param residual 残差张量
  * 
- * @return void
+ * @return int
+ *      0 - 成功
+ *     -1 - 失败（形状不匹配）
  */
-void residual_add(Tensor *x, const Tensor *residual);
+int residual_add(Tensor *x, const Tensor *residual);
 
 #endif /* __GPT2_H__ */
\ No newline at end of file
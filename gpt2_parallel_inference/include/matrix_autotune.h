@@ -0,0 +1,134 @@
+#ifndef __MATRIX_AUTOTUNE_H__
+#define __MATRIX_AUTOTUNE_H__
+
+#include "common.h"
+#include "matrix_parallel.h"
+
+/**
+ * 矩阵乘法自动调优
+ *
+ * 对每个 GEMM 形状 [M x K] @ [K x N] 搜索计算核、分块大小、线程数和调度策略，
+ * 结果保存在进程内的调优表中，matmul_parallel() 按形状查表。
+ *
+ * 搜索分两步（坐标下降，避免全组合爆炸）：
+ *   1. 线程池全部线程 + 静态调度下，比较 row 与各 block_size 的 blocked 计算核
+ *   2. 固定最优计算核，比较线程数 {1, 2, 4, ..., 线程池大小} × 三种调度策略
+ * 每个候选先预热一次，再取多次运行的最短时间。
+ *
+ * 缓存文件为制表符分隔的文本，每行一个形状，第一列为 /proc/cpuinfo 中的 CPU 型号：
+ *   <cpu_model>\t<M>\t<K>\t<N>\t<kernel>\t<threads>\t<block>\t<schedule>\t<grain>\t<time_ms>
+ * 加载时只使用与本机型号相同的行；保存时保留其它型号的行，
+ * 因此同一个文件可以在异构机群间共享。
+ *
+ * 调优表不加锁：只应在 matrix_init 之后、发起并行计算之前修改。
+ */
+
+/**
+ * 调优表项
+ */
+typedef struct {
+    size_t M;
+    size_t K;
+    size_t N;
+    matmul_plan_t plan;     // 最优执行方案
+    double time_ms;         // 调优时测得的耗时
+} matmul_tune_entry_t;
+
+/**
+ * @name matmul_autotune_cpu_model
+ * @brief 获取本机 CPU 型号字符串（缓存文件的键）
+ *
+ * @param buf  输出缓冲区
+ * @param size 缓冲区大小
+ *
+ * @return
+ *      successful: 0
+ *      failed: -1（无法识别时写入 "unknown"）
+ */
+int matmul_autotune_cpu_model(char *buf, size_t size);
+
+
+/**
+ * @name matmul_autotune_shape
+ * @brief 为一个 GEMM 形状搜索最优执行方案并写入调优表
+ *
+ * 需要先调用 matrix_init，候选线程数不超过线程池大小。
+ *
+ * @param M    矩阵 A 的行数
+ * @param K    矩阵 A 的列数 / 矩阵 B 的行数
+ * @param N    矩阵 B 的列数
+ * @param best 输出最优表项（可为 NULL）
+ *
+ * @return
+ *      successful: 0
+ *      failed: -1
+ */
+int matmul_autotune_shape(size_t M, size_t K, size_t N, matmul_tune_entry_t *best);
+
+
+/**
+ * @name matmul_autotune_record
+ * @brief 写入（或覆盖同形状的）调优表项
+ *
+ * @param entry 表项
+ *
+ * @return
+ *      successful: 0
+ *      failed: -1
+ */
+int matmul_autotune_record(const matmul_tune_entry_t *entry);
+
+
+/**
+ * @name matmul_autotune_lookup
+ * @brief 查找形状对应的执行方案
+ *
+ * @return 找到返回方案指针（调优表修改前有效），否则返回 NULL
+ */
+const matmul_plan_t* matmul_autotune_lookup(size_t M, size_t K, size_t N);
+
+
+/**
+ * @name matmul_autotune_count
+ * @brief 调优表中的表项数
+ *
+ * @return 表项数
+ */
+size_t matmul_autotune_count(void);
+
+
+/**
+ * @name matmul_autotune_clear
+ * @brief 清空调优表
+ *
+ * @return void
+ */
+void matmul_autotune_clear(void);
+
+
+/**
+ * @name matmul_autotune_load
+ * @brief 从缓存文件加载本机型号的调优结果
+ *
+ * @param path 缓存文件路径
+ *
+ * @return
+ *      successful: 加载的表项数（文件不存在时为 0）
+ *      failed: -1
+ */
+int matmul_autotune_load(const char *path);
+
+
+/**
+ * @name matmul_autotune_save
+ * @brief 把调优表写入缓存文件（保留其它 CPU 型号的表项）
+ *
+ * @param path 缓存文件路径
+ *
+ * @return
+ *      successful: 0
+ *      failed: -1
+ */
+int matmul_autotune_save(const char *path);
+
+#endif /* __MATRIX_AUTOTUNE_H__ */
@@ -5,6 +5,43 @@
 #include "tensor.h"
 #include "thread_pool.h"
 
+/**
+ * 并行矩阵乘法的行调度策略
+ *
+ * 行空间按 grain 切成块（chunk），由工作线程领取：
+ * - STATIC:  提交前按线程数均分，每个任务一个固定区间（默认，与旧行为一致）
+ * - DYNAMIC: 每个线程循环用原子计数器领取 grain 行，快的线程多做
+ * - GUIDED:  块大小为 剩余行数 / (2 * 线程数)，逐渐缩小到 grain，
+ *            兼顾前期低调度开销与尾部负载均衡
+ *
+ * 当 M 小于线程数时，三种策略都会额外沿 N 方向切分列条（2D 分块），
+ * 避免单行矩阵（如逐 token 推理）只有一个线程在工作。
+ */
+typedef enum {
+    MATMUL_SCHED_STATIC = 0,
+    MATMUL_SCHED_DYNAMIC,
+    MATMUL_SCHED_GUIDED
+} matmul_schedule_t;
+
+/**
+ * 并行矩阵乘法的计算核
+ */
+typedef enum {
+    MATMUL_KERNEL_ROW = 0,      // 行分块 ikj
+    MATMUL_KERNEL_BLOCKED       // 行分块 + block_size 缓存分块
+} matmul_kernel_t;
+
+/**
+ * 单次并行矩阵乘法的执行方案（由配置或自动调优得到）
+ */
+typedef struct {
+    matmul_kernel_t kernel;     // 计算核
+    int num_threads;            // 参与计算的线程数（不超过线程池大小）
+    size_t block_size;          // MATMUL_KERNEL_BLOCKED 的分块大小
+    matmul_schedule_t schedule; // 行调度策略
+    size_t grain;               // 每次领取的最少行数（0 自动选择）
+} matmul_plan_t;
+
 /**
  * 矩阵运算配置结构体
  */
@@ -13,6 +50,19 @@ typedef struct {
     size_t block_size;      // 每个线程处理的块大小
     bool use_blocking;      // 分块处理标志
     bool use_simd;          // 是否使用 SIMD 优化
+
+    /* 工作线程放置（透传给线程池，全部为 0 时不绑定） */
+    thread_affinity_t affinity; // 亲和性模式
+    bool avoid_smt;             // 每个物理核只放一个工作线程
+    int numa_node;              // AFFINITY_NUMA_NODE 使用的节点
+    const char *cpuset;         // AFFINITY_CPUSET 使用的 CPU 列表
+
+    /* 并行行调度（全部为 0 时为静态均分） */
+    matmul_schedule_t schedule; // 调度策略
+    size_t grain;               // 每次领取的最少行数（0 自动选择）
+
+    /* 自动调优缓存（NULL 时读取环境变量 GPT2_TUNE_CACHE，见 matrix_autotune.h） */
+    const char *tune_cache;
 } matrix_config_t;
 
 /**
@@ -79,6 +129,8 @@ void matmul_serial_blocked(const Tensor* A, const Tensor* B, Tensor* C);
 /**
  * @name matmul_parallel_row
  * @brief 矩阵并行乘法 (行分块)
+ *
+ * 按 matrix_config_t.schedule / grain 把行（以及 M 较小时的列条）分给工作线程。
  * 
  * @param A 输入矩阵 A
  * @param B 输入矩阵 B
@@ -102,6 +154,47 @@ void matmul_parallel_row(const Tensor* A, const Tensor* B, Tensor* C);
 void matmul_parallel_blocked(const Tensor* A, const Tensor* B, Tensor* C);
 
 
+/**
+ * @name matmul_parallel_plan
+ * @brief 按给定执行方案进行并行矩阵乘法
+ *
+ * @param A    输入矩阵 A
+ * @param B    输入矩阵 B
+ * @param C    输出矩阵 C
+ * @param plan 执行方案
+ *
+ * @return void
+ */
+void matmul_parallel_plan(const Tensor* A, const Tensor* B, Tensor* C, const matmul_plan_t* plan);
+
+
+/**
+ * @name matmul_parallel
+ * @brief 并行矩阵乘法（推荐入口）
+ *
+ * 若自动调优表中有该形状的方案则使用之，
+ * 否则按 matrix_config_t 的 use_blocking / block_size / schedule 执行。
+ *
+ * @param A 输入矩阵 A
+ * @param B 输入矩阵 B
+ * @param C 输出矩阵 C
+ *
+ * @return void
+ */
+void matmul_parallel(const Tensor* A, const Tensor* B, Tensor* C);
+
+
+/**
+ * @name matmul_default_plan
+ * @brief 由当前 matrix_config_t 生成的默认执行方案
+ *
+ * @param plan 输出执行方案
+ *
+ * @return void
+ */
+void matmul_default_plan(matmul_plan_t* plan);
+
+
 /**
  * 性能测试
  */
@@ -0,0 +1,129 @@
+#ifndef __PERF_COUNTERS_H__
+#define __PERF_COUNTERS_H__
+
+#include "common.h"
+
+/**
+ * 硬件性能计数器（perf_event_open）
+ *
+ * 每个 perf_counters_t 对应一个线程（tid），每个事件单独打开、互不成组：
+ * 某个事件在当前 CPU / 虚拟机 / 权限下不可用时只丢失该事件，其它照常计数。
+ * 只统计用户态（exclude_kernel），因此在 perf_event_paranoid <= 2 时无需特权。
+ *
+ * 计数器数量超过硬件 PMU 槽位时内核会分时复用，
+ * perf_counters_read 按 time_enabled / time_running 对读数做线性外推。
+ */
+
+typedef enum {
+    PERF_CTR_CYCLES = 0,        // CPU 周期
+    PERF_CTR_INSTRUCTIONS,      // 退休指令数
+    PERF_CTR_L1D_MISSES,        // L1 数据缓存读缺失
+    PERF_CTR_LLC_MISSES,        // 末级缓存缺失
+    PERF_CTR_DTLB_MISSES,       // 数据 TLB 读缺失
+    PERF_CTR_STALLED_CYCLES,    // 后端停顿周期（不支持时退化为前端停顿周期）
+    PERF_CTR_TASK_CLOCK,        // 线程 CPU 时间（纳秒，软件事件，虚拟机中通常也可用）
+    PERF_CTR_COUNT
+} perf_counter_id_t;
+
+/**
+ * 单个线程的一组计数器
+ */
+typedef struct {
+    int tid;                        // 被统计线程的内核线程 ID（0 表示调用线程）
+    int fds[PERF_CTR_COUNT];        // 事件文件描述符，-1 表示不可用
+    int num_open;                   // 成功打开的事件数
+    int first_errno;                // 第一个打开失败的 errno（便于报告原因）
+} perf_counters_t;
+
+/**
+ * 一次读数
+ */
+typedef struct {
+    uint64_t values[PERF_CTR_COUNT];    // 计数值（已按复用比例外推）
+    bool valid[PERF_CTR_COUNT];         // 该事件是否可用
+} perf_sample_t;
+
+/**
+ * @name perf_counters_open
+ * @brief 为线程打开全部事件（初始为停止状态）
+ *
+ * @param pc  计数器组
+ * @param tid 内核线程 ID（0 表示调用线程）
+ *
+ * @return
+ *      successful: 打开的事件数（0 表示计数器整体不可用，见 pc->first_errno）
+ *      failed: -1（参数错误）
+ */
+int perf_counters_open(perf_counters_t *pc, int tid);
+
+
+/**
+ * @name perf_counters_close
+ * @brief 关闭全部事件
+ *
+ * @param pc 计数器组
+ *
+ * @return void
+ */
+void perf_counters_close(perf_counters_t *pc);
+
+
+/**
+ * @name perf_counters_start
+ * @brief 清零并开始计数
+ *
+ * @param pc 计数器组
+ *
+ * @return void
+ */
+void perf_counters_start(perf_counters_t *pc);
+
+
+/**
+ * @name perf_counters_stop
+ * @brief 停止计数（读数保留）
+ *
+ * @param pc 计数器组
+ *
+ * @return void
+ */
+void perf_counters_stop(perf_counters_t *pc);
+
+
+/**
+ * @name perf_counters_read
+ * @brief 读取当前计数
+ *
+ * @param pc     计数器组
+ * @param sample 输出读数
+ *
+ * @return void
+ */
+void perf_counters_read(const perf_counters_t *pc, perf_sample_t *sample);
+
+
+/**
+ * @name perf_sample_add
+ * @brief 累加读数（用于把多个线程的计数合并）
+ *
+ * 只要任一来源有效，结果即有效。
+ *
+ * @param dst 累加目标
+ * @param src 读数
+ *
+ * @return void
+ */
+void perf_sample_add(perf_sample_t *dst, const perf_sample_t *src);
+
+
+/**
+ * @name perf_counter_name
+ * @brief 事件名称
+ *
+ * @param id 事件编号
+ *
+ * @return 名称字符串
+ */
+const char* perf_counter_name(perf_counter_id_t id);
+
+#endif /* __PERF_COUNTERS_H__ */
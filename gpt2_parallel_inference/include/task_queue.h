@@ -4,6 +4,24 @@
 #include "common.h"
 #include <pthread.h>
 
+/**
+ * @brief 任务优先级
+ * 
+ * 数值越小优先级越高；每个优先级有独立的 FIFO 子队列。
+ */
+typedef enum {
+    TASK_PRIO_HIGH = 0,         // 延迟敏感任务（如 decode 步）
+    TASK_PRIO_NORMAL = 1,       // 默认优先级
+    TASK_PRIO_BACKGROUND = 2,   // 批量/后台任务（如大规模 prefill）
+    TASK_PRIO_COUNT
+} task_priority_t;
+
+/**
+ * 饥饿保护阈值：低优先级子队列非空时，最多连续被更高优先级插队的次数。
+ * 达到阈值后下一次出队强制从该子队列取任务。
+ */
+#define TASK_QUEUE_STARVATION_LIMIT 16
+
 /**
  * @brief 任务结构体
  * 
@@ -15,9 +33,28 @@ typedef struct task {
     void (*function)(void *arg);        // 任务处理函数指针
     void *arg;                          // 任务数据指针
     void (*cleanup)(void *arg);         // 任务清理函数指针（可选）
+    task_priority_t priority;           // 任务优先级
+    uint64_t enqueue_ns;                // 入队时间戳（CLOCK_MONOTONIC，纳秒）
     struct task *next;                  // 链表指针
 } Task;
 
+/**
+ * @brief 单个任务的执行信息（由 task_queue_pop_and_execute 填写）
+ */
+typedef struct {
+    uint64_t wait_ns;                   // 入队到开始执行的等待时间
+    uint64_t exec_ns;                   // 任务函数执行时间（含 cleanup）
+    task_priority_t priority;           // 任务优先级
+} task_exec_info_t;
+
+/**
+ * @brief 任务完成回调
+ *
+ * 在任务计入完成（active_tasks 递减并唤醒 task_queue_wait_empty）之前调用，
+ * 因此等待者返回时回调中记录的统计已经可见。
+ */
+typedef void (*task_done_fn)(const task_exec_info_t *info, void *ctx);
+
 /**
  * @brief 任务队列结构体
  * 
@@ -26,11 +63,14 @@ typedef struct task {
  * - 通过互斥锁和条件变量实现线程安全的任务添加和获取
  * - 支持任务队列的销毁，释放所有资源
  * - not-full 等条件变量（背压机制）
+ * - 按优先级划分子队列，出队时高优先级优先，并带饥饿保护
  */
 typedef struct {
-    /* 队列数据 */
-    Task *front;
-    Task *back;
+    /* 队列数据（每个优先级一个 FIFO） */
+    Task *front[TASK_PRIO_COUNT];
+    Task *back[TASK_PRIO_COUNT];
+    size_t prio_count[TASK_PRIO_COUNT];     // 各优先级待处理任务数
+    size_t starvation[TASK_PRIO_COUNT];     // 各优先级连续被插队次数
 
     /* 队列状态 */
     size_t count;                       // 当前任务数量
@@ -49,6 +89,9 @@ typedef struct {
     struct {
         size_t total_enqueued;          // 总入队任务数量
         size_t total_dequeued;          // 总出队任务数量
+        size_t prio_enqueued[TASK_PRIO_COUNT];  // 各优先级入队数量
+        size_t starvation_promotions;   // 因饥饿保护而提前出队的次数
+        size_t max_depth;               // 队列深度高水位
         double avg_wait_time;           // 平均等待时间
     } stats;
 } task_queue_t;
@@ -69,6 +112,26 @@ int task_queue_submit(task_queue_t *queue,
                       void (*cleanup)(void*));
 
 
+/**
+ * @brief 以指定优先级提交任务到队列
+ * 
+ * TASK_PRIO_HIGH 的任务不受 max_count 背压限制，
+ * 保证延迟敏感任务不会因为队列被批量任务填满而阻塞在提交端。
+ * 
+ * @param queue 队列指针
+ * @param func 任务函数
+ * @param arg 任务参数
+ * @param cleanup 清理函数（可选）
+ * @param priority 任务优先级
+ * @return 0成功，-1失败
+ */
+int task_queue_submit_prio(task_queue_t *queue,
+                           void (*func)(void*),
+                           void *arg,
+                           void (*cleanup)(void*),
+                           task_priority_t priority);
+
+
 /* ========== 队列 API ========== */
 
 /**
@@ -113,6 +176,9 @@ int task_queue_push(task_queue_t *queue, Task *task);
  * @name task_queue_pop
  * @brief 出队（消费者）
  * 
+ * 按优先级出队：总是取最高优先级子队列的队头，
+ * 除非某个低优先级子队列已连续被插队 TASK_QUEUE_STARVATION_LIMIT 次。
+ * 
  * @param queue     指向任务队列的指针
  * @param shutdown  指示是否在关闭时退出
  * 
@@ -164,12 +230,26 @@ void task_queue_print_stats(task_queue_t *queue);
  * 
  * @param queue 队列指针
  * @param should_shutdown 关闭标志指针（由调用者保证线程安全访问）
+ * @param on_done 任务完成回调（可选，仅在返回 0 的路径上调用一次）
+ * @param done_ctx 传给 on_done 的上下文
  * 
  * @return 
  *      0: 成功执行一个任务
  *      1: 收到关闭信号且队列为空，应该退出
  *     -1: 错误
  */
-int task_queue_pop_and_execute(task_queue_t *queue, bool *should_shutdown);
+int task_queue_pop_and_execute(task_queue_t *queue, bool *should_shutdown,
+                               task_done_fn on_done, void *done_ctx);
+
+
+/**
+ * @name task_queue_reset_stats
+ * @brief 清零统计计数（不影响队列中的任务）
+ * 
+ * @param queue 指向任务队列的指针
+ * 
+ * @return void
+ */
+void task_queue_reset_stats(task_queue_t *queue);
 
 #endif /* __TASK_QUEUE_H__ */
@@ -3,6 +3,25 @@
 
 #include <common.h>
 
+#define TENSOR_MAX_DIMS     8       // 最大维度数（shape / stride 内联存储）
+#define TENSOR_ALIGNMENT    64      // 数据起始地址对齐（cache line，满足 AVX-512 对齐加载）
+
+/**
+ * @name 张量内存分配器
+ * 
+ * @brief 
+ * 张量的结构体与数据放在同一块内存中，由分配器一次分配、一次释放。
+ * 默认（NULL）使用堆上的对齐分配；调用者可以传入自己的分配器，
+ * 例如 tensor_arena_allocator() 让一次前向传播的中间张量全部来自 arena。
+ * 
+ * alloc 返回的地址必须按 alignment 对齐；free 可以为 NULL（arena 整体回收）。
+ */
+typedef struct tensor_allocator {
+    void* (*alloc)(void *ctx, size_t size, size_t alignment);
+    void (*free)(void *ctx, void *ptr);
+    void *ctx;
+} tensor_allocator_t;
+
 /**
  * @name 张量结构体 - 存储多维数组数据
  * 
@@ -10,23 +29,21 @@
  * 核心设计理念：
  * 1. 数据与元数据分离
  * 2. 内存连续优先
- * 3. 支持任意维度
+ * 3. 支持任意维度（不超过 TENSOR_MAX_DIMS）
  * 
- * 内存布局：
- *   结构体本身（栈或堆）
- *     ├─ data  → 堆上的浮点数组（主要内存）
- *     ├─ shape → 堆上的维度数组
- *     ├─ ndim  → 标量
- *     └─ size  → 标量（缓存优化）
+ * 内存布局（一次分配）：
+ *   [ Tensor 结构体（含 shape/stride），填充到 TENSOR_ALIGNMENT ][ data ... ]
+ *   视图（切片、reshape）只分配结构体部分，data 指向源张量的数据。
  */
 typedef struct {
-    float *data;        // 数据指针（堆分配）
-    size_t *shape;      // 各维度数组，如[batch, seq_len, hidden_dm]
-    size_t *stride;     // 各维度步长数组
-    size_t ndim;        // 维度数量
-    size_t size;        // 总元素数量
-    size_t offset;      // 数据偏移（用于切片等共享场景）  
-    bool owns_data;     // 是否拥有数据所有权（用于切片等共享场景）
+    float *data;                        // 数据指针（拥有数据时紧跟在结构体之后）
+    size_t shape[TENSOR_MAX_DIMS];      // 各维度数组，如[batch, seq_len, hidden_dm]
+    size_t stride[TENSOR_MAX_DIMS];     // 各维度步长数组
+    size_t ndim;                        // 维度数量
+    size_t size;                        // 总元素数量
+    size_t offset;                      // 数据偏移（用于切片等共享场景）  
+    bool owns_data;                     // 是否拥有数据所有权（用于切片等共享场景）
+    const tensor_allocator_t *allocator;    // 分配器，NULL 表示默认堆分配
 } Tensor;
 
 
@@ -50,6 +67,21 @@ typedef struct {
 Tensor* tensor_create(size_t ndim, const size_t *shape);
 
 
+/**
+ * @name tensor_create_with_allocator
+ * @brief 使用指定分配器创建张量（数据初始化为 0）
+ * 
+ * @param ndim      - 维度数量
+ * @param shape     - 各维度大小数组
+ * @param allocator - 分配器，NULL 表示默认堆分配
+ * 
+ * @return
+ *      successful - 返回创建张量指针
+ *      failed - 返回 NULL
+ */
+Tensor* tensor_create_with_allocator(size_t ndim, const size_t *shape, const tensor_allocator_t *allocator);
+
+
 /**
  * @name tensor_create_with_vlaue
  * @brief 张量创建并初始化
@@ -187,6 +219,8 @@ bool tensor_shape_equal(const Tensor *a, const Tensor *b);
  * @name tensor_clone
  * @brief 克隆张量（深拷贝）
  * 
+ * 视图（切片、非默认步长）会被复制成连续张量。
+ * 
  * @param t - 待克隆张量指针
  * 
  * @return
@@ -212,6 +246,136 @@ Tensor* tensor_clone(const Tensor *t);
 Tensor* tensor_reshape(const Tensor *t, size_t nidm, const size_t *new_shape);
 
 
+/* ========== 迭代与逐元素运算 API ========== */
+
+#define TENSOR_ITER_MAX_OPS 3   // 单个迭代器最多同时遍历的张量数（输出 + 两个输入）
+
+/**
+ * @name 跨步迭代器
+ * 
+ * @brief 
+ * 同时遍历多个张量（可以是切片、转置等非默认步长的视图）：
+ * 1. 以第一个张量（输出）的形状为迭代空间，其余张量按 NumPy 规则
+ *    右对齐广播（缺失维度或大小为 1 的维度步长视为 0）
+ * 2. 去掉大小为 1 的维度，并把所有张量都能连续衔接的相邻维度折叠为一维
+ * 3. 每次 tensor_iter_next 给出最内层的一段：各张量起始指针、段长和段内步长，
+ *    外层维度只做指针增量，不再逐元素计算偏移
+ * 
+ * 连续张量会被折叠成一段，内层循环即为整块的线性扫描。
+ * 
+ * 用法：
+ *   const Tensor *ops[] = {out, a, b};
+ *   tensor_iter_t it;
+ *   if (tensor_iter_init(&it, 3, ops) != 0) return -1;
+ *   while (tensor_iter_next(&it)) {
+ *       for (size_t i = 0; i < it.inner_size; i ++) {
+ *           it.ptr[0][i * it.inner_stride[0]] = ...;
+ *       }
+ *   }
+ */
+typedef struct {
+    size_t nops;                                            // 张量数
+    size_t ndim;                                            // 折叠后的外层维度数（由内向外）
+    size_t shape[TENSOR_MAX_DIMS];                          // 外层各维大小
+    ptrdiff_t strides[TENSOR_ITER_MAX_OPS][TENSOR_MAX_DIMS];// 外层各维步长（元素）
+    size_t index[TENSOR_MAX_DIMS];                          // 外层当前下标
+    bool started;
+    bool done;
+
+    /* 当前内层段（tensor_iter_next 返回 true 时有效） */
+    float *ptr[TENSOR_ITER_MAX_OPS];                        // 各张量段起始地址
+    ptrdiff_t inner_stride[TENSOR_ITER_MAX_OPS];            // 段内步长（0 表示广播）
+    size_t inner_size;                                      // 段长（元素）
+} tensor_iter_t;
+
+
+/**
+ * @name tensor_iter_init
+ * @brief 初始化跨步迭代器
+ * 
+ * @param it   - 迭代器
+ * @param nops - 张量数（1 ~ TENSOR_ITER_MAX_OPS）
+ * @param ops  - 张量数组，ops[0] 决定迭代形状
+ * 
+ * @return
+ *      successful - 0
+ *      failed - -1（形状不可广播等）
+ */
+int tensor_iter_init(tensor_iter_t *it, size_t nops, const Tensor *const *ops);
+
+
+/**
+ * @name tensor_iter_next
+ * @brief 前进到下一个内层段
+ * 
+ * @param it - 迭代器
+ * 
+ * @return 还有段返回 true，遍历结束返回 false
+ */
+bool tensor_iter_next(tensor_iter_t *it);
+
+
+/**
+ * @name tensor_copy
+ * @brief 按元素复制：dst = src（src 广播到 dst 的形状，可改变内存布局）
+ * 
+ * 例如把转置视图或切片视图复制成连续张量；两者都连续时退化为 memcpy。
+ * 
+ * @param dst - 目标张量
+ * @param src - 源张量
+ * 
+ * @return
+ *      successful - 0
+ *      failed - -1
+ */
+int tensor_copy(Tensor *dst, const Tensor *src);
+
+
+/**
+ * @name tensor_add
+ * @brief 按元素加法：out = a + b（a、b 广播到 out 的形状，out 可与 a 或 b 相同）
+ * 
+ * @param out - 输出张量
+ * @param a   - 输入张量
+ * @param b   - 输入张量（如 [d] 的偏置广播到 [seq_len, d]）
+ * 
+ * @return
+ *      successful - 0
+ *      failed - -1
+ */
+int tensor_add(Tensor *out, const Tensor *a, const Tensor *b);
+
+
+/**
+ * @name tensor_mul
+ * @brief 按元素乘法：out = a * b（广播规则同 tensor_add）
+ * 
+ * @param out - 输出张量
+ * @param a   - 输入张量
+ * @param b   - 输入张量
+ * 
+ * @return
+ *      successful - 0
+ *      failed - -1
+ */
+int tensor_mul(Tensor *out, const Tensor *a, const Tensor *b);
+
+
+/**
+ * @name tensor_scale
+ * @brief 数乘：out = a * scale（out 可与 a 相同）
+ * 
+ * @param out   - 输出张量
+ * @param a     - 输入张量
+ * @param scale - 缩放系数
+ * 
+ * @return
+ *      successful - 0
+ *      failed - -1
+ */
+int tensor_scale(Tensor *out, const Tensor *a, float scale);
+
+
 /* ========== 工具函数 ========== */
 
 /**
@@ -268,4 +432,79 @@ typedef struct {
 tensor_stats tensor_compute_stats(const Tensor *t);
 
 
+/**
+ * @name tensor_alloc_count
+ * @brief 进程内累计创建的张量数（含视图与副本）
+ * 
+ * 两次读数之差即区间内的张量分配次数，用于统计推理每 token 的分配开销。
+ * 
+ * @return 累计张量数
+ */
+uint64_t tensor_alloc_count(void);
+
+
+/* ========== Arena 分配器 ========== */
+
+/**
+ * 线性（bump）分配器：分配为一次原子加法，单个张量不单独释放，
+ * 由 tensor_arena_reset 整体回收。可被多个线程同时分配。
+ * 
+ * 从 arena 分配的张量仍需调用 tensor_free（只是不释放内存），
+ * 且必须在 reset / destroy 之前停止使用。
+ */
+typedef struct tensor_arena tensor_arena_t;
+
+/**
+ * @name tensor_arena_create
+ * @brief 创建 arena
+ * 
+ * @param capacity - 容量（字节）
+ * 
+ * @return
+ *      successful - 返回 arena 指针
+ *      failed - 返回 NULL
+ */
+tensor_arena_t* tensor_arena_create(size_t capacity);
+
+
+/**
+ * @name tensor_arena_destroy
+ * @brief 销毁 arena 并释放其全部内存
+ * 
+ * @param arena - arena 指针
+ */
+void tensor_arena_destroy(tensor_arena_t *arena);
+
+
+/**
+ * @name tensor_arena_reset
+ * @brief 回收 arena 中的全部分配（调用时不得有线程正在分配）
+ * 
+ * @param arena - arena 指针
+ */
+void tensor_arena_reset(tensor_arena_t *arena);
+
+
+/**
+ * @name tensor_arena_allocator
+ * @brief 获取 arena 对应的分配器，传给 tensor_create_with_allocator
+ * 
+ * @param arena - arena 指针
+ * 
+ * @return 分配器指针（生命周期与 arena 相同）
+ */
+const tensor_allocator_t* tensor_arena_allocator(tensor_arena_t *arena);
+
+
+/**
+ * @name tensor_arena_used
+ * @brief arena 已使用的字节数
+ * 
+ * @param arena - arena 指针
+ * 
+ * @return 已使用字节数
+ */
+size_t tensor_arena_used(const tensor_arena_t *arena);
+
+
 #endif /* __TENSOR_H__ */
\ No newline at end of file
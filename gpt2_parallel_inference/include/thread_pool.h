@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "task_queue.h"
+#include "cpu_topology.h"
 #include <pthread.h>
 
 /**
@@ -13,17 +14,49 @@ typedef struct {
     int queue_size;         // 任务队列大小
     int stack_size;         // 线程栈大小（可选）
     bool daemon_threads;    // 是否为守护线程
+
+    /* CPU 亲和性（全部为 0 时保持不绑定） */
+    thread_affinity_t affinity; // 亲和性模式
+    bool avoid_smt;             // 每个物理核只放一个工作线程
+    int numa_node;              // AFFINITY_NUMA_NODE 使用的节点
+    const char *cpuset;         // AFFINITY_CPUSET 使用的 CPU 列表，如 "0-3,8"
 } thread_pool_cfg_t;
 
+/**
+ * 延迟直方图
+ * 
+ * 以 2 的幂为桶边界：桶 i 统计 [2^i, 2^(i+1)) 纳秒的样本，
+ * 最后一个桶收纳所有更大的值。记录一次只需几次原子加法。
+ */
+#define POOL_HIST_BUCKETS 32
+
+typedef struct {
+    uint64_t buckets[POOL_HIST_BUCKETS];    // 各桶样本数
+    uint64_t count;                         // 样本总数
+    uint64_t sum_ns;                        // 样本总和
+    uint64_t max_ns;                        // 最大样本
+} pool_histogram_t;
+
 /**
  * 线程信息（用于监控）
+ * 
+ * 计数器只由所属工作线程写入（relaxed 原子操作），
+ * 读取方通过 thread_pool_get_stats 获得近似一致的快照。
  */
 typedef struct {
     pthread_t tid;                  // 线程ID
+    int os_tid;                     // 内核线程 ID（gettid，线程启动后发布，用于 perf_event_open 等）
     int id;                         // 线程编号
+    int cpu;                        // 绑定的逻辑 CPU（-1 表示未绑定）
     size_t tasks_completed;         // 已完成任务数
     bool is_active;                 // 线程活跃状态
     bool should_exit;               // 线程退出标志位（用于动态调整线程数）
+
+    /* 遥测 */
+    uint64_t busy_ns;               // 执行任务的累计时间
+    uint64_t idle_ns;               // 等待任务（含取任务开销）的累计时间
+    pool_histogram_t wait_hist;     // 入队到开始执行的延迟分布
+    pool_histogram_t exec_hist;     // 任务执行时间分布
 } thread_info_t;
 
 /**
@@ -50,6 +83,10 @@ typedef struct {
     thread_info_t *thread_infos;    // 线程信息数组
     int num_threads;                // 线程数量
 
+    /* CPU 亲和性 */
+    int *cpu_list;                  // 候选 CPU 列表（未绑定时为 NULL）
+    int num_cpus;                   // 候选 CPU 数量，线程 i 绑定到 cpu_list[i % num_cpus]
+
     /* 任务队列 */
     task_queue_t *task_queue;       // 任务队列指针
 
@@ -58,17 +95,45 @@ typedef struct {
     pthread_mutex_t state_lock;     // 状态互斥锁
     pthread_cond_t state_changed;   // 状态条件变量
 
-    // /* 统计信息 */
-    // struct {
-    //     size_t total_tasks;         // 总任务数
-    //     size_t failed_tasks;        // 失败任务数
-    //     double total_time;          // 总时间
-    // } stats;
+    /* 统计信息 */
+    struct {
+        size_t total_tasks;         // 成功提交的任务数
+        size_t failed_tasks;        // 提交失败的任务数
+        uint64_t start_ns;          // 统计起点（创建或上次重置）
+    } stats;
 
     /* 线程关闭标志 */
     volatile bool shutdown;
 } thread_pool_t;
 
+/**
+ * 单个工作线程的统计快照
+ */
+typedef struct {
+    int id;                         // 线程编号
+    int cpu;                        // 绑定的逻辑 CPU（-1 表示未绑定）
+    size_t tasks_completed;         // 已完成任务数
+    uint64_t busy_ns;               // 执行任务时间
+    uint64_t idle_ns;               // 等待任务时间
+    double utilization;             // busy / (busy + idle)
+} pool_worker_stats_t;
+
+/**
+ * 线程池统计快照
+ */
+typedef struct {
+    int num_threads;                // 线程数量
+    double elapsed_ms;              // 统计窗口长度
+    size_t submitted;               // 成功提交的任务数
+    size_t failed;                  // 提交失败的任务数
+    size_t completed;               // 已完成任务数
+    size_t queue_depth;             // 当前排队任务数
+    size_t queue_high_water;        // 排队任务数高水位
+    pool_histogram_t wait_hist;     // 全部线程合并的等待延迟分布
+    pool_histogram_t exec_hist;     // 全部线程合并的执行时间分布
+    pool_worker_stats_t *workers;   // 每个线程的统计 [num_threads]
+} thread_pool_stats_t;
+
 /* ============= 线程池 API ============= */
 
 /**
@@ -112,6 +177,27 @@ void thread_pool_destroy(thread_pool_t *pool);
 int thread_pool_submit(thread_pool_t *pool, void (*func)(void *), void *arg, void (*cleanup)(void *));
 
 
+/**
+ * @name thread_pool_submit_prio
+ * @brief 以指定优先级提交任务
+ * 
+ * thread_pool_submit 等价于以 TASK_PRIO_NORMAL 调用本函数。
+ * 高优先级任务会越过已排队的普通/后台任务被优先执行。
+ * 
+ * @param pool 线程池指针
+ * @param func 任务函数指针
+ * @param arg 任务参数指针
+ * @param cleanup 任务清理函数指针（可选）
+ * @param priority 任务优先级
+ * 
+ * @return
+ *      successful: 0
+ *      failed: -1
+ */
+int thread_pool_submit_prio(thread_pool_t *pool, void (*func)(void *), void *arg,
+                            void (*cleanup)(void *), task_priority_t priority);
+
+
 /**
  * @name thread_pool_wait_all
  * @brief 等待所有任务完成
@@ -158,4 +244,91 @@ void thread_pool_print_info(const thread_pool_t *pool);
  */
 int thread_pool_resize(thread_pool_t *pool, int new_size);
 
+
+/**
+ * @name thread_pool_get_worker_tids
+ * @brief 获取工作线程的内核线程 ID（等待尚未启动完成的线程发布 ID）
+ *
+ * @param pool 线程池指针
+ * @param tids 输出数组，tids[i] 为线程 i 的 ID
+ * @param max  输出数组容量
+ *
+ * @return
+ *      successful: 写入的线程数
+ *      failed: -1（参数错误或等待超时）
+ */
+int thread_pool_get_worker_tids(thread_pool_t *pool, int *tids, int max);
+
+
+/* ============= 遥测 API ============= */
+
+/**
+ * @name thread_pool_get_stats
+ * @brief 获取线程池统计快照
+ * 
+ * @param pool 线程池指针
+ * @param stats 输出快照（使用后需调用 thread_pool_stats_free）
+ * 
+ * @return
+ *      successful: 0
+ *      failed: -1
+ */
+int thread_pool_get_stats(thread_pool_t *pool, thread_pool_stats_t *stats);
+
+
+/**
+ * @name thread_pool_stats_free
+ * @brief 释放快照中动态分配的部分
+ * 
+ * @param stats 快照指针
+ * 
+ * @return void
+ */
+void thread_pool_stats_free(thread_pool_stats_t *stats);
+
+
+/**
+ * @name thread_pool_reset_stats
+ * @brief 清零所有统计计数，开始新的统计窗口
+ * 
+ * 与正在运行的任务并发调用时，窗口边界附近的少量样本可能归属到任一窗口。
+ * 
+ * @param pool 线程池指针
+ * 
+ * @return void
+ */
+void thread_pool_reset_stats(thread_pool_t *pool);
+
+
+/**
+ * @name thread_pool_dump_stats
+ * @brief 以 JSON 格式输出统计快照
+ * 
+ * 格式：
+ *   {"num_threads":N,"elapsed_ms":..,"tasks":{...},"queue":{...},
+ *    "wait_ns":{hist},"exec_ns":{hist},"workers":[{...},...]}
+ * 其中 hist 为 {"count","mean","p50","p90","p99","max","buckets":[...]}，
+ * buckets[i] 对应 [2^i, 2^(i+1)) 纳秒。
+ * 
+ * @param pool 线程池指针
+ * @param fp 输出文件
+ * 
+ * @return
+ *      successful: 0
+ *      failed: -1
+ */
+int thread_pool_dump_stats(thread_pool_t *pool, FILE *fp);
+
+
+/**
+ * @name pool_histogram_percentile
+ * @brief 估算直方图分位数
+ * 
+ * @param hist 直方图指针
+ * @param q 分位点，取值 [0, 1]
+ * 
+ * @return 分位数所在桶的上界（纳秒，不超过 max_ns）；空直方图返回 0
+ */
+uint64_t pool_histogram_percentile(const pool_histogram_t *hist, double q);
+
 #endif /* __THREAD_POOL_H__ */
\ No newline at end of file
@@ -0,0 +1,129 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "common.h"
+
+/**
+ * 并行区域追踪（Chrome trace / Perfetto 格式）
+ *
+ * 设计：
+ * - 每个线程在第一次记录时分配自己的事件缓冲区（_Thread_local），记录时无锁
+ * - 事件为 "complete" 事件：名字、类别、起始时间、持续时间和一个整型参数
+ * - 未启用时 trace_now() 返回 0，trace_complete() 立即返回，开销为一次原子读
+ * - 缓冲区写满后丢弃新事件并计数，不会阻塞计算线程
+ *
+ * 用法：
+ *   uint64_t t0 = trace_now();
+ *   ... 计算 ...
+ *   trace_complete("matmul_row_task", "matmul", t0, row_start);
+ *
+ * 名字与类别必须是生命周期覆盖导出时刻的字符串（通常为字面量）。
+ *
+ * 设置环境变量 GPT2_TRACE=<path> 时，matrix_init 自动开启追踪，
+ * matrix_cleanup 导出到该文件。
+ */
+
+#define TRACE_DEFAULT_EVENTS_PER_THREAD (64 * 1024)
+
+/**
+ * @name trace_start
+ * @brief 开启追踪（丢弃之前记录的事件）
+ *
+ * @param events_per_thread 每个线程缓冲区可容纳的事件数（0 使用默认值）
+ *
+ * @return
+ *      successful: 0
+ *      failed: -1
+ */
+int trace_start(size_t events_per_thread);
+
+
+/**
+ * @name trace_stop
+ * @brief 停止记录（已记录的事件保留，可继续导出）
+ *
+ * @return void
+ */
+void trace_stop(void);
+
+
+/**
+ * @name trace_reset
+ * @brief 停止记录并释放所有线程缓冲区
+ *
+ * 调用时不得有其它线程正在记录事件。
+ *
+ * @return void
+ */
+void trace_reset(void);
+
+
+/**
+ * @name trace_enabled
+ * @brief 追踪是否处于记录状态
+ *
+ * @return true 表示正在记录
+ */
+bool trace_enabled(void);
+
+
+/**
+ * @name trace_now
+ * @brief 获取当前时间戳（CLOCK_MONOTONIC，纳秒）
+ *
+ * @return 追踪开启时返回时间戳，否则返回 0
+ */
+uint64_t trace_now(void);
+
+
+/**
+ * @name trace_complete
+ * @brief 记录一个从 start_ns 到当前时刻的区间事件
+ *
+ * @param name     事件名
+ * @param cat      事件类别（如 "pool", "matmul", "attention"）
+ * @param start_ns trace_now() 返回的起始时间戳；为 0 时忽略该事件
+ * @param arg      附加整型参数（导出为 args.arg）
+ *
+ * @return void
+ */
+void trace_complete(const char *name, const char *cat, uint64_t start_ns, int64_t arg);
+
+
+/**
+ * @name trace_set_thread_name
+ * @brief 设置当前线程在时间线上显示的名字
+ *
+ * @param name 线程名（会被复制）
+ *
+ * @return void
+ */
+void trace_set_thread_name(const char *name);
+
+
+/**
+ * @name trace_event_count
+ * @brief 已记录的事件总数
+ *
+ * @param dropped 输出因缓冲区满而丢弃的事件数（可选）
+ *
+ * @return 所有线程缓冲区中的事件总数
+ */
+size_t trace_event_count(size_t *dropped);
+
+
+/**
+ * @name trace_export_chrome
+ * @brief 导出为 Chrome trace JSON（chrome://tracing 或 ui.perfetto.dev 可直接打开）
+ *
+ * 应在计算线程静止时调用（如 thread_pool_wait_all 之后）。
+ *
+ * @param path 输出文件路径
+ *
+ * @return
+ *      successful: 0
+ *      failed: -1
+ */
+int trace_export_chrome(const char *path);
+
+#endif /* __TRACE_H__ */
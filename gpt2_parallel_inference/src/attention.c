@@ -1,5 +1,6 @@
 #include "gpt2.h"
 #include "matrix_parallel.h"
+#include "trace.h"
 #include <math.h>
 #include <sys/time.h>
 
@@ -121,13 +122,26 @@ void gelu(Tensor *x) {
 
 /* ========== 残差连接 ========== */
 
-void residual_add(Tensor *x, const Tensor *residual) {
-    ASSERT(x != NULL && residual != NULL, "NULL tensor");
-    ASSERT(x->size == residual->size, "Size mismatch");
+int residual_add(Tensor *x, const Tensor *residual) {
+    if (x == NULL || residual == NULL) {
+        ERROR_PRINT("residual_add: NULL tensor");
+        return -1;
+    }
+    bool same_shape = (x->ndim == residual->ndim);
+    for (size_t d = 0; same_shape && d < x->ndim; d ++) {
+        if (x->shape[d] != residual->shape[d]) same_shape = false;
+    }
+    if (!same_shape) {
+        ERROR_PRINT("residual_add: Shape mismatch (ndim %zu vs %zu)", x->ndim, residual->ndim);
+        return -1;
+    }
     
-    for (size_t i = 0; i < x->size; i++) {
-        x->data[i] += residual->data[i];
+    // 按步长遍历，x / residual 可以是切片等视图
+    if (tensor_add(x, x, residual) != 0) {
+        ERROR_PRINT("residual_add: Add failed");
+        return -1;
     }
+    return 0;
 }
 
 /* ========== 单头 Attention ========== */
@@ -352,49 +366,56 @@ static void attention_head_task(void *arg) {
     
     DEBUG_PRINT("Computing attention for head %d", task->head_id);
     
+    uint64_t trace_start_ns = trace_now();
     attention_single_head(task->Q_head, task->K_head, task->V_head,
                          task->mask, task->output_head);
+    trace_complete("attention_head", "attention", trace_start_ns, task->head_id);
     
     free(task);
 }
 
-void attention_multi_head_parallel(const Tensor *X,
-                                   const attention_weights_t *weights,
-                                   size_t num_heads,
-                                   const Tensor *mask,
-                                   Tensor *output) {
+int attention_multi_head_parallel(const Tensor *X,
+                                  const attention_weights_t *weights,
+                                  size_t num_heads,
+                                  const Tensor *mask,
+                                  Tensor *output) {
     
     ASSERT(X != NULL && weights != NULL && output != NULL, "NULL args");
     
     size_t seq_len = X->shape[0];
     size_t d_model = X->shape[1];
     
-    INFO_PRINT("Multi-head attention (parallel): heads=%zu, seq_len=%zu", num_heads, seq_len);
-    
-    double total_start = _get_time_ms();
+    DEBUG_PRINT("Multi-head attention (parallel): heads=%zu, seq_len=%zu", num_heads, seq_len);
     
     // 获取全局线程池
     thread_pool_t *pool = matrix_get_thread_pool();
     ASSERT(pool != NULL, "Matrix thread pool not initialized. Call matrix_init() first.");
     
     // 线性投影（使用并行矩阵乘法）
+    uint64_t phase_start_ns = trace_now();
     size_t qkv_shape[] = {seq_len, d_model};
     Tensor *Q_full = tensor_create(2, qkv_shape);
     Tensor *K_full = tensor_create(2, qkv_shape);
     Tensor *V_full = tensor_create(2, qkv_shape);
     
-    matmul_parallel_blocked(X, weights->W_Q, Q_full);
-    matmul_parallel_blocked(X, weights->W_K, K_full);
-    matmul_parallel_blocked(X, weights->W_V, V_full);
-    
-    // 添加偏置
-    for (size_t i = 0; i < seq_len * d_model; i++) {
-        Q_full->data[i] += weights->b_Q->data[i % d_model];
-        K_full->data[i] += weights->b_K->data[i % d_model];
-        V_full->data[i] += weights->b_V->data[i % d_model];
+    matmul_parallel(X, weights->W_Q, Q_full);
+    matmul_parallel(X, weights->W_K, K_full);
+    matmul_parallel(X, weights->W_V, V_full);
+    
+    // 添加偏置（[d_model] 广播到每一行）
+    if (tensor_add(Q_full, Q_full, weights->b_Q) != 0 ||
+        tensor_add(K_full, K_full, weights->b_K) != 0 ||
+        tensor_add(V_full, V_full, weights->b_V) != 0) {
+        ERROR_PRINT("Q/K/V bias add failed");
+        tensor_free(Q_full);
+        tensor_free(K_full);
+        tensor_free(V_full);
+        return -1;
     }
+    trace_complete("attn.qkv_proj", "attention", phase_start_ns, (int64_t)seq_len);
     
     // 分割头
+    phase_start_ns = trace_now();
     Tensor **Q_heads = split_heads(Q_full, num_heads);
     Tensor **K_heads = split_heads(K_full, num_heads);
     Tensor **V_heads = split_heads(V_full, num_heads);
@@ -402,7 +423,9 @@ void attention_multi_head_parallel(const Tensor *X,
     tensor_free(Q_full);
     tensor_free(K_full);
     tensor_free(V_full);
+    trace_complete("attn.split_heads", "attention", phase_start_ns, (int64_t)num_heads);
     
+    phase_start_ns = trace_now();
     size_t d_k = d_model / num_heads;
     size_t head_shape[] = {seq_len, d_k};
     Tensor **head_outputs = (Tensor **)malloc(num_heads * sizeof(Tensor *));
@@ -424,6 +447,7 @@ void attention_multi_head_parallel(const Tensor *X,
     
     // 等待所有 attention head 计算完成
     thread_pool_wait_all(pool);
+    trace_complete("attn.heads", "attention", phase_start_ns, (int64_t)num_heads);
     
     // 安全地清理头数据
     for (size_t h = 0; h < num_heads; h++) {
@@ -436,6 +460,7 @@ void attention_multi_head_parallel(const Tensor *X,
     free(V_heads);
     
     // 合并头
+    phase_start_ns = trace_now();
     Tensor *concat = tensor_create(2, qkv_shape);
     merge_heads(head_outputs, num_heads, concat);
     
@@ -443,16 +468,18 @@ void attention_multi_head_parallel(const Tensor *X,
         tensor_free(head_outputs[h]);
     }
     free(head_outputs);
+    trace_complete("attn.merge_heads", "attention", phase_start_ns, (int64_t)num_heads);
     
     // 最终线性变换
-    matmul_parallel_blocked(concat, weights->W_O, output);
-    for (size_t i = 0; i < seq_len * d_model; i++) {
-        output->data[i] += weights->b_O->data[i % d_model];
-    }
-    
+    phase_start_ns = trace_now();
+    matmul_parallel(concat, weights->W_O, output);
     tensor_free(concat);
-    
-    INFO_PRINT("Multi-head attention (parallel) completed in %.2f ms", _get_time_ms() - total_start);
+    if (tensor_add(output, output, weights->b_O) != 0) {
+        ERROR_PRINT("Output bias add failed");
+        return -1;
+    }
+    trace_complete("attn.out_proj", "attention", phase_start_ns, (int64_t)seq_len);
+    return 0;
 }
 
 /* ========== 因果掩码 ========== */
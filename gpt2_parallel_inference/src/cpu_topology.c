@@ -0,0 +1,281 @@
+#define _GNU_SOURCE
+#include "cpu_topology.h"
+#include <sched.h>
+
+#define SYSFS_CPU_DIR   "/sys/devices/system/cpu"
+#define SYSFS_NODE_DIR  "/sys/devices/system/node"
+#define MAX_CPUS        1024    // 与 CPU_SETSIZE 保持一致
+#define MAX_NUMA_NODES  64
+
+/* ============= 内部辅助函数 ============= */
+
+/**
+ * @name _read_sysfs_line
+ * @brief 读取 sysfs 文件的第一行（去掉换行）
+ *
+ * @return 成功返回 0，失败返回 -1
+ */
+static int _read_sysfs_line(const char *path, char *buf, size_t size) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    if (fgets(buf, (int)size, fp) == NULL) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+static int _read_sysfs_int(const char *path, int fallback) {
+    char buf[64];
+    if (_read_sysfs_line(path, buf, sizeof(buf)) != 0) {
+        return fallback;
+    }
+    return atoi(buf);
+}
+
+static int _compare_cpu_info(const void *a, const void *b) {
+    const cpu_info_t *x = (const cpu_info_t *)a;
+    const cpu_info_t *y = (const cpu_info_t *)b;
+
+    if (x->node_id != y->node_id) return x->node_id - y->node_id;
+    if (x->package_id != y->package_id) return x->package_id - y->package_id;
+    if (x->smt_index != y->smt_index) return x->smt_index - y->smt_index;
+    if (x->core_id != y->core_id) return x->core_id - y->core_id;
+    return x->cpu - y->cpu;
+}
+
+/* ============= 对外接口函数 ============= */
+
+int cpu_topology_parse_list(const char *list, int *cpus, int max) {
+    if (list == NULL || cpus == NULL || max <= 0) {
+        ERROR_PRINT("Invalid arguments");
+        return -1;
+    }
+
+    int count = 0;
+    const char *p = list;
+
+    while (*p != '\0') {
+        while (*p == ' ' || *p == ',') p ++;
+        if (*p == '\0') break;
+
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0) {
+            ERROR_PRINT("Malformed cpu list: \"%s\"", list);
+            return -1;
+        }
+        long last = first;
+        p = end;
+
+        if (*p == '-') {
+            p ++;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) {
+                ERROR_PRINT("Malformed cpu range in list: \"%s\"", list);
+                return -1;
+            }
+            p = end;
+        }
+
+        for (long c = first; c <= last && count < max; c ++) {
+            cpus[count ++] = (int)c;
+        }
+
+        if (*p != '\0' && *p != ',' && *p != ' ') {
+            ERROR_PRINT("Unexpected character '%c' in cpu list: \"%s\"", *p, list);
+            return -1;
+        }
+    }
+
+    return count;
+}
+
+cpu_topology_t* cpu_topology_detect(void) {
+    char path[256];
+    char buf[4096];
+
+    int *online = (int *)malloc(MAX_CPUS * sizeof(int));
+    CHECK_MALLOC(online);
+
+    // 在线 CPU 列表；读取失败时退化为 sysconf 报告的连续编号
+    int num_online;
+    if (_read_sysfs_line(SYSFS_CPU_DIR "/online", buf, sizeof(buf)) == 0) {
+        num_online = cpu_topology_parse_list(buf, online, MAX_CPUS);
+    } else {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        num_online = (int)MIN(MAX(n, 1), MAX_CPUS);
+        for (int i = 0; i < num_online; i ++) online[i] = i;
+    }
+    if (num_online <= 0) {
+        ERROR_PRINT("Failed to determine online CPUs");
+        free(online);
+        return NULL;
+    }
+
+    cpu_topology_t *topo = (cpu_topology_t *)malloc(sizeof(cpu_topology_t));
+    if (topo == NULL) {
+        ERROR_PRINT("Failed to allocate topology");
+        free(online);
+        return NULL;
+    }
+    topo->cpus = (cpu_info_t *)calloc(num_online, sizeof(cpu_info_t));
+    if (topo->cpus == NULL) {
+        ERROR_PRINT("Failed to allocate cpu info array");
+        free(topo);
+        free(online);
+        return NULL;
+    }
+    topo->num_cpus = num_online;
+
+    // CPU -> NUMA 节点映射
+    int *node_of = (int *)calloc(MAX_CPUS, sizeof(int));
+    int *node_cpus = (int *)malloc(MAX_CPUS * sizeof(int));
+    if (node_of == NULL || node_cpus == NULL) {
+        ERROR_PRINT("Failed to allocate NUMA mapping");
+        free(node_of);
+        free(node_cpus);
+        cpu_topology_free(topo);
+        free(online);
+        return NULL;
+    }
+    topo->num_nodes = 0;
+    for (int node = 0; node < MAX_NUMA_NODES; node ++) {
+        snprintf(path, sizeof(path), SYSFS_NODE_DIR "/node%d/cpulist", node);
+        if (_read_sysfs_line(path, buf, sizeof(buf)) != 0) continue;
+
+        int n = cpu_topology_parse_list(buf, node_cpus, MAX_CPUS);
+        for (int i = 0; i < n; i ++) {
+            if (node_cpus[i] < MAX_CPUS) node_of[node_cpus[i]] = node;
+        }
+        topo->num_nodes = node + 1;
+    }
+    if (topo->num_nodes == 0) {
+        topo->num_nodes = 1;
+    }
+    free(node_cpus);
+
+    // 逐个 CPU 读取 core / package / SMT 信息
+    int siblings[MAX_CPUS];
+    for (int i = 0; i < num_online; i ++) {
+        cpu_info_t *info = &topo->cpus[i];
+        int cpu = online[i];
+
+        info->cpu = cpu;
+        info->node_id = node_of[cpu];
+
+        snprintf(path, sizeof(path), SYSFS_CPU_DIR "/cpu%d/topology/core_id", cpu);
+        info->core_id = _read_sysfs_int(path, cpu);
+
+        snprintf(path, sizeof(path), SYSFS_CPU_DIR "/cpu%d/topology/physical_package_id", cpu);
+        info->package_id = _read_sysfs_int(path, 0);
+
+        info->smt_index = 0;
+        snprintf(path, sizeof(path), SYSFS_CPU_DIR "/cpu%d/topology/thread_siblings_list", cpu);
+        if (_read_sysfs_line(path, buf, sizeof(buf)) == 0) {
+            int n = cpu_topology_parse_list(buf, siblings, MAX_CPUS);
+            for (int s = 0; s < n; s ++) {
+                if (siblings[s] == cpu) {
+                    info->smt_index = s;
+                    break;
+                }
+            }
+        }
+    }
+    free(node_of);
+    free(online);
+
+    qsort(topo->cpus, topo->num_cpus, sizeof(cpu_info_t), _compare_cpu_info);
+
+    topo->num_cores = 0;
+    for (int i = 0; i < topo->num_cpus; i ++) {
+        if (topo->cpus[i].smt_index == 0) topo->num_cores ++;
+    }
+
+    DEBUG_PRINT("Detected %d cpus, %d cores, %d numa nodes",
+                topo->num_cpus, topo->num_cores, topo->num_nodes);
+
+    return topo;
+}
+
+void cpu_topology_free(cpu_topology_t *topo) {
+    if (topo == NULL) return;
+
+    free(topo->cpus);
+    free(topo);
+}
+
+int cpu_topology_select(const cpu_topology_t *topo,
+                        thread_affinity_t mode,
+                        bool avoid_smt,
+                        int numa_node,
+                        const char *cpuset,
+                        int *out, int max) {
+    if (topo == NULL || out == NULL || max <= 0) {
+        ERROR_PRINT("Invalid arguments");
+        return -1;
+    }
+
+    if (mode == AFFINITY_NONE) {
+        return 0;
+    }
+
+    // 解析 cpuset 白名单
+    bool *allowed = (bool *)calloc(MAX_CPUS, sizeof(bool));
+    if (allowed == NULL) {
+        ERROR_PRINT("Failed to allocate cpu mask");
+        return -1;
+    }
+
+    if (mode == AFFINITY_CPUSET) {
+        if (cpuset == NULL) {
+            ERROR_PRINT("AFFINITY_CPUSET requires a cpuset list");
+            free(allowed);
+            return -1;
+        }
+        int list[MAX_CPUS];
+        int n = cpu_topology_parse_list(cpuset, list, MAX_CPUS);
+        if (n <= 0) {
+            ERROR_PRINT("Empty or invalid cpuset: \"%s\"", cpuset);
+            free(allowed);
+            return -1;
+        }
+        for (int i = 0; i < n; i ++) {
+            if (list[i] < MAX_CPUS) allowed[list[i]] = true;
+        }
+    } else {
+        for (int i = 0; i < MAX_CPUS; i ++) allowed[i] = true;
+    }
+
+    // 与进程当前允许的 CPU 取交集
+    cpu_set_t proc_mask;
+    CPU_ZERO(&proc_mask);
+    bool have_proc_mask = (sched_getaffinity(0, sizeof(proc_mask), &proc_mask) == 0);
+
+    int count = 0;
+    for (int i = 0; i < topo->num_cpus && count < max; i ++) {
+        const cpu_info_t *info = &topo->cpus[i];
+
+        if (info->cpu >= MAX_CPUS || !allowed[info->cpu]) continue;
+        if (have_proc_mask && !CPU_ISSET(info->cpu, &proc_mask)) continue;
+        if (mode == AFFINITY_NUMA_NODE && info->node_id != numa_node) continue;
+        if (avoid_smt && info->smt_index != 0) continue;
+
+        out[count ++] = info->cpu;
+    }
+    free(allowed);
+
+    if (count == 0) {
+        ERROR_PRINT("No CPU matches affinity mode %d (avoid_smt=%d, node=%d, cpuset=%s)",
+                    mode, avoid_smt, numa_node, cpuset ? cpuset : "(null)");
+        return -1;
+    }
+
+    return count;
+}
@@ -0,0 +1,370 @@
+#include "gpt2.h"
+#include "trace.h"
+
+#define GPT2_INIT_RANGE     0.02f   // 随机初始化权重的取值范围 [-r, r]
+#define GPT2_LN_EPS         1e-5f
+#define GPT2_BLOCK_PARAMS   16      // 每个 block 的参数张量数
+#define GPT2_GLOBAL_PARAMS  4       // token/position embedding 与最终 LayerNorm
+
+/* ============= 内部辅助函数 ============= */
+
+static size_t _add_shape(size_t shapes[][3], size_t count, size_t max,
+                         size_t M, size_t K, size_t N) {
+    for (size_t i = 0; i < count; i ++) {
+        if (shapes[i][0] == M && shapes[i][1] == K && shapes[i][2] == N) return count;
+    }
+    if (count >= max) return count;
+
+    shapes[count][0] = M;
+    shapes[count][1] = K;
+    shapes[count][2] = N;
+    return count + 1;
+}
+
+/**
+ * @name _gpt2_param_slots
+ * @brief 按固定顺序列出模型的全部参数槽位（不含与 token_embedding 共享的 lm_head）
+ *
+ * 顺序即权重文件中的存储顺序，gpt2_create / gpt2_free / gpt2_load_weights 共用。
+ *
+ * @param model 模型
+ * @param count 输出槽位数
+ *
+ * @return 槽位数组（调用者 free），失败返回 NULL
+ */
+static Tensor*** _gpt2_param_slots(gpt2_model_t *model, size_t *count) {
+    size_t total = GPT2_GLOBAL_PARAMS + model->cfg.num_layers * GPT2_BLOCK_PARAMS;
+    Tensor ***slots = (Tensor ***)malloc(total * sizeof(Tensor **));
+    if (slots == NULL) return NULL;
+
+    size_t n = 0;
+    slots[n ++] = &model->token_embedding;
+    slots[n ++] = &model->position_embedding;
+    for (size_t l = 0; l < model->cfg.num_layers; l ++) {
+        transformer_block_t *blk = &model->blocks[l];
+        slots[n ++] = &blk->ln1_gamma;
+        slots[n ++] = &blk->ln1_beta;
+        slots[n ++] = &blk->attn.W_Q;
+        slots[n ++] = &blk->attn.b_Q;
+        slots[n ++] = &blk->attn.W_K;
+        slots[n ++] = &blk->attn.b_K;
+        slots[n ++] = &blk->attn.W_V;
+        slots[n ++] = &blk->attn.b_V;
+        slots[n ++] = &blk->attn.W_O;
+        slots[n ++] = &blk->attn.b_O;
+        slots[n ++] = &blk->ln2_gamma;
+        slots[n ++] = &blk->ln2_beta;
+        slots[n ++] = &blk->ffn.W1;
+        slots[n ++] = &blk->ffn.b1;
+        slots[n ++] = &blk->ffn.W2;
+        slots[n ++] = &blk->ffn.b2;
+    }
+    slots[n ++] = &model->final_ln_gamma;
+    slots[n ++] = &model->final_ln_beta;
+
+    *count = n;
+    return slots;
+}
+
+static Tensor* _create_1d(size_t n, float value) {
+    size_t shape[] = {n};
+    return tensor_create_with_value(1, shape, value);
+}
+
+static Tensor* _create_random_2d(size_t rows, size_t cols) {
+    size_t shape[] = {rows, cols};
+    Tensor *t = tensor_create(2, shape);
+    if (t != NULL) tensor_fill_random(t, -GPT2_INIT_RANGE, GPT2_INIT_RANGE);
+    return t;
+}
+
+/**
+ * @name _gpt2_tie_lm_head
+ * @brief 由 token_embedding 重新生成 lm_head（权重共享，存为转置以便直接做 matmul）
+ */
+static int _gpt2_tie_lm_head(gpt2_model_t *model) {
+    Tensor *lm_head = tensor_transpose(model->token_embedding);
+    if (lm_head == NULL) return -1;
+
+    if (model->lm_head != NULL) tensor_free(model->lm_head);
+    model->lm_head = lm_head;
+    return 0;
+}
+
+/**
+ * @name _gpt2_forward_sequence
+ * @brief 单条序列的前向传播
+ *
+ * @param model   模型
+ * @param ids     token ID（以 float 存储）[seq_len]
+ * @param seq_len 序列长度
+ * @param logits  输出 logits [seq_len, vocab_size]（已按二维视图包装）
+ *
+ * @return 0 成功，-1 失败
+ */
+static int _gpt2_forward_sequence(gpt2_model_t *model, const float *ids, size_t seq_len, Tensor *logits) {
+    const gpt2_config_t *cfg = &model->cfg;
+    size_t d_model = cfg->d_model;
+
+    size_t x_shape[] = {seq_len, d_model};
+    size_t ff_shape[] = {seq_len, cfg->d_ff};
+    Tensor *x = tensor_create(2, x_shape);
+    Tensor *h = tensor_create(2, x_shape);
+    Tensor *sub = tensor_create(2, x_shape);
+    Tensor *ff = tensor_create(2, ff_shape);
+    Tensor *mask = create_causal_mask(seq_len);
+    int ret = -1;
+
+    if (x == NULL || h == NULL || sub == NULL || ff == NULL || mask == NULL) {
+        ERROR_PRINT("Failed to allocate activations");
+        goto out;
+    }
+
+    // Embedding：token + position
+    uint64_t span_start_ns = trace_now();
+    for (size_t t = 0; t < seq_len; t ++) {
+        size_t id = (size_t)ids[t];
+        if (ids[t] < 0.0f || id >= cfg->vocab_size) {
+            ERROR_PRINT("Token id %.0f out of range [0, %zu)", ids[t], cfg->vocab_size);
+            goto out;
+        }
+        const float *tok = model->token_embedding->data + id * d_model;
+        const float *pos = model->position_embedding->data + t * d_model;
+        float *dst = x->data + t * d_model;
+        for (size_t j = 0; j < d_model; j ++) {
+            dst[j] = tok[j] + pos[j];
+        }
+    }
+    trace_complete("gpt2.embed", "gpt2", span_start_ns, (int64_t)seq_len);
+
+    // Transformer blocks（pre-LN）
+    for (size_t l = 0; l < cfg->num_layers; l ++) {
+        const transformer_block_t *blk = &model->blocks[l];
+        span_start_ns = trace_now();
+
+        memcpy(h->data, x->data, x->size * sizeof(float));
+        layer_norm(h, blk->ln1_gamma, blk->ln1_beta, GPT2_LN_EPS);
+        if (attention_multi_head_parallel(h, &blk->attn, cfg->num_heads, mask, sub) != 0 ||
+            residual_add(x, sub) != 0) {
+            ERROR_PRINT("Layer %zu: attention sublayer failed", l);
+            goto out;
+        }
+
+        memcpy(h->data, x->data, x->size * sizeof(float));
+        layer_norm(h, blk->ln2_gamma, blk->ln2_beta, GPT2_LN_EPS);
+        matmul_parallel(h, blk->ffn.W1, ff);
+        if (tensor_add(ff, ff, blk->ffn.b1) != 0) {
+            ERROR_PRINT("Layer %zu: FFN b1 bias add failed", l);
+            goto out;
+        }
+        gelu(ff);
+        matmul_parallel(ff, blk->ffn.W2, sub);
+        if (tensor_add(sub, sub, blk->ffn.b2) != 0 || residual_add(x, sub) != 0) {
+            ERROR_PRINT("Layer %zu: FFN sublayer failed", l);
+            goto out;
+        }
+
+        trace_complete("gpt2.layer", "gpt2", span_start_ns, (int64_t)l);
+    }
+
+    // 最终 LayerNorm + LM head
+    span_start_ns = trace_now();
+    layer_norm(x, model->final_ln_gamma, model->final_ln_beta, GPT2_LN_EPS);
+    matmul_parallel(x, model->lm_head, logits);
+    trace_complete("gpt2.lm_head", "gpt2", span_start_ns, (int64_t)seq_len);
+    ret = 0;
+
+out:
+    if (x != NULL) tensor_free(x);
+    if (h != NULL) tensor_free(h);
+    if (sub != NULL) tensor_free(sub);
+    if (ff != NULL) tensor_free(ff);
+    if (mask != NULL) tensor_free(mask);
+    return ret;
+}
+
+/* ============= 对外接口函数 ============= */
+
+gpt2_model_t* gpt2_create(const gpt2_config_t *cfg) {
+    if (cfg == NULL || cfg->vocab_size == 0 || cfg->max_seq_len == 0 || cfg->d_model == 0 ||
+        cfg->num_heads == 0 || cfg->num_layers == 0 || cfg->d_ff == 0) {
+        ERROR_PRINT("Invalid config");
+        return NULL;
+    }
+    if (cfg->d_model % cfg->num_heads != 0) {
+        ERROR_PRINT("d_model (%zu) must be divisible by num_heads (%zu)", cfg->d_model, cfg->num_heads);
+        return NULL;
+    }
+
+    gpt2_model_t *model = (gpt2_model_t *)calloc(1, sizeof(gpt2_model_t));
+    if (model == NULL) {
+        ERROR_PRINT("Failed to allocate model");
+        return NULL;
+    }
+    model->cfg = *cfg;
+
+    model->blocks = (transformer_block_t *)calloc(cfg->num_layers, sizeof(transformer_block_t));
+    if (model->blocks == NULL) {
+        ERROR_PRINT("Failed to allocate transformer blocks");
+        free(model);
+        return NULL;
+    }
+
+    size_t d = cfg->d_model;
+    model->token_embedding = _create_random_2d(cfg->vocab_size, d);
+    model->position_embedding = _create_random_2d(cfg->max_seq_len, d);
+    for (size_t l = 0; l < cfg->num_layers; l ++) {
+        transformer_block_t *blk = &model->blocks[l];
+        blk->ln1_gamma = _create_1d(d, 1.0f);
+        blk->ln1_beta = _create_1d(d, 0.0f);
+        blk->attn.W_Q = _create_random_2d(d, d);
+        blk->attn.b_Q = _create_1d(d, 0.0f);
+        blk->attn.W_K = _create_random_2d(d, d);
+        blk->attn.b_K = _create_1d(d, 0.0f);
+        blk->attn.W_V = _create_random_2d(d, d);
+        blk->attn.b_V = _create_1d(d, 0.0f);
+        blk->attn.W_O = _create_random_2d(d, d);
+        blk->attn.b_O = _create_1d(d, 0.0f);
+        blk->ln2_gamma = _create_1d(d, 1.0f);
+        blk->ln2_beta = _create_1d(d, 0.0f);
+        blk->ffn.W1 = _create_random_2d(d, cfg->d_ff);
+        blk->ffn.b1 = _create_1d(cfg->d_ff, 0.0f);
+        blk->ffn.W2 = _create_random_2d(cfg->d_ff, d);
+        blk->ffn.b2 = _create_1d(d, 0.0f);
+    }
+    model->final_ln_gamma = _create_1d(d, 1.0f);
+    model->final_ln_beta = _create_1d(d, 0.0f);
+
+    // 检查所有参数是否分配成功
+    size_t count = 0;
+    Tensor ***slots = _gpt2_param_slots(model, &count);
+    bool ok = (slots != NULL);
+    for (size_t i = 0; ok && i < count; i ++) {
+        if (*slots[i] == NULL) ok = false;
+    }
+    free(slots);
+
+    if (!ok || _gpt2_tie_lm_head(model) != 0) {
+        ERROR_PRINT("Failed to allocate model parameters");
+        gpt2_free(model);
+        return NULL;
+    }
+
+    DEBUG_PRINT("GPT-2 created: layers=%zu, d_model=%zu, heads=%zu, vocab=%zu",
+                cfg->num_layers, d, cfg->num_heads, cfg->vocab_size);
+    return model;
+}
+
+void gpt2_free(gpt2_model_t *model) {
+    if (model == NULL) return;
+
+    if (model->blocks != NULL) {
+        size_t count = 0;
+        Tensor ***slots = _gpt2_param_slots(model, &count);
+        if (slots != NULL) {
+            for (size_t i = 0; i < count; i ++) {
+                if (*slots[i] != NULL) tensor_free(*slots[i]);
+            }
+            free(slots);
+        }
+        free(model->blocks);
+    }
+    if (model->lm_head != NULL) tensor_free(model->lm_head);
+
+    free(model);
+}
+
+int gpt2_load_weights(gpt2_model_t *model, const char *checkpoint_path) {
+    if (model == NULL || checkpoint_path == NULL) {
+        ERROR_PRINT("Invalid arguments");
+        return -1;
+    }
+
+    FILE *fp = fopen(checkpoint_path, "rb");
+    if (fp == NULL) {
+        ERROR_PRINT("Failed to open %s: %s", checkpoint_path, strerror(errno));
+        return -1;
+    }
+
+    size_t count = 0;
+    Tensor ***slots = _gpt2_param_slots(model, &count);
+    if (slots == NULL) {
+        fclose(fp);
+        return -1;
+    }
+
+    // 文件格式：按 _gpt2_param_slots 顺序紧密排列的 float32 原始数据
+    int ret = 0;
+    for (size_t i = 0; i < count; i ++) {
+        Tensor *t = *slots[i];
+        if (fread(t->data, sizeof(float), t->size, fp) != t->size) {
+            ERROR_PRINT("%s: truncated at parameter %zu", checkpoint_path, i);
+            ret = -1;
+            break;
+        }
+    }
+    if (ret == 0 && fgetc(fp) != EOF) {
+        ERROR_PRINT("%s: trailing data, config mismatch?", checkpoint_path);
+        ret = -1;
+    }
+    free(slots);
+    fclose(fp);
+
+    if (ret == 0) ret = _gpt2_tie_lm_head(model);
+    return ret;
+}
+
+int gpt2_forward(gpt2_model_t *model, const Tensor *input_ids, Tensor *output) {
+    if (model == NULL || input_ids == NULL || output == NULL) {
+        ERROR_PRINT("Invalid arguments");
+        return -1;
+    }
+
+    // input_ids 为 [seq_len] 或 [batch_size, seq_len]
+    size_t batch = (input_ids->ndim == 2) ? input_ids->shape[0] : 1;
+    size_t seq_len = input_ids->shape[input_ids->ndim - 1];
+    size_t vocab = model->cfg.vocab_size;
+
+    if (input_ids->ndim > 2 || seq_len == 0 || seq_len > model->cfg.max_seq_len) {
+        ERROR_PRINT("Invalid input_ids shape (seq_len=%zu, max=%zu)", seq_len, model->cfg.max_seq_len);
+        return -1;
+    }
+    if (output->size != batch * seq_len * vocab) {
+        ERROR_PRINT("Output size %zu does not match [%zu, %zu, %zu]", output->size, batch, seq_len, vocab);
+        return -1;
+    }
+
+    for (size_t b = 0; b < batch; b ++) {
+        // 输出的第 b 条序列包装为 [seq_len, vocab] 二维视图
+        Tensor logits = {
+            .data = output->data + b * seq_len * vocab,
+            .shape = {seq_len, vocab},
+            .stride = {vocab, 1},
+            .ndim = 2,
+            .size = seq_len * vocab,
+            .offset = 0,
+            .owns_data = false
+        };
+
+        if (_gpt2_forward_sequence(model, input_ids->data + b * seq_len, seq_len, &logits) != 0) {
+            ERROR_PRINT("Forward failed for batch %zu", b);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+size_t gpt2_gemm_shapes(const gpt2_config_t *cfg, size_t seq_len, size_t shapes[][3], size_t max) {
+    if (cfg == NULL || shapes == NULL || seq_len == 0) {
+        ERROR_PRINT("Invalid arguments");
+        return 0;
+    }
+
+    size_t count = 0;
+    count = _add_shape(shapes, count, max, seq_len, cfg->d_model, cfg->d_model);     // Q/K/V/O 投影
+    count = _add_shape(shapes, count, max, seq_len, cfg->d_model, cfg->d_ff);        // FFN 第一层
+    count = _add_shape(shapes, count, max, seq_len, cfg->d_ff, cfg->d_model);        // FFN 第二层
+    count = _add_shape(shapes, count, max, seq_len, cfg->d_model, cfg->vocab_size);  // LM head
+    return count;
+}
@@ -0,0 +1,424 @@
+#define _GNU_SOURCE
+#include "matrix_autotune.h"
+#include <time.h>
+#include <math.h>
+
+#define CPU_MODEL_MAX       128
+#define TUNE_LINE_MAX       512
+#define TUNE_MIN_RUNS       3       // 每个候选至少计时的次数
+#define TUNE_MAX_RUNS       10      // 每个候选最多计时的次数
+#define TUNE_MIN_TIME_NS    (50ull * 1000000ull)   // 达到最少次数后，累计超过此时间即停止
+#define TUNE_TOLERANCE      1e-3f   // 候选结果与参考结果的最大允许误差
+
+static const size_t g_block_candidates[] = {16, 32, 64, 128};
+
+static const char *g_kernel_names[] = {"row", "blocked"};
+static const char *g_schedule_names[] = {"static", "dynamic", "guided"};
+
+/* 调优表（线性查找：GPT-2 一个配置只有十个左右的 GEMM 形状） */
+static matmul_tune_entry_t *g_tune_table = NULL;
+static size_t g_tune_count = 0;
+static size_t g_tune_capacity = 0;
+
+/* ============= 内部辅助函数 ============= */
+
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int _name_index(const char *name, const char **names, int count) {
+    for (int i = 0; i < count; i ++) {
+        if (strcmp(name, names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * @name _time_plan
+ * @brief 测量执行方案的耗时（预热一次后取多次运行的最短时间）
+ *
+ * @return 最短耗时（毫秒）
+ */
+static double _time_plan(const Tensor *A, const Tensor *B, Tensor *C, const matmul_plan_t *plan) {
+    matmul_parallel_plan(A, B, C, plan);
+
+    uint64_t best_ns = UINT64_MAX;
+    uint64_t total_ns = 0;
+    for (int run = 0; run < TUNE_MAX_RUNS; run ++) {
+        uint64_t start = _now_ns();
+        matmul_parallel_plan(A, B, C, plan);
+        uint64_t elapsed = _now_ns() - start;
+
+        best_ns = MIN(best_ns, elapsed);
+        total_ns += elapsed;
+        if (run + 1 >= TUNE_MIN_RUNS && total_ns >= TUNE_MIN_TIME_NS) break;
+    }
+
+    return best_ns / 1e6;
+}
+
+static bool _results_match(const Tensor *x, const Tensor *y) {
+    for (size_t i = 0; i < x->size; i ++) {
+        if (fabsf(x->data[i] - y->data[i]) > TUNE_TOLERANCE) return false;
+    }
+    return true;
+}
+
+/**
+ * @name _try_candidate
+ * @brief 计时一个候选方案，结果正确且更快时更新 best
+ */
+static void _try_candidate(const Tensor *A, const Tensor *B, Tensor *C, const Tensor *ref,
+                           const matmul_plan_t *plan, matmul_plan_t *best, double *best_ms) {
+    double ms = _time_plan(A, B, C, plan);
+
+    if (!_results_match(C, ref)) {
+        ERROR_PRINT("Candidate %s/t%d/b%zu/%s produced wrong result, skipped",
+                    g_kernel_names[plan->kernel], plan->num_threads, plan->block_size,
+                    g_schedule_names[plan->schedule]);
+        return;
+    }
+
+    DEBUG_PRINT("  %-7s threads=%-2d block=%-3zu %-7s %.3f ms",
+                g_kernel_names[plan->kernel], plan->num_threads, plan->block_size,
+                g_schedule_names[plan->schedule], ms);
+
+    if (ms < *best_ms) {
+        *best_ms = ms;
+        *best = *plan;
+    }
+}
+
+/* ============= 对外接口函数 ============= */
+
+int matmul_autotune_cpu_model(char *buf, size_t size) {
+    if (buf == NULL || size == 0) {
+        ERROR_PRINT("Invalid arguments");
+        return -1;
+    }
+    snprintf(buf, size, "unknown");
+
+    FILE *fp = fopen("/proc/cpuinfo", "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    // x86 为 "model name"，部分 ARM 内核只有 "CPU implementer" / "CPU part"
+    char line[TUNE_LINE_MAX];
+    char implementer[32] = "";
+    char part[32] = "";
+    int found = -1;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char *colon = strchr(line, ':');
+        if (colon == NULL) continue;
+
+        char *value = colon + 1;
+        while (*value == ' ' || *value == '\t') value ++;
+        value[strcspn(value, "\n")] = '\0';
+
+        if (strncmp(line, "model name", 10) == 0) {
+            snprintf(buf, size, "%s", value);
+            found = 0;
+            break;
+        } else if (strncmp(line, "CPU implementer", 15) == 0 && implementer[0] == '\0') {
+            snprintf(implementer, sizeof(implementer), "%s", value);
+        } else if (strncmp(line, "CPU part", 8) == 0 && part[0] == '\0') {
+            snprintf(part, sizeof(part), "%s", value);
+        }
+    }
+    fclose(fp);
+
+    if (found != 0 && implementer[0] != '\0') {
+        snprintf(buf, size, "arm-%s-%s", implementer, part);
+        found = 0;
+    }
+
+    // 型号作为文件的第一列，不能包含制表符
+    for (char *p = buf; *p != '\0'; p ++) {
+        if (*p == '\t') *p = ' ';
+    }
+
+    return found;
+}
+
+int matmul_autotune_shape(size_t M, size_t K, size_t N, matmul_tune_entry_t *best) {
+    thread_pool_t *pool = matrix_get_thread_pool();
+    if (pool == NULL) {
+        ERROR_PRINT("Matrix library not initialized");
+        return -1;
+    }
+    if (M == 0 || K == 0 || N == 0) {
+        ERROR_PRINT("Invalid shape [%zu x %zu] @ [%zu x %zu]", M, K, K, N);
+        return -1;
+    }
+
+    size_t a_shape[] = {M, K};
+    size_t b_shape[] = {K, N};
+    size_t c_shape[] = {M, N};
+    Tensor *A = tensor_create(2, a_shape);
+    Tensor *B = tensor_create(2, b_shape);
+    Tensor *C = tensor_create(2, c_shape);
+    Tensor *ref = tensor_create(2, c_shape);
+    if (A == NULL || B == NULL || C == NULL || ref == NULL) {
+        ERROR_PRINT("Failed to allocate tuning tensors");
+        tensor_free(A);
+        tensor_free(B);
+        tensor_free(C);
+        tensor_free(ref);
+        return -1;
+    }
+    tensor_fill_random(A, -1.0f, 1.0f);
+    tensor_fill_random(B, -1.0f, 1.0f);
+
+    int max_threads = pool->num_threads;
+
+    // 参考结果：默认方案
+    matmul_plan_t base;
+    matmul_default_plan(&base);
+    base.num_threads = max_threads;
+    matmul_parallel_plan(A, B, ref, &base);
+
+    matmul_plan_t best_plan = base;
+    double best_ms = INFINITY;
+
+    // 第一步：计算核与分块大小
+    matmul_plan_t plan = base;
+    plan.schedule = MATMUL_SCHED_STATIC;
+    plan.grain = 0;
+    plan.kernel = MATMUL_KERNEL_ROW;
+    _try_candidate(A, B, C, ref, &plan, &best_plan, &best_ms);
+
+    plan.kernel = MATMUL_KERNEL_BLOCKED;
+    for (size_t i = 0; i < ARRAY_SIZE(g_block_candidates); i ++) {
+        plan.block_size = g_block_candidates[i];
+        _try_candidate(A, B, C, ref, &plan, &best_plan, &best_ms);
+    }
+
+    // 第二步：线程数与调度策略
+    plan = best_plan;
+    for (int threads = 1; ; threads = MIN(threads * 2, max_threads)) {
+        for (int sched = MATMUL_SCHED_STATIC; sched <= MATMUL_SCHED_GUIDED; sched ++) {
+            if (threads == max_threads && sched == MATMUL_SCHED_STATIC) {
+                continue;   // 第一步已经测过
+            }
+            plan.num_threads = threads;
+            plan.schedule = (matmul_schedule_t)sched;
+            _try_candidate(A, B, C, ref, &plan, &best_plan, &best_ms);
+        }
+        if (threads == max_threads) break;
+    }
+
+    tensor_free(A);
+    tensor_free(B);
+    tensor_free(C);
+    tensor_free(ref);
+
+    if (isinf(best_ms)) {
+        ERROR_PRINT("No valid candidate for [%zu x %zu] @ [%zu x %zu]", M, K, K, N);
+        return -1;
+    }
+
+    matmul_tune_entry_t entry = {
+        .M = M,
+        .K = K,
+        .N = N,
+        .plan = best_plan,
+        .time_ms = best_ms
+    };
+    if (matmul_autotune_record(&entry) != 0) {
+        return -1;
+    }
+
+    INFO_PRINT("Tuned [%zu x %zu] @ [%zu x %zu]: %s threads=%d block=%zu %s (%.3f ms, %.2f GFLOPS)",
+               M, K, K, N, g_kernel_names[best_plan.kernel], best_plan.num_threads,
+               best_plan.block_size, g_schedule_names[best_plan.schedule], best_ms,
+               2.0 * M * N * K / (best_ms * 1e6));
+
+    if (best != NULL) *best = entry;
+    return 0;
+}
+
+int matmul_autotune_record(const matmul_tune_entry_t *entry) {
+    if (entry == NULL) {
+        ERROR_PRINT("Invalid arguments");
+        return -1;
+    }
+
+    for (size_t i = 0; i < g_tune_count; i ++) {
+        matmul_tune_entry_t *e = &g_tune_table[i];
+        if (e->M == entry->M && e->K == entry->K && e->N == entry->N) {
+            *e = *entry;
+            return 0;
+        }
+    }
+
+    if (g_tune_count == g_tune_capacity) {
+        size_t new_capacity = g_tune_capacity == 0 ? 16 : g_tune_capacity * 2;
+        matmul_tune_entry_t *table = (matmul_tune_entry_t *)realloc(
+            g_tune_table, new_capacity * sizeof(matmul_tune_entry_t));
+        if (table == NULL) {
+            ERROR_PRINT("Failed to grow autotune table");
+            return -1;
+        }
+        g_tune_table = table;
+        g_tune_capacity = new_capacity;
+    }
+
+    g_tune_table[g_tune_count ++] = *entry;
+    return 0;
+}
+
+const matmul_plan_t* matmul_autotune_lookup(size_t M, size_t K, size_t N) {
+    for (size_t i = 0; i < g_tune_count; i ++) {
+        const matmul_tune_entry_t *e = &g_tune_table[i];
+        if (e->M == M && e->K == K && e->N == N) {
+            return &e->plan;
+        }
+    }
+    return NULL;
+}
+
+size_t matmul_autotune_count(void) {
+    return g_tune_count;
+}
+
+void matmul_autotune_clear(void) {
+    free(g_tune_table);
+    g_tune_table = NULL;
+    g_tune_count = 0;
+    g_tune_capacity = 0;
+}
+
+int matmul_autotune_load(const char *path) {
+    if (path == NULL) {
+        ERROR_PRINT("Invalid cache path");
+        return -1;
+    }
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        if (errno == ENOENT) {
+            INFO_PRINT("Autotune cache %s not found, using default plans", path);
+            return 0;
+        }
+        ERROR_PRINT("Failed to open autotune cache %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    char model[CPU_MODEL_MAX];
+    matmul_autotune_cpu_model(model, sizeof(model));
+
+    char line[TUNE_LINE_MAX];
+    int loaded = 0;
+    int line_no = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_no ++;
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0') continue;
+
+        char *fields[10];
+        int nfields = 0;
+        char *save = NULL;
+        for (char *tok = strtok_r(line, "\t", &save); tok != NULL && nfields < 10;
+             tok = strtok_r(NULL, "\t", &save)) {
+            fields[nfields ++] = tok;
+        }
+        if (nfields != 10) {
+            WARN_PRINT("%s:%d: expected 10 fields, got %d", path, line_no, nfields);
+            continue;
+        }
+        if (strcmp(fields[0], model) != 0) continue;
+
+        int kernel = _name_index(fields[4], g_kernel_names, (int)ARRAY_SIZE(g_kernel_names));
+        int sched = _name_index(fields[7], g_schedule_names, (int)ARRAY_SIZE(g_schedule_names));
+        matmul_tune_entry_t entry = {
+            .M = strtoul(fields[1], NULL, 10),
+            .K = strtoul(fields[2], NULL, 10),
+            .N = strtoul(fields[3], NULL, 10),
+            .plan = {
+                .kernel = (matmul_kernel_t)kernel,
+                .num_threads = atoi(fields[5]),
+                .block_size = strtoul(fields[6], NULL, 10),
+                .schedule = (matmul_schedule_t)sched,
+                .grain = strtoul(fields[8], NULL, 10)
+            },
+            .time_ms = atof(fields[9])
+        };
+        if (kernel < 0 || sched < 0 || entry.M == 0 || entry.K == 0 || entry.N == 0
+            || entry.plan.num_threads <= 0) {
+            WARN_PRINT("%s:%d: malformed entry skipped", path, line_no);
+            continue;
+        }
+
+        if (matmul_autotune_record(&entry) != 0) {
+            fclose(fp);
+            return -1;
+        }
+        loaded ++;
+    }
+    fclose(fp);
+
+    INFO_PRINT("Loaded %d autotuned matmul plans for \"%s\" from %s", loaded, model, path);
+    return loaded;
+}
+
+int matmul_autotune_save(const char *path) {
+    if (path == NULL) {
+        ERROR_PRINT("Invalid cache path");
+        return -1;
+    }
+
+    char model[CPU_MODEL_MAX];
+    matmul_autotune_cpu_model(model, sizeof(model));
+
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *out = fopen(tmp_path, "w");
+    if (out == NULL) {
+        ERROR_PRINT("Failed to open %s: %s", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(out, "# matmul autotune cache\n");
+    fprintf(out, "# cpu_model\tM\tK\tN\tkernel\tthreads\tblock\tschedule\tgrain\ttime_ms\n");
+
+    // 保留其它 CPU 型号的表项
+    FILE *in = fopen(path, "r");
+    if (in != NULL) {
+        char line[TUNE_LINE_MAX];
+        size_t model_len = strlen(model);
+        while (fgets(line, sizeof(line), in) != NULL) {
+            if (line[0] == '#' || line[0] == '\n') continue;
+            if (strncmp(line, model, model_len) == 0 && line[model_len] == '\t') continue;
+            fputs(line, out);
+        }
+        fclose(in);
+    }
+
+    for (size_t i = 0; i < g_tune_count; i ++) {
+        const matmul_tune_entry_t *e = &g_tune_table[i];
+        fprintf(out, "%s\t%zu\t%zu\t%zu\t%s\t%d\t%zu\t%s\t%zu\t%.4f\n",
+                model, e->M, e->K, e->N,
+                g_kernel_names[e->plan.kernel], e->plan.num_threads, e->plan.block_size,
+                g_schedule_names[e->plan.schedule], e->plan.grain, e->time_ms);
+    }
+
+    if (fclose(out) != 0) {
+        ERROR_PRINT("Failed to write %s: %s", tmp_path, strerror(errno));
+        remove(tmp_path);
+        return -1;
+    }
+
+    // 先写临时文件再 rename，避免并发读取到半个文件
+    if (rename(tmp_path, path) != 0) {
+        ERROR_PRINT("Failed to rename %s to %s: %s", tmp_path, path, strerror(errno));
+        remove(tmp_path);
+        return -1;
+    }
+
+    INFO_PRINT("Saved %zu autotuned matmul plans for \"%s\" to %s", g_tune_count, model, path);
+    return 0;
+}
@@ -1,12 +1,15 @@
 #include "matrix_parallel.h"
-#include <sys/time.h>
+#include "matrix_autotune.h"
+#include "trace.h"
 
 // 并行化阈值：小于此值使用串行版本
 #define PARALLEL_THRESHOLD (64 * 64 * 64)   // M * K * N 的乘积阈值
 #define MIN_ROWS_PER_TASK 4                 // 每个任务最少处理的行数
+#define MIN_COLS_PER_TILE 16                // 2D 分块时列条的最小宽度（一个 cache line 的 float 数），列条宽度取其整数倍
 
 static matrix_config_t g_matrix_cfg;
 static thread_pool_t *g_thread_pool = NULL;
+static const char *g_trace_path = NULL;     // GPT2_TRACE 指定的导出路径
 
 int matrix_init(const matrix_config_t *cfg) {
     if (cfg == NULL) {
@@ -18,12 +21,22 @@ int matrix_init(const matrix_config_t *cfg) {
                cfg->num_threads, cfg->block_size);
     g_matrix_cfg = *cfg;
 
+    // 通过环境变量开启追踪，matrix_cleanup 时导出
+    g_trace_path = getenv("GPT2_TRACE");
+    if (g_trace_path != NULL && g_trace_path[0] != '\0' && !trace_enabled()) {
+        trace_start(0);
+    }
+
     // 初始化线程池
     thread_pool_cfg_t pool_cfg = {
         .num_threads = cfg->num_threads,
         .queue_size = 1024,
         .stack_size = 0,
-        .daemon_threads = false
+        .daemon_threads = false,
+        .affinity = cfg->affinity,
+        .avoid_smt = cfg->avoid_smt,
+        .numa_node = cfg->numa_node,
+        .cpuset = cfg->cpuset
     };
     g_thread_pool = thread_pool_create(&pool_cfg);
     if (g_thread_pool == NULL) {
@@ -31,6 +44,14 @@ int matrix_init(const matrix_config_t *cfg) {
         return -1;
     }
 
+    // 加载自动调优结果（缓存不存在时使用配置中的默认方案）
+    const char *tune_cache = cfg->tune_cache != NULL ? cfg->tune_cache : getenv("GPT2_TUNE_CACHE");
+    if (tune_cache != NULL && tune_cache[0] != '\0') {
+        if (matmul_autotune_load(tune_cache) < 0) {
+            WARN_PRINT("Ignoring autotune cache %s", tune_cache);
+        }
+    }
+
     INFO_PRINT("Matrix library initialized successfully");
     return 0;
 }
@@ -44,6 +65,15 @@ void matrix_cleanup(void) {
     thread_pool_destroy(g_thread_pool);
     g_thread_pool = NULL;
 
+    matmul_autotune_clear();
+
+    if (g_trace_path != NULL && g_trace_path[0] != '\0') {
+        trace_stop();
+        trace_export_chrome(g_trace_path);
+        trace_reset();
+        g_trace_path = NULL;
+    }
+
     INFO_PRINT("Matrix library cleaned up successfully");
 }
 
@@ -141,46 +171,279 @@ void matmul_serial_blocked(const Tensor *A, const Tensor *B, Tensor *C) {
 }
 
 /**
- * 行分块任务参数
+ * 子矩阵计算核：C[row_start:row_end, col_start:col_end] += A[rows, :] @ B[:, cols]
+ */
+typedef void (*matmul_kernel_fn)(const Tensor *A, const Tensor *B, Tensor *C,
+                                 size_t row_start, size_t row_end,
+                                 size_t col_start, size_t col_end,
+                                 size_t block_size);
+
+/**
+ * 并行调度上下文（同一次矩阵乘法的所有任务共享，生命周期覆盖 thread_pool_wait_all）
+ *
+ * 工作空间为 num_col_tiles 个列条 × M 行，展平成 [0, total) 的线性区间：
+ * 位置 p 对应第 p / M 个列条的第 p % M 行，领取的块不会跨越列条边界。
+ * M >= 线程数时只有一个列条，退化为普通的行分块。
  */
 typedef struct {
     const Tensor *A;
     const Tensor *B;
     Tensor *C;
-    size_t row_start;
-    size_t row_end;
+    matmul_kernel_fn kernel;
+    const char *trace_name;
+    matmul_schedule_t schedule;
+    size_t block_size;      // MATMUL_KERNEL_BLOCKED 的分块大小
+    size_t M;
+    size_t N;
+    size_t col_tile;        // 列条宽度
+    size_t total;           // num_col_tiles * M
+    size_t grain;           // 每次领取的最少行数
+    size_t num_workers;     // DYNAMIC / GUIDED 下的领取线程数
+    size_t next;            // 下一个待领取的位置（原子访问）
+} matmul_sched_t;
+
+/**
+ * 行分块任务参数
+ */
+typedef struct {
+    matmul_sched_t *sched;
+    size_t start;           // STATIC：固定区间 [start, end)
+    size_t end;
     int thread_id;
 } matmul_row_task_t;
 
 
-static void matmul_row_task(void* arg) {
+static const char* _schedule_name(matmul_schedule_t schedule) {
+    switch (schedule) {
+        case MATMUL_SCHED_DYNAMIC: return "dynamic";
+        case MATMUL_SCHED_GUIDED:  return "guided";
+        default:                   return "static";
+    }
+}
+
+/**
+ * @name _matmul_claim
+ * @brief 无锁领取下一个块（DYNAMIC / GUIDED）
+ *
+ * @return 领取成功返回 true，工作空间耗尽返回 false
+ */
+static bool _matmul_claim(matmul_sched_t *s, size_t *start, size_t *end) {
+    size_t pos = __atomic_load_n(&s->next, __ATOMIC_RELAXED);
+
+    for (;;) {
+        if (pos >= s->total) return false;
+
+        size_t chunk = s->grain;
+        if (s->schedule == MATMUL_SCHED_GUIDED) {
+            chunk = MAX(s->grain, (s->total - pos) / (2 * s->num_workers));
+        }
+        size_t tile_end = (pos / s->M + 1) * s->M;
+        size_t stop = MIN(pos + chunk, tile_end);
+
+        // 失败时 pos 被更新为最新值，重新计算块大小
+        if (__atomic_compare_exchange_n(&s->next, &pos, stop, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            *start = pos;
+            *end = stop;
+            return true;
+        }
+    }
+}
+
+static void _matmul_run_range(matmul_sched_t *s, size_t start, size_t end) {
+    size_t tile = start / s->M;
+    size_t row_start = start - tile * s->M;
+    size_t row_end = end - tile * s->M;
+    size_t col_start = tile * s->col_tile;
+    size_t col_end = MIN(col_start + s->col_tile, s->N);
+
+    uint64_t trace_start_ns = trace_now();
+
+    s->kernel(s->A, s->B, s->C, row_start, row_end, col_start, col_end, s->block_size);
+
+    trace_complete(s->trace_name, "matmul", trace_start_ns, (int64_t)row_start);
+}
+
+static void matmul_sched_task(void* arg) {
     matmul_row_task_t *task = (matmul_row_task_t *)arg;
+    matmul_sched_t *s = task->sched;
+
+    if (s->schedule == MATMUL_SCHED_STATIC) {
+        DEBUG_PRINT("Thread %d: Computing range [%zu, %zu)",
+                    task->thread_id, task->start, task->end);
+        _matmul_run_range(s, task->start, task->end);
+    } else {
+        size_t start, end;
+        size_t chunks = 0;
+        while (_matmul_claim(s, &start, &end)) {
+            _matmul_run_range(s, start, end);
+            chunks ++;
+        }
+        DEBUG_PRINT("Thread %d: Claimed %zu chunks", task->thread_id, chunks);
+    }
 
-    size_t K = task->A->shape[1];
-    size_t N = task->B->shape[1];
+    free(task);
+}
 
-    DEBUG_PRINT("Thread %d: Computing rows [%zu, %zu)",
-                task->thread_id, task->row_start, task->row_end);
+static void _matmul_kernel_row(const Tensor *A, const Tensor *B, Tensor *C,
+                               size_t row_start, size_t row_end,
+                               size_t col_start, size_t col_end,
+                               size_t block_size) {
+    (void)block_size;
 
-    struct timeval start, end;
-    gettimeofday(&start, NULL);
+    size_t K = A->shape[1];
+    size_t N = B->shape[1];
 
-    for (size_t i = task->row_start; i < task->row_end; i ++) {
+    for (size_t i = row_start; i < row_end; i ++) {
         for (size_t k = 0; k < K; k ++) {
-            float a_ik = task->A->data[i*K + k];
-            for (size_t j = 0; j < N; j ++) {
-                task->C->data[i*N + j] += a_ik*task->B->data[k*N + j];
+            float a_ik = A->data[i*K + k];
+            for (size_t j = col_start; j < col_end; j ++) {
+                C->data[i*N + j] += a_ik*B->data[k*N + j];
             }
         }
     }
+}
 
-    gettimeofday(&end, NULL);
-    double elapsed = (end.tv_sec - start.tv_sec) * 1000.0 +
-                     (end.tv_usec - start.tv_usec) / 1000.0;
+static void _matmul_kernel_blocked(const Tensor *A, const Tensor *B, Tensor *C,
+                                   size_t row_start, size_t row_end,
+                                   size_t col_start, size_t col_end,
+                                   size_t block_size) {
+    size_t K = A->shape[1];
+    size_t N = B->shape[1];
 
-    DEBUG_PRINT("Thread %d: Completed in %.2f ms", task->thread_id, elapsed);
+    // 分块计算
+    for (size_t ii = row_start; ii < row_end; ii += block_size) {
+        for (size_t kk = 0; kk < K; kk += block_size) {
+            for (size_t jj = col_start; jj < col_end; jj += block_size) {
+                // 计算块边界
+                size_t i_end = MIN(ii + block_size, row_end);
+                size_t k_end = MIN(kk + block_size, K);
+                size_t j_end = MIN(jj + block_size, col_end);
 
-    free(task);
+                for (size_t i = ii; i < i_end; i ++) {
+                    for (size_t k = kk; k < k_end; k ++) {
+                        float a_ik = A->data[i*K + k];  // 修复: i*k -> i*K
+                        for (size_t j = jj; j < j_end; j ++) {
+                            C->data[i*N + j] += a_ik*B->data[k*N + j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @name _matmul_parallel_dispatch
+ * @brief 按执行方案把矩阵乘法切块并提交到线程池，等待完成
+ *
+ * @param plan 执行方案（线程数会被截断到线程池大小）
+ *
+ * @return 提交的任务数
+ */
+static int _matmul_parallel_dispatch(const Tensor *A, const Tensor *B, Tensor *C,
+                                     const matmul_plan_t *plan) {
+    size_t M = A->shape[0];
+    size_t N = B->shape[1];
+    size_t num_threads = (size_t)MAX(MIN(plan->num_threads, g_thread_pool->num_threads), 1);
+
+    memset(C->data, 0, C->size * sizeof(float));
+    if (M == 0 || N == 0) return 0;
+
+    // 行数不足以喂饱所有线程时，沿 N 切列条，宽度取 cache line 的整数倍
+    // 仅当 N % 16 == 0 时列条边界才落在 cache line 边界上（C->data 按 64 字节对齐）；
+    // 否则每个边界在每行最多与相邻列条共享一条 cache line
+    size_t num_col_tiles = 1;
+    if (M < num_threads) {
+        num_col_tiles = MIN((num_threads + M - 1) / M, MAX(N / MIN_COLS_PER_TILE, 1));
+    }
+    size_t col_tile = (N + num_col_tiles - 1) / num_col_tiles;
+    col_tile = (col_tile + MIN_COLS_PER_TILE - 1) / MIN_COLS_PER_TILE * MIN_COLS_PER_TILE;
+    num_col_tiles = (N + col_tile - 1) / col_tile;
+
+    size_t min_rows = num_col_tiles > 1 ? 1 : MIN_ROWS_PER_TASK;
+
+    matmul_sched_t sched = {
+        .A = A,
+        .B = B,
+        .C = C,
+        .kernel = plan->kernel == MATMUL_KERNEL_BLOCKED ? _matmul_kernel_blocked
+                                                        : _matmul_kernel_row,
+        .trace_name = plan->kernel == MATMUL_KERNEL_BLOCKED ? "matmul_blocked_task"
+                                                            : "matmul_row_task",
+        .schedule = plan->schedule,
+        .block_size = MAX(plan->block_size, 1),
+        .M = M,
+        .N = N,
+        .col_tile = col_tile,
+        .total = num_col_tiles * M,
+        .next = 0
+    };
+
+    if (plan->grain > 0) {
+        sched.grain = plan->grain;
+    } else if (sched.schedule == MATMUL_SCHED_DYNAMIC) {
+        // 每个线程约领取 4 次，在调度开销与负载均衡之间折中
+        sched.grain = MAX(min_rows, M / (num_threads * 4));
+    } else {
+        sched.grain = min_rows;
+    }
+
+    DEBUG_PRINT("Schedule %s: %zu col tiles x %zu rows, col_tile=%zu, grain=%zu",
+                _schedule_name(sched.schedule), num_col_tiles, M, col_tile, sched.grain);
+
+    int tasks_submitted = 0;
+
+    if (sched.schedule == MATMUL_SCHED_STATIC) {
+        // 提交前均分：每个任务一个固定区间（粒度优化）
+        size_t chunk = (sched.total + num_threads - 1) / num_threads;
+        chunk = MAX(min_rows, chunk);
+
+        for (size_t pos = 0; pos < sched.total; ) {
+            size_t tile_end = (pos / M + 1) * M;
+            size_t stop = MIN(pos + chunk, tile_end);
+
+            matmul_row_task_t *task = (matmul_row_task_t *)malloc(sizeof(matmul_row_task_t));
+            ASSERT(task != NULL, "Failed to allocate task");
+
+            task->sched = &sched;
+            task->start = pos;
+            task->end = stop;
+            task->thread_id = tasks_submitted;
+
+            int ret = thread_pool_submit(g_thread_pool, matmul_sched_task, (void *)task, NULL);
+            ASSERT(ret == 0, "Failed to submit task to thread pool");
+
+            tasks_submitted ++;
+            pos = stop;
+        }
+    } else {
+        // 每个线程一个领取循环，块由原子计数器按需分配
+        size_t max_chunks = (sched.total + sched.grain - 1) / sched.grain;
+        sched.num_workers = MIN(num_threads, max_chunks);
+
+        for (size_t w = 0; w < sched.num_workers; w ++) {
+            matmul_row_task_t *task = (matmul_row_task_t *)malloc(sizeof(matmul_row_task_t));
+            ASSERT(task != NULL, "Failed to allocate task");
+
+            task->sched = &sched;
+            task->start = 0;
+            task->end = 0;
+            task->thread_id = tasks_submitted;
+
+            int ret = thread_pool_submit(g_thread_pool, matmul_sched_task, (void *)task, NULL);
+            ASSERT(ret == 0, "Failed to submit task to thread pool");
+
+            tasks_submitted ++;
+        }
+    }
+
+    DEBUG_PRINT("Submitted %d tasks to thread pool", tasks_submitted);
+
+    // 等待所有任务完成（sched 位于本函数栈上，必须在返回前完成）
+    thread_pool_wait_all(g_thread_pool);
+
+    return tasks_submitted;
 }
 
 void matmul_parallel_row(const Tensor *A, const Tensor *B, Tensor *C) {
@@ -202,82 +465,21 @@ void matmul_parallel_row(const Tensor *A, const Tensor *B, Tensor *C) {
     //     return;
     // }
 
-    INFO_PRINT("Parallel row-wise matmul: [%zu x %zu] @ [%zu x %zu] (threads: %d)",
-                M, K, K, N, g_matrix_cfg.num_threads);
-
-    memset(C->data, 0, C->size * sizeof(float));
+    INFO_PRINT("Parallel row-wise matmul: [%zu x %zu] @ [%zu x %zu] (threads: %d, schedule: %s)",
+                M, K, K, N, g_matrix_cfg.num_threads, _schedule_name(g_matrix_cfg.schedule));
 
-    int num_threads = g_matrix_cfg.num_threads;
-
-    // 计算每个线程处理的行数（粒度优化）
-    size_t rows_per_thread = (M + num_threads - 1) / num_threads;
-    rows_per_thread = MAX(MIN_ROWS_PER_TASK, rows_per_thread);
-
-    DEBUG_PRINT("Rows per thread: %zu", rows_per_thread);
-
-    // 提交任务到线程池
-    int tasks_submitted = 0;
-    for (size_t start = 0; start < M; start += rows_per_thread) {
-        size_t end = MIN(start + rows_per_thread, M);
-        
-        matmul_row_task_t *task = (matmul_row_task_t *)malloc(sizeof(matmul_row_task_t));
-        ASSERT(task != NULL, "Failed to allocate task");
-
-        task->A = A;
-        task->B = B;
-        task->C = C;
-        task->row_start = start;
-        task->row_end = end;
-        task->thread_id = tasks_submitted;
-
-        int ret = thread_pool_submit(g_thread_pool, matmul_row_task, (void *)task, NULL);
-        ASSERT(ret == 0, "Failed to submit task to thread pool");
-
-        tasks_submitted ++;
-    }
+    uint64_t trace_start_ns = trace_now();
 
-    DEBUG_PRINT("Submitted %d tasks to thread pool", tasks_submitted);
+    matmul_plan_t plan;
+    matmul_default_plan(&plan);
+    plan.kernel = MATMUL_KERNEL_ROW;
+    _matmul_parallel_dispatch(A, B, C, &plan);
 
-    // 等待所有任务完成
-    thread_pool_wait_all(g_thread_pool);
+    trace_complete("matmul_parallel_row", "matmul", trace_start_ns, (int64_t)M);
 
     INFO_PRINT("Parallel matmul completed");
 }
 
-static void matmul_blocked_task(void* arg) {
-    matmul_row_task_t *task = (matmul_row_task_t *)arg;
-
-    size_t K = task->A->shape[1];
-    size_t N = task->B->shape[1];
-    size_t block_size = g_matrix_cfg.block_size;
-    
-    DEBUG_PRINT("Thread %d: Computing rows [%zu, %zu) with block_size %zu",
-                task->thread_id, task->row_start, task->row_end, block_size);
-
-    // 分块计算
-    for (size_t ii = task->row_start; ii < task->row_end; ii += block_size) {
-        for (size_t kk = 0; kk < K; kk += block_size) {
-            for (size_t jj = 0; jj < N; jj += block_size) {
-                // 计算块边界
-                size_t i_end = MIN(ii + block_size, task->row_end);
-                size_t k_end = MIN(kk + block_size, K);
-                size_t j_end = MIN(jj + block_size, N);
-
-                for (size_t i = ii; i < i_end; i ++) {
-                    for (size_t k = kk; k < k_end; k ++) {
-                        float a_ik = task->A->data[i*K + k];  // 修复: i*k -> i*K
-                        for (size_t j = jj; j < j_end; j ++) {
-                            task->C->data[i*N + j] += a_ik*task->B->data[k*N + j];
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    free(task);
-}
-
 void matmul_parallel_blocked(const Tensor *A, const Tensor *B, Tensor *C) {
     ASSERT(A != NULL && B != NULL && C != NULL, "NULL tensor");
     ASSERT(A->ndim == 2 && B->ndim == 2 && C->ndim == 2, "Must be 2D");
@@ -297,46 +499,60 @@ void matmul_parallel_blocked(const Tensor *A, const Tensor *B, Tensor *C) {
     //     return;
     // }
 
-    INFO_PRINT("Parallel blocked matmul: [%zu x %zu] @ [%zu x %zu] (threads: %d, block_size: %zu)",
-                M, K, K, N, g_matrix_cfg.num_threads, g_matrix_cfg.block_size);
+    INFO_PRINT("Parallel blocked matmul: [%zu x %zu] @ [%zu x %zu] (threads: %d, block_size: %zu, schedule: %s)",
+                M, K, K, N, g_matrix_cfg.num_threads, g_matrix_cfg.block_size,
+                _schedule_name(g_matrix_cfg.schedule));
 
-    memset(C->data, 0, C->size * sizeof(float));
+    uint64_t trace_start_ns = trace_now();
 
-    int num_threads = g_matrix_cfg.num_threads;
+    matmul_plan_t plan;
+    matmul_default_plan(&plan);
+    plan.kernel = MATMUL_KERNEL_BLOCKED;
+    _matmul_parallel_dispatch(A, B, C, &plan);
 
-    // 计算每个线程处理的行数（粒度优化）
-    size_t rows_per_thread = (M + num_threads - 1) / num_threads;
-    rows_per_thread = MAX(MIN_ROWS_PER_TASK, rows_per_thread);
+    trace_complete("matmul_parallel_blocked", "matmul", trace_start_ns, (int64_t)M);
 
-    DEBUG_PRINT("Rows per thread: %zu", rows_per_thread);
+    INFO_PRINT("Parallel blocked matmul completed");
+}
 
-    // 提交任务到线程池
-    int tasks_submitted = 0;
-    for (size_t start = 0; start < M; start += rows_per_thread) {
-        size_t end = MIN(start + rows_per_thread, M);
-        
-        matmul_row_task_t *task = (matmul_row_task_t *)malloc(sizeof(matmul_row_task_t));
-        ASSERT(task != NULL, "Failed to allocate task");
-
-        task->A = A;
-        task->B = B;
-        task->C = C;
-        task->row_start = start;
-        task->row_end = end;
-        task->thread_id = tasks_submitted;
-
-        int ret = thread_pool_submit(g_thread_pool, matmul_blocked_task, (void *)task, NULL);
-        ASSERT(ret == 0, "Failed to submit task to thread pool");
-
-        tasks_submitted ++;
-    }
+void matmul_default_plan(matmul_plan_t *plan) {
+    ASSERT(plan != NULL, "NULL plan");
 
-    DEBUG_PRINT("Submitted %d tasks to thread pool", tasks_submitted);
+    plan->kernel = g_matrix_cfg.use_blocking ? MATMUL_KERNEL_BLOCKED : MATMUL_KERNEL_ROW;
+    plan->num_threads = g_matrix_cfg.num_threads;
+    plan->block_size = g_matrix_cfg.block_size;
+    plan->schedule = g_matrix_cfg.schedule;
+    plan->grain = g_matrix_cfg.grain;
+}
 
-    // 等待所有任务完成
-    thread_pool_wait_all(g_thread_pool);
+void matmul_parallel_plan(const Tensor *A, const Tensor *B, Tensor *C, const matmul_plan_t *plan) {
+    ASSERT(A != NULL && B != NULL && C != NULL && plan != NULL, "NULL argument");
+    ASSERT(A->ndim == 2 && B->ndim == 2 && C->ndim == 2, "Must be 2D");
+    ASSERT(A->shape[1] == B->shape[0], "Dimension mismatch");
+    ASSERT(A->shape[0] == C->shape[0] && B->shape[1] == C->shape[1], "Output size mismatch");
+    ASSERT(g_thread_pool != NULL, "Matrix library not initialized");
 
-    INFO_PRINT("Parallel blocked matmul completed");
+    uint64_t trace_start_ns = trace_now();
+
+    _matmul_parallel_dispatch(A, B, C, plan);
+
+    trace_complete(plan->kernel == MATMUL_KERNEL_BLOCKED ? "matmul_parallel_blocked"
+                                                         : "matmul_parallel_row",
+                   "matmul", trace_start_ns, (int64_t)A->shape[0]);
+}
+
+void matmul_parallel(const Tensor *A, const Tensor *B, Tensor *C) {
+    ASSERT(A != NULL && B != NULL, "NULL tensor");
+
+    const matmul_plan_t *tuned = matmul_autotune_lookup(A->shape[0], A->shape[1], B->shape[1]);
+    if (tuned != NULL) {
+        matmul_parallel_plan(A, B, C, tuned);
+        return;
+    }
+
+    matmul_plan_t plan;
+    matmul_default_plan(&plan);
+    matmul_parallel_plan(A, B, C, &plan);
 }
 
 thread_pool_t* matrix_get_thread_pool(void) {
@@ -0,0 +1,155 @@
+#define _GNU_SOURCE
+#include "perf_counters.h"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+/**
+ * 事件定义：主配置 + 备选配置（主配置不支持时尝试，备选为 0 表示无）
+ */
+typedef struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+    uint64_t fallback_config;
+} perf_event_def_t;
+
+#define HW_CACHE_CONFIG(cache, op, result) \
+    ((uint64_t)(cache) | ((uint64_t)(op) << 8) | ((uint64_t)(result) << 16))
+
+static const perf_event_def_t g_event_defs[PERF_CTR_COUNT] = {
+    [PERF_CTR_CYCLES]         = {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 0},
+    [PERF_CTR_INSTRUCTIONS]   = {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 0},
+    [PERF_CTR_L1D_MISSES]     = {"l1d_misses", PERF_TYPE_HW_CACHE,
+                                 HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_L1D,
+                                                 PERF_COUNT_HW_CACHE_OP_READ,
+                                                 PERF_COUNT_HW_CACHE_RESULT_MISS), 0},
+    [PERF_CTR_LLC_MISSES]     = {"llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 0},
+    [PERF_CTR_DTLB_MISSES]    = {"dtlb_misses", PERF_TYPE_HW_CACHE,
+                                 HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_DTLB,
+                                                 PERF_COUNT_HW_CACHE_OP_READ,
+                                                 PERF_COUNT_HW_CACHE_RESULT_MISS), 0},
+    [PERF_CTR_STALLED_CYCLES] = {"stalled_cycles", PERF_TYPE_HARDWARE,
+                                 PERF_COUNT_HW_STALLED_CYCLES_BACKEND,
+                                 PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+    [PERF_CTR_TASK_CLOCK]     = {"task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, 0},
+};
+
+/* ============= 内部辅助函数 ============= */
+
+static int _perf_event_open(uint32_t type, uint64_t config, int tid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(SYS_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+/* ============= 对外接口函数 ============= */
+
+int perf_counters_open(perf_counters_t *pc, int tid) {
+    if (pc == NULL || tid < 0) {
+        ERROR_PRINT("Invalid arguments");
+        return -1;
+    }
+
+    pc->tid = tid;
+    pc->num_open = 0;
+    pc->first_errno = 0;
+
+    for (int i = 0; i < PERF_CTR_COUNT; i ++) {
+        const perf_event_def_t *def = &g_event_defs[i];
+
+        int fd = _perf_event_open(def->type, def->config, tid);
+        if (fd < 0 && def->fallback_config != 0) {
+            fd = _perf_event_open(def->type, def->fallback_config, tid);
+        }
+
+        if (fd < 0) {
+            if (pc->first_errno == 0) pc->first_errno = errno;
+            DEBUG_PRINT("perf event %s unavailable for tid %d: %s",
+                        def->name, tid, strerror(errno));
+        } else {
+            pc->num_open ++;
+        }
+        pc->fds[i] = fd;
+    }
+
+    return pc->num_open;
+}
+
+void perf_counters_close(perf_counters_t *pc) {
+    if (pc == NULL) return;
+
+    for (int i = 0; i < PERF_CTR_COUNT; i ++) {
+        if (pc->fds[i] >= 0) {
+            close(pc->fds[i]);
+            pc->fds[i] = -1;
+        }
+    }
+    pc->num_open = 0;
+}
+
+void perf_counters_start(perf_counters_t *pc) {
+    if (pc == NULL) return;
+
+    for (int i = 0; i < PERF_CTR_COUNT; i ++) {
+        if (pc->fds[i] < 0) continue;
+        ioctl(pc->fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(pc->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void perf_counters_stop(perf_counters_t *pc) {
+    if (pc == NULL) return;
+
+    for (int i = 0; i < PERF_CTR_COUNT; i ++) {
+        if (pc->fds[i] < 0) continue;
+        ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+}
+
+void perf_counters_read(const perf_counters_t *pc, perf_sample_t *sample) {
+    if (pc == NULL || sample == NULL) return;
+
+    memset(sample, 0, sizeof(*sample));
+
+    for (int i = 0; i < PERF_CTR_COUNT; i ++) {
+        if (pc->fds[i] < 0) continue;
+
+        // {value, time_enabled, time_running}
+        uint64_t buf[3];
+        if (read(pc->fds[i], buf, sizeof(buf)) != (ssize_t)sizeof(buf)) {
+            continue;
+        }
+
+        uint64_t value = buf[0];
+        if (buf[2] > 0 && buf[2] < buf[1]) {
+            // 被复用时按运行比例外推
+            value = (uint64_t)((double)value * (double)buf[1] / (double)buf[2]);
+        }
+        sample->values[i] = value;
+        sample->valid[i] = true;
+    }
+}
+
+void perf_sample_add(perf_sample_t *dst, const perf_sample_t *src) {
+    if (dst == NULL || src == NULL) return;
+
+    for (int i = 0; i < PERF_CTR_COUNT; i ++) {
+        if (!src->valid[i]) continue;
+        dst->values[i] += src->values[i];
+        dst->valid[i] = true;
+    }
+}
+
+const char* perf_counter_name(perf_counter_id_t id) {
+    if (id < 0 || id >= PERF_CTR_COUNT) return "unknown";
+    return g_event_defs[id].name;
+}
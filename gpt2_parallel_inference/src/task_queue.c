@@ -1,9 +1,17 @@
+#define _GNU_SOURCE
 #include "task_queue.h"
+#include "trace.h"
 #include <string.h>
 #include <time.h>
 
 /* ============= 内部函数实现 ============= */
 
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
 static void _task_destroy(Task *task) {
     DEBUG_PRINT("Destroying task object %p", task);
 
@@ -23,15 +31,81 @@ static void _task_destroy(Task *task) {
     return ;
 }
 
+/**
+ * @name _task_queue_take_locked
+ * @brief 按优先级取出下一个任务（调用者需持有 queue->mutex）
+ * 
+ * 选择规则：
+ * 1. 若某个低优先级子队列连续被插队达到 TASK_QUEUE_STARVATION_LIMIT 次，优先取它
+ * 2. 否则取最高优先级的非空子队列
+ * 被跳过的非空低优先级子队列的插队计数加一
+ * 
+ * @return 取出的任务；队列为空时返回 NULL
+ */
+static Task* _task_queue_take_locked(task_queue_t *queue) {
+    int chosen = -1;
+
+    for (int p = TASK_PRIO_COUNT - 1; p > 0; p --) {
+        if (queue->front[p] != NULL &&
+            queue->starvation[p] >= TASK_QUEUE_STARVATION_LIMIT) {
+            chosen = p;
+            queue->stats.starvation_promotions ++;
+            break;
+        }
+    }
+
+    if (chosen < 0) {
+        for (int p = 0; p < TASK_PRIO_COUNT; p ++) {
+            if (queue->front[p] != NULL) {
+                chosen = p;
+                break;
+            }
+        }
+    }
+
+    if (chosen < 0) {
+        return NULL;
+    }
+
+    for (int p = chosen + 1; p < TASK_PRIO_COUNT; p ++) {
+        if (queue->front[p] != NULL) {
+            queue->starvation[p] ++;
+        }
+    }
+    queue->starvation[chosen] = 0;
+
+    Task *task = queue->front[chosen];
+    queue->front[chosen] = task->next;
+    if (queue->front[chosen] == NULL) {
+        queue->back[chosen] = NULL;
+    }
+    task->next = NULL;
+
+    queue->prio_count[chosen] --;
+    queue->count --;
+
+    return task;
+}
+
 /* ============= 任务对象 API ============= */
 
 int task_queue_submit(task_queue_t *queue, void (*func)(void *), void *arg, void (*cleanup)(void *)) {
-    DEBUG_PRINT("Creating new task object %p", func);
+    return task_queue_submit_prio(queue, func, arg, cleanup, TASK_PRIO_NORMAL);
+}
+
+int task_queue_submit_prio(task_queue_t *queue, void (*func)(void *), void *arg,
+                           void (*cleanup)(void *), task_priority_t priority) {
+    DEBUG_PRINT("Creating new task object %p (priority %d)", func, priority);
 
     if (queue == NULL || func == NULL) {
         ERROR_PRINT("Queue or function pointer is NULL");
         return -1;
     }
+
+    if ((int)priority < 0 || priority >= TASK_PRIO_COUNT) {
+        ERROR_PRINT("Invalid task priority: %d", priority);
+        return -1;
+    }
     
     Task *task = (Task *)malloc(sizeof(Task));
     if (task == NULL) {
@@ -43,6 +117,7 @@ int task_queue_submit(task_queue_t *queue, void (*func)(void *), void *arg, void
     task->function = func;
     task->arg = arg;
     task->cleanup = cleanup;
+    task->priority = priority;
     task->next = NULL;
 
     DEBUG_PRINT("Task object %p created successfully", task);
@@ -71,8 +146,12 @@ task_queue_t* task_queue_create(size_t max_size) {
         return NULL;
     }
 
-    queue->front = NULL;
-    queue->back = NULL;
+    for (int p = 0; p < TASK_PRIO_COUNT; p ++) {
+        queue->front[p] = NULL;
+        queue->back[p] = NULL;
+        queue->prio_count[p] = 0;
+        queue->starvation[p] = 0;
+    }
     queue->count = 0;
     queue->max_count = max_size;
     queue->total_processed = 0;
@@ -140,13 +219,17 @@ void task_queue_destroy(task_queue_t *queue) {
     pthread_mutex_lock(&queue->mutex);
 
     // 清空队列中的所有任务
-    Task *task = queue->front;
     int count = 0;
-    while (task != NULL) {
-        Task *next = task->next;
-        _task_destroy(task);
-        task = next;
-        count ++;
+    for (int p = 0; p < TASK_PRIO_COUNT; p ++) {
+        Task *task = queue->front[p];
+        while (task != NULL) {
+            Task *next = task->next;
+            _task_destroy(task);
+            task = next;
+            count ++;
+        }
+        queue->front[p] = NULL;
+        queue->back[p] = NULL;
     }
     if (count > 0) {
         WARN_PRINT("task_queue_destroy: Destroyed %d pending tasks in the queue", count);
@@ -183,9 +266,16 @@ int task_queue_push(task_queue_t *queue, Task *task) {
         return -1;
     }
 
+    if ((int)task->priority < 0 || task->priority >= TASK_PRIO_COUNT) {
+        ERROR_PRINT("Task %p has invalid priority %d", task, task->priority);
+        return -1;
+    }
+
     pthread_mutex_lock(&queue->mutex);
 
-    while (queue->max_count > 0 && queue->count >= queue->max_count) {
+    // 高优先级任务不受背压限制
+    while (task->priority != TASK_PRIO_HIGH &&
+           queue->max_count > 0 && queue->count >= queue->max_count) {
         DEBUG_PRINT("Queue full (%zu/%zu), waiting...",
             queue->count, queue->max_count);
 
@@ -194,19 +284,26 @@ int task_queue_push(task_queue_t *queue, Task *task) {
         pthread_cond_wait(&queue->cond_not_full, &queue->mutex);
     }
 
-    // === 添加任务到队列尾部 ===s
+    // === 添加任务到对应优先级子队列尾部 ===
+    task_priority_t prio = task->priority;
     task->next = NULL;
 
-    if (queue->back != NULL) {
-        queue->back->next = task;
+    if (queue->back[prio] != NULL) {
+        queue->back[prio]->next = task;
     } else {
-        // 队列为空，更新 front 指针
-        queue->front = task;
+        // 子队列为空，更新 front 指针
+        queue->front[prio] = task;
     }
 
-    queue->back = task;
+    queue->back[prio] = task;
+    queue->prio_count[prio] ++;
     queue->count ++;
+    task->enqueue_ns = _now_ns();
+    if (queue->count > queue->stats.max_depth) {
+        queue->stats.max_depth = queue->count;
+    }
     queue->stats.total_enqueued ++;
+    queue->stats.prio_enqueued[prio] ++;
 
     DEBUG_PRINT("Task %p pushed successfully, queue size now %zu",
         task, queue->count);
@@ -245,18 +342,10 @@ Task* task_queue_pop(task_queue_t *queue, volatile bool *shutdown) {
         return NULL;
     }
 
-    // === 从队列头部取出任务 ===
-    Task *task = queue->front;
+    // === 按优先级取出任务 ===
+    Task *task = _task_queue_take_locked(queue);
 
     if (task != NULL) {
-        queue->front = task->next;
-
-        if (queue->front == NULL) {
-            // 队列现在为空，更新 back 指针
-            queue->back = NULL;
-        }
-
-        queue->count --;
         queue->stats.total_dequeued ++;
         queue->total_processed ++;
 
@@ -287,7 +376,7 @@ void task_queue_wait_empty(task_queue_t *queue) {
         return;
     }
 
-    INFO_PRINT("task_queue_wait_empty: Waiting for all tasks to complete...");
+    DEBUG_PRINT("task_queue_wait_empty: Waiting for all tasks to complete...");
     
     pthread_mutex_lock(&queue->mutex);
     
@@ -298,7 +387,7 @@ void task_queue_wait_empty(task_queue_t *queue) {
     }
     pthread_mutex_unlock(&queue->mutex);
     
-    INFO_PRINT("task_queue_wait_empty: All tasks completed");
+    DEBUG_PRINT("task_queue_wait_empty: All tasks completed");
 }
 
 size_t task_queue_get_count(task_queue_t *queue) {
@@ -318,7 +407,8 @@ size_t task_queue_get_count(task_queue_t *queue) {
     return count;
 }
 
-int task_queue_pop_and_execute(task_queue_t *queue, bool *should_shutdown) {
+int task_queue_pop_and_execute(task_queue_t *queue, bool *should_shutdown,
+                               task_done_fn on_done, void *done_ctx) {
     DEBUG_PRINT("task_queue_pop_and_execute: Waiting for task from queue %p", queue);
 
     if (queue == NULL || should_shutdown == NULL) {
@@ -341,19 +431,13 @@ int task_queue_pop_and_execute(task_queue_t *queue, bool *should_shutdown) {
         return 1; // 返回 1 表示应该退出
     }
 
-    // 从队列头部取出任务
-    Task *task = queue->front;
+    // 按优先级取出任务
+    Task *task = _task_queue_take_locked(queue);
     if (task == NULL) {
         pthread_mutex_unlock(&queue->mutex);
         return -1;
     }
 
-    queue->front = task->next;
-    if (queue->front == NULL) {
-        queue->back = NULL;
-    }
-
-    queue->count--;
     queue->stats.total_dequeued++;
     queue->total_processed++;
     
@@ -372,11 +456,27 @@ int task_queue_pop_and_execute(task_queue_t *queue, bool *should_shutdown) {
 
     // 在锁外执行任务（避免长时间持锁）
     DEBUG_PRINT("task_queue_pop_and_execute: Executing task %p", task);
+    uint64_t start_ns = _now_ns();
+    task_priority_t priority = task->priority;
+    uint64_t enqueue_ns = task->enqueue_ns;
+
     task->function(task->arg);
 
     // 销毁任务
     _task_destroy(task);
 
+    trace_complete("task", "pool", start_ns, (int64_t)priority);
+
+    // 先让调用者记录统计，再计入完成，避免 wait_empty 返回后统计仍不完整
+    if (on_done != NULL) {
+        task_exec_info_t exec_info = {
+            .wait_ns = start_ns > enqueue_ns ? start_ns - enqueue_ns : 0,
+            .exec_ns = _now_ns() - start_ns,
+            .priority = priority
+        };
+        on_done(&exec_info, done_ctx);
+    }
+
     DEBUG_PRINT("task_queue_pop_and_execute: Task executed and destroyed successfully");
 
     // 任务执行完成，减少活跃任务计数
@@ -393,6 +493,19 @@ int task_queue_pop_and_execute(task_queue_t *queue, bool *should_shutdown) {
     return 0;
 }
 
+void task_queue_reset_stats(task_queue_t *queue) {
+    if (queue == NULL) {
+        WARN_PRINT("Attempted to reset stats for NULL queue");
+        return;
+    }
+
+    pthread_mutex_lock(&queue->mutex);
+    memset(&queue->stats, 0, sizeof(queue->stats));
+    queue->stats.max_depth = queue->count;
+    queue->total_processed = 0;
+    pthread_mutex_unlock(&queue->mutex);
+}
+
 void task_queue_print_stats(task_queue_t *queue) {
     if (queue == NULL) {
         WARN_PRINT("Attempted to print stats for NULL queue");
@@ -410,6 +523,13 @@ void task_queue_print_stats(task_queue_t *queue) {
     printf("║ Total enqueued:  %zu%-17s║\n", queue->stats.total_enqueued, "");
     printf("║ Total dequeued:  %zu%-17s║\n", queue->stats.total_dequeued, "");
     printf("║ Processed:       %zu%-17s║\n", queue->total_processed, "");
+    printf("║ Pending high/normal/bg: %zu/%zu/%zu%-6s║\n",
+           queue->prio_count[TASK_PRIO_HIGH],
+           queue->prio_count[TASK_PRIO_NORMAL],
+           queue->prio_count[TASK_PRIO_BACKGROUND], "");
+    printf("║ Starvation promotions: %zu%-11s║\n",
+           queue->stats.starvation_promotions, "");
+    printf("║ Depth high-water: %zu%-16s║\n", queue->stats.max_depth, "");
     printf("╚════════════════════════════════════╝\n");
 
     pthread_mutex_unlock(&queue->mutex);
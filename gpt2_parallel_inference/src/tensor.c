@@ -1,9 +1,83 @@
+#define _GNU_SOURCE
 #include "tensor.h"
 #include <math.h>
 #include <time.h>
 
+// 结构体部分按 TENSOR_ALIGNMENT 填充后的大小，拥有的数据紧跟其后
+#define TENSOR_HEADER_SIZE ALIGN_UP(sizeof(Tensor), TENSOR_ALIGNMENT)
+
+/**
+ * arena：一块对齐的连续内存，used 原子递增
+ */
+struct tensor_arena {
+    tensor_allocator_t allocator;   // ctx 指向 arena 自身
+    char *base;
+    size_t capacity;
+    size_t used;
+};
+
 /* ============= 内部辅助函数 ============= */
 
+// 进程内累计分配的张量数（含视图与副本）
+static uint64_t g_tensor_alloc_count = 0;
+
+/**
+ * @name _tensor_alloc
+ * @brief 一次分配 Tensor 结构体与（可选的）数据区并计数
+ * 
+ * @param allocator  - 分配器，NULL 表示默认堆分配
+ * @param ndim       - 维度数量
+ * @param data_elems - 数据元素数，0 表示视图（不分配数据）
+ * 
+ * @return Tensor* 元数据清零、data 已指向对齐数据区的结构体，失败返回 NULL
+ */
+static Tensor* _tensor_alloc(const tensor_allocator_t *allocator, size_t ndim, size_t data_elems) {
+    if (ndim == 0 || ndim > TENSOR_MAX_DIMS) {
+        ERROR_PRINT("_tensor_alloc: ndim %zu out of range [1, %d]", ndim, TENSOR_MAX_DIMS);
+        return NULL;
+    }
+    if (data_elems > (SIZE_MAX - TENSOR_HEADER_SIZE) / sizeof(float)) {
+        ERROR_PRINT("_tensor_alloc: Size overflow (%zu elements)", data_elems);
+        return NULL;
+    }
+
+    size_t bytes = TENSOR_HEADER_SIZE + data_elems * sizeof(float);
+    void *block = NULL;
+    if (allocator != NULL) {
+        block = allocator->alloc(allocator->ctx, bytes, TENSOR_ALIGNMENT);
+    } else if (posix_memalign(&block, TENSOR_ALIGNMENT, bytes) != 0) {
+        block = NULL;
+    }
+    if (block == NULL) {
+        ERROR_PRINT("_tensor_alloc: Failed to allocate %zu bytes", bytes);
+        return NULL;
+    }
+
+    Tensor *t = (Tensor *)block;
+    memset(t, 0, sizeof(Tensor));
+    t->ndim = ndim;
+    t->allocator = allocator;
+    if (data_elems > 0) {
+        t->data = (float *)((char *)block + TENSOR_HEADER_SIZE);
+        t->owns_data = true;
+    }
+
+    __atomic_add_fetch(&g_tensor_alloc_count, 1, __ATOMIC_RELAXED);
+    return t;
+}
+
+/**
+ * @name _tensor_release
+ * @brief 归还 _tensor_alloc 分配的内存块（数据随结构体一起释放）
+ */
+static void _tensor_release(Tensor *t) {
+    if (t->allocator == NULL) {
+        free(t);
+    } else if (t->allocator->free != NULL) {
+        t->allocator->free(t->allocator->ctx, t);
+    }
+}
+
 /**
  * @name _tensor_compute_size
  * @brief 计算总元素数量
@@ -46,15 +120,6 @@ static void _tensor_compute_default_strides(Tensor *t) {
         return ;
     }
 
-    // 仅在未分配时分配内存
-    if (t->stride == NULL) {
-        t->stride = (size_t *)malloc(t->ndim * sizeof(size_t));
-        if (t->stride == NULL) {
-            ERROR_PRINT("_tensor_compute_default_strides: Failed to allocate memory for tensor strides");
-            return ;
-        }
-    }
-
     size_t stride = 1;
     for (int i = (int)t->ndim - 1; i >= 0; i --) {
         t->stride[i] = stride;
@@ -130,25 +195,18 @@ static Tensor* _tensor_slice_view(const Tensor *t, const size_t *start, const si
         return NULL;
     }
 
-    // 创建视图向量
-    Tensor *view_t = (Tensor *)malloc(sizeof(Tensor));
+    // 创建视图向量（只分配结构体）
+    Tensor *view_t = _tensor_alloc(t->allocator, t->ndim, 0);
     if (view_t == NULL) {
         ERROR_PRINT("_tensor_slice_view: Failed to allocate memory for tensor slice view");
         return NULL;
     }
 
     // 初始化元数据
-    view_t->ndim = t->ndim;
     view_t->data = t->data;     // 共享数据指针
     view_t->owns_data = false;  // 不拥有数据所有权
 
-    // 分配并设置新 shape
-    view_t->shape = (size_t *)malloc(t->ndim * sizeof(size_t));
-    if (view_t->shape == NULL) {
-        ERROR_PRINT("_tensor_slice_view: Failed to allocate memory for slice view shape");
-        free(view_t);
-        return NULL;
-    }
+    // 设置新 shape
     size_t new_size = 1;
     for (size_t i = 0; i < t->ndim; i ++) {
         size_t dim_size = end[i] - start[i];
@@ -161,13 +219,6 @@ static Tensor* _tensor_slice_view(const Tensor *t, const size_t *start, const si
     view_t->size = new_size;
 
     // 继承原stride 
-    view_t->stride = (size_t *)malloc(t->ndim * sizeof(size_t));
-    if (view_t->stride == NULL) {
-        ERROR_PRINT("_tensor_slice_view: Failed to allocate memory for tensor slice view");
-        free(view_t->shape);
-        free(view_t);
-        return NULL;
-    }
     memcpy(view_t->stride, t->stride, t->ndim * sizeof(size_t));
 
     DEBUG_PRINT("_tensor_slice_view: Created tensor slice view successfully at %p", (void*)view_t);
@@ -214,79 +265,22 @@ static Tensor* _tensor_slice_copy(const Tensor *t, const size_t *start, const si
     }
 
     // 创建新张量 (数据复制)
-    Tensor *copy_t = (Tensor *)malloc(sizeof(Tensor));
+    Tensor *copy_t = tensor_create_with_allocator(view_t->ndim, view_t->shape, t->allocator);
     if (copy_t == NULL) {
         ERROR_PRINT("_tensor_slice_copy: Failed to allocate memory for tensor slice copy");
         tensor_free(view_t);
         return NULL;
     }
 
-    copy_t->ndim = view_t->ndim;
-    copy_t->size = view_t->size;
-    copy_t->offset = 0;
-    copy_t->owns_data = true;
-
-    // 分配并复制 shape
-    copy_t->shape = (size_t *)malloc(view_t->ndim * sizeof(size_t));
-    if (copy_t->shape == NULL) {
-        ERROR_PRINT("_tensor_slice_copy: Failed to allocate memory for slice copy shape");
-        tensor_free(view_t);
-        free(copy_t);
-        return NULL;
-    }
-    memcpy(copy_t->shape, view_t->shape, view_t->ndim * sizeof(size_t));
-
-    // 初始化并计算 stride
-    copy_t->stride = (size_t *)malloc(view_t->ndim * sizeof(size_t));
-    _tensor_compute_default_strides(copy_t);
-    if (copy_t->stride == NULL) {
-        ERROR_PRINT("_tensor_slice_copy: Failed to compute stride for slice copy");
-        tensor_free(view_t);
-        free(copy_t->shape);
-        free(copy_t);
-        return NULL;
-    } 
-
-    // 分配新数据
-    copy_t->data = (float *)malloc(copy_t->size * sizeof(float));
-    if (copy_t->data == NULL) {
-        ERROR_PRINT("_tensor_slice_copy: Failed to allocate memory for slice copy data");
-        tensor_free(view_t);
-        free(copy_t->shape);
-        free(copy_t->stride);
-        free(copy_t);
-        return NULL;
-    }
-    
-    // 拷贝数据
-    INFO_PRINT("_tensor_slice_copy: Copying %zu elements....", copy_t->size);
-
-    // 生成所有多维索引并逐个拷贝
-    size_t *indices = (size_t *)malloc(copy_t->ndim * sizeof(size_t));
-    if (indices == NULL) {
-        ERROR_PRINT("_tensor_slice_copy: Failed to allocate memory for indices array");
+    // 拷贝数据（迭代器按视图步长成段复制）
+    DEBUG_PRINT("_tensor_slice_copy: Copying %zu elements....", copy_t->size);
+    if (tensor_copy(copy_t, view_t) != 0) {
+        ERROR_PRINT("_tensor_slice_copy: Failed to copy slice data");
         tensor_free(view_t);
         tensor_free(copy_t);
         return NULL;
     }
-    memset(indices, 0, copy_t->ndim * sizeof(size_t));
-
-    for (size_t elem = 0; elem < copy_t->size; elem ++) {
-        // 获取视图中值并设置到新拷贝中
-        float val = tensor_get(view_t, indices);
-        tensor_set(copy_t, indices, val);
-
-        // 递增多维索引
-        for (int dim = (int)copy_t->ndim - 1; dim >= 0; dim --) {
-            indices[dim] ++;
-            if (indices[dim] < copy_t->shape[dim]) {
-                break;
-            }
-            indices[dim] = 0; // 进位
-        }
-    }
 
-    free(indices);
     tensor_free(view_t);
 
     INFO_PRINT("_tensor_slice_copy: Tensor slice copy created successfully at %p", (void*)copy_t);
@@ -296,35 +290,38 @@ static Tensor* _tensor_slice_copy(const Tensor *t, const size_t *start, const si
 /* ============= 对外接口函数 ============= */
 
 Tensor* tensor_create(size_t ndim, const size_t *shape) {
+    return tensor_create_with_allocator(ndim, shape, NULL);
+}
+
+Tensor* tensor_create_with_allocator(size_t ndim, const size_t *shape, const tensor_allocator_t *allocator) {
     DEBUG_PRINT("tensor_create: Creating tensor with ndim: %zu", ndim);
     
     // 参数检测
-    if (ndim == 0 || shape == NULL) {
-        ERROR_PRINT("tensor_create: Invalid arguments");
+    if (ndim == 0 || ndim > TENSOR_MAX_DIMS || shape == NULL) {
+        ERROR_PRINT("tensor_create: Invalid arguments (ndim: %zu, max: %d)", ndim, TENSOR_MAX_DIMS);
         return NULL;
     }
 
-    // 分配 Tensor 结构体 
-    Tensor *t = (Tensor *)malloc(sizeof(Tensor));
-    if (t == NULL) {
-        ERROR_PRINT("tensor_create: Failed to allocate memory for Tensor");
+    // 计算总元素数量
+    size_t size = _tensor_compute_size(ndim, shape);
+    if (size == 0) {
+        ERROR_PRINT("tensor_create: Invalid tensor size computed");
         return NULL;
     }
 
-    t->ndim = ndim;
-    t->data = NULL;
-    t->stride = NULL;
-    t->offset = 0;
-    t->owns_data = true;
-
-    // 分配并拷贝 shape 数组
-    t->shape = (size_t *)malloc(ndim * sizeof(size_t));
-    if (t->shape == NULL) {
-        ERROR_PRINT("tensor_create: Failed to allocate memory for shape array");
-        free(t);
+    DEBUG_PRINT("tensor_create: Total elements: %zu (%.2f MB)",
+        size, (size * sizeof(float)) / (1024.0 * 1024.0));
+
+    // 结构体与数据一次分配
+    Tensor *t = _tensor_alloc(allocator, ndim, size);
+    if (t == NULL) {
+        ERROR_PRINT("tensor_create: Failed to allocate memory for tensor (%zu bytes of data)",
+            size * sizeof(float));
         return NULL;
     }
+    t->size = size;
 
+    // 拷贝 shape 数组
     #ifdef DEBUG
         printf("[DEBUG] tensor_create: create tensor shape: [");
         for (size_t i = 0; i < ndim; i ++) {
@@ -338,37 +335,11 @@ Tensor* tensor_create(size_t ndim, const size_t *shape) {
         }
     #endif
 
-    // 计算总元素数量
-    t->size = _tensor_compute_size(ndim, shape);
-    if (t->size == 0) {
-        ERROR_PRINT("tensor_create: Invalid tensor size computed");
-        free(t->shape);
-        free(t);
-        return NULL;
-    }
-
-    DEBUG_PRINT("tensor_create: Total elements: %zu (%.2f MB)",
-        t->size, (t->size * sizeof(float)) / (1024.0 * 1024.0));
-
-    // 分配数据内存
-    t->data = (float *)calloc(t->size, sizeof(float));
-    if (t->data == NULL) {
-        ERROR_PRINT("tensor_create: Failed to allocate memory for tensor data array (%zu bytes)",
-            t->size * sizeof(float));
-        free(t->shape);
-        free(t);
-        return NULL;
-    }
+    // 数据初始化为 0
+    memset(t->data, 0, size * sizeof(float));
 
     // 计算默认步长
     _tensor_compute_default_strides(t);
-    if (t->stride == NULL) {
-        ERROR_PRINT("tensor_create: Failed to compute tensor strides");
-        free(t->data);
-        free(t->shape);
-        free(t);
-        return NULL;
-    }
 
     DEBUG_PRINT("tensor_create: Tensor created successfully at %p", (void*)t);
     return t;
@@ -398,7 +369,7 @@ Tensor *tensor_from_data(size_t ndim, const size_t *shape, const float *data) {
     Tensor *t = tensor_create(ndim, shape);
     if(t == NULL) return NULL;
 
-    INFO_PRINT("tensor_from_data: Copying %zu elements (%.2f MB)",
+    DEBUG_PRINT("tensor_from_data: Copying %zu elements (%.2f MB)",
         t->size, (t->size * sizeof(float)) / (1024.0 * 1024.0));
     memcpy(t->data, data, t->size * sizeof(float));
 
@@ -414,25 +385,8 @@ void tensor_free(Tensor *t) {
     DEBUG_PRINT("tensor_free: Freeing tensor (size:%zu, memory: %.2f MB) at %p",
         t->size, (t->size * sizeof(float)) / (1024.0 * 1024.0), (void*)t);
     
-    // 仅在拥有数据所有权时才释放数据
-    if (t->owns_data && t->data != NULL) {
-        free(t->data);
-        t->data = NULL;
-    }
-
-    // 释放 shape 数据
-    if (t->shape != NULL) {
-        free(t->shape);
-        t->shape = NULL;
-    }
-
-    // 释放 stride 数据
-    if (t->stride != NULL) {
-        free(t->stride);
-        t->stride = NULL;
-    }
-
-    free(t);
+    // 拥有的数据与结构体在同一块内存中，一并归还
+    _tensor_release(t);
     DEBUG_PRINT("tensor_free: Tensor freed successfully");
 }
 
@@ -507,8 +461,12 @@ Tensor* tensor_clone(const Tensor *t) {
         return NULL;
     }
 
-    // 深拷贝数据
-    memcpy(new_t->data, t->data, t->size * sizeof(float));
+    // 深拷贝数据（视图按步长复制成连续布局）
+    if (tensor_copy(new_t, t) != 0) {
+        ERROR_PRINT("Failed to clone tensor data");
+        tensor_free(new_t);
+        return NULL;
+    }
 
     return new_t;
 }
@@ -526,36 +484,20 @@ Tensor* tensor_reshape(const Tensor *t, size_t new_ndim, const size_t *new_shape
     }
 
     // 创建 new tensor(共享数据)
-    Tensor *new_t = (Tensor *)malloc(sizeof(Tensor));
+    Tensor *new_t = _tensor_alloc(t->allocator, new_ndim, 0);
     if (new_t == NULL) {
         ERROR_PRINT("tensor_reshape: Failed to allocate memory for reshaped tensor");
         return NULL;
     }
 
-    new_t->ndim = new_ndim;
     new_t->size = new_size;
     new_t->data = t->data;      // 共享数据指针
     new_t->owns_data = false;   // 不拥有数据所有权
     new_t->offset = 0;
 
-    // 分配并拷贝新 shape 数组
-    new_t->shape = (size_t *)malloc(new_ndim * sizeof(size_t));
-    if (new_t->shape == NULL) {
-        ERROR_PRINT("tensor_reshape: Failed to allocate memory for reshaped tensor shape");
-        free(new_t);
-        return NULL;
-    }
+    // 拷贝新 shape 并计算新 stride
     memcpy(new_t->shape, new_shape, new_ndim * sizeof(size_t));
-
-    // 分配并计算新 stride（修复）
-    new_t->stride = NULL;
     _tensor_compute_default_strides(new_t);
-    if (new_t->stride == NULL) {
-        ERROR_PRINT("tensor_reshape: Failed to compute stride for reshaped tensor");
-        free(new_t->shape);
-        free(new_t);
-        return NULL;
-    }
 
     return new_t;
 }   
@@ -577,14 +519,16 @@ Tensor *tensor_transpose(const Tensor *t) {
         ERROR_PRINT("tensor_transpose: Failed to create transposed tensor");
         return NULL;
     }
-    // tensor_create 已经初始化了 stride，无需额外操作
-
-    for (size_t i = 0; i < t->shape[0]; i ++) {
-        for (size_t j = 0; j < t->shape[1]; j ++) {
-            size_t src_offset = i * t->shape[1] + j;
-            size_t dst_offser = j * transposed_t->shape[1] + i;
-            transposed_t->data[dst_offser] = t->data[src_offset];
-        }
+    // 以交换步长的视图描述转置，再按元素复制成连续布局
+    Tensor view = *t;
+    view.shape[0] = t->shape[1];
+    view.shape[1] = t->shape[0];
+    view.stride[0] = t->stride[1];
+    view.stride[1] = t->stride[0];
+    if (tensor_copy(transposed_t, &view) != 0) {
+        ERROR_PRINT("tensor_transpose: Failed to copy transposed data");
+        tensor_free(transposed_t);
+        return NULL;
     }
 
     return transposed_t;
@@ -740,4 +684,85 @@ tensor_stats tensor_compute_stats(const Tensor *t) {
     stats.variance = (float)(variance_sum / t->size);
 
     return stats;
-}
\ No newline at end of file
+}
+
+uint64_t tensor_alloc_count(void) {
+    return __atomic_load_n(&g_tensor_alloc_count, __ATOMIC_RELAXED);
+}
+
+
+/* ========== Arena 分配器 ========== */
+
+static void* _tensor_arena_alloc(void *ctx, size_t size, size_t alignment) {
+    tensor_arena_t *arena = (tensor_arena_t *)ctx;
+
+    // base 按 TENSOR_ALIGNMENT 对齐，每次分配向上取整即可保持后续地址对齐
+    if (alignment > TENSOR_ALIGNMENT || size > arena->capacity) return NULL;
+    size = ALIGN_UP(size, (size_t)TENSOR_ALIGNMENT);
+
+    // CAS 预留：只有放得下时才推进 used，失败的请求不占用空间，之后较小的请求仍可成功
+    size_t start = __atomic_load_n(&arena->used, __ATOMIC_RELAXED);
+    do {
+        if (size > arena->capacity - start) {
+            ERROR_PRINT("_tensor_arena_alloc: Arena exhausted (capacity %zu, requested %zu at %zu)",
+                arena->capacity, size, start);
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&arena->used, &start, start + size, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return arena->base + start;
+}
+
+tensor_arena_t* tensor_arena_create(size_t capacity) {
+    if (capacity == 0 || capacity > SIZE_MAX - TENSOR_ALIGNMENT) {
+        ERROR_PRINT("tensor_arena_create: Invalid capacity %zu", capacity);
+        return NULL;
+    }
+
+    tensor_arena_t *arena = (tensor_arena_t *)calloc(1, sizeof(tensor_arena_t));
+    if (arena == NULL) {
+        ERROR_PRINT("tensor_arena_create: Failed to allocate arena");
+        return NULL;
+    }
+
+    capacity = ALIGN_UP(capacity, (size_t)TENSOR_ALIGNMENT);
+    void *base = NULL;
+    if (posix_memalign(&base, TENSOR_ALIGNMENT, capacity) != 0) {
+        ERROR_PRINT("tensor_arena_create: Failed to allocate %zu bytes", capacity);
+        free(arena);
+        return NULL;
+    }
+
+    arena->base = (char *)base;
+    arena->capacity = capacity;
+    arena->used = 0;
+    arena->allocator.alloc = _tensor_arena_alloc;
+    arena->allocator.free = NULL;   // 单个张量不释放，reset 时整体回收
+    arena->allocator.ctx = arena;
+    return arena;
+}
+
+void tensor_arena_destroy(tensor_arena_t *arena) {
+    if (arena == NULL) return;
+
+    free(arena->base);
+    free(arena);
+}
+
+void tensor_arena_reset(tensor_arena_t *arena) {
+    if (arena == NULL) return;
+
+    __atomic_store_n(&arena->used, 0, __ATOMIC_RELAXED);
+}
+
+const tensor_allocator_t* tensor_arena_allocator(tensor_arena_t *arena) {
+    if (arena == NULL) return NULL;
+
+    return &arena->allocator;
+}
+
+size_t tensor_arena_used(const tensor_arena_t *arena) {
+    if (arena == NULL) return 0;
+
+    return __atomic_load_n(&arena->used, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,215 @@
+#include "tensor.h"
+
+/* ============= 内部辅助函数 ============= */
+
+/**
+ * @name _tensor_iter_setup_strides
+ * @brief 计算张量在迭代空间（ops[0] 的形状）中各维的广播步长
+ *
+ * @param t     - 张量
+ * @param shape - 迭代空间形状
+ * @param nd    - 迭代空间维数
+ * @param st    - 输出步长（按迭代空间维度，由外向内）
+ *
+ * @return 可广播返回 0，否则 -1
+ */
+static int _tensor_iter_setup_strides(const Tensor *t, const size_t *shape, size_t nd, ptrdiff_t *st) {
+    if (t->ndim > nd) return -1;
+
+    size_t lead = nd - t->ndim;
+    for (size_t d = 0; d < nd; d ++) {
+        if (d < lead) {
+            st[d] = 0;  // 缺失的前导维度
+        } else if (t->shape[d - lead] == shape[d]) {
+            st[d] = (ptrdiff_t)t->stride[d - lead];
+        } else if (t->shape[d - lead] == 1) {
+            st[d] = 0;  // 大小为 1 的维度广播
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * 逐元素二元运算内核：连续、右操作数为标量（偏置广播）与一般跨步三种情形。
+ * 连续情形是简单的线性循环，交给编译器自动向量化。
+ */
+#define _DEFINE_BINARY_KERNEL(name, OP)                                             \
+static void name(float *o, const float *a, const float *b, size_t n,                \
+                 ptrdiff_t so, ptrdiff_t sa, ptrdiff_t sb) {                        \
+    if (so == 1 && sa == 1 && sb == 1) {                                            \
+        for (size_t i = 0; i < n; i ++) o[i] = a[i] OP b[i];                        \
+    } else if (so == 1 && sa == 1 && sb == 0) {                                     \
+        const float y = b[0];                                                       \
+        for (size_t i = 0; i < n; i ++) o[i] = a[i] OP y;                           \
+    } else {                                                                        \
+        for (size_t i = 0; i < n; i ++) o[i * so] = a[i * sa] OP b[i * sb];         \
+    }                                                                               \
+}
+
+_DEFINE_BINARY_KERNEL(_kernel_add, +)
+_DEFINE_BINARY_KERNEL(_kernel_mul, *)
+
+typedef void (*_binary_kernel_t)(float *, const float *, const float *, size_t,
+                                 ptrdiff_t, ptrdiff_t, ptrdiff_t);
+
+static int _tensor_binary(Tensor *out, const Tensor *a, const Tensor *b, _binary_kernel_t kernel) {
+    const Tensor *ops[] = {out, a, b};
+    tensor_iter_t it;
+    if (tensor_iter_init(&it, 3, ops) != 0) return -1;
+
+    while (tensor_iter_next(&it)) {
+        kernel(it.ptr[0], it.ptr[1], it.ptr[2], it.inner_size,
+               it.inner_stride[0], it.inner_stride[1], it.inner_stride[2]);
+    }
+    return 0;
+}
+
+/* ============= 对外接口函数 ============= */
+
+int tensor_iter_init(tensor_iter_t *it, size_t nops, const Tensor *const *ops) {
+    if (it == NULL || ops == NULL || nops == 0 || nops > TENSOR_ITER_MAX_OPS) {
+        ERROR_PRINT("tensor_iter_init: Invalid arguments");
+        return -1;
+    }
+    for (size_t k = 0; k < nops; k ++) {
+        if (ops[k] == NULL || ops[k]->data == NULL) {
+            ERROR_PRINT("tensor_iter_init: Operand %zu is NULL", k);
+            return -1;
+        }
+    }
+
+    memset(it, 0, sizeof(*it));
+    it->nops = nops;
+
+    // 1. 各张量在迭代空间中的步长（由外向内）
+    const size_t *shape = ops[0]->shape;
+    size_t nd = ops[0]->ndim;
+    ptrdiff_t st[TENSOR_ITER_MAX_OPS][TENSOR_MAX_DIMS];
+    for (size_t k = 0; k < nops; k ++) {
+        if (_tensor_iter_setup_strides(ops[k], shape, nd, st[k]) != 0) {
+            ERROR_PRINT("tensor_iter_init: Operand %zu (ndim %zu) cannot broadcast to operand 0 (ndim %zu)",
+                k, ops[k]->ndim, nd);
+            return -1;
+        }
+        it->ptr[k] = ops[k]->data + ops[k]->offset;
+    }
+
+    // 2. 由内向外去掉大小为 1 的维度并折叠可衔接的相邻维度
+    //    维度 d 可并入内侧块的条件：对所有张量 stride[d] == 内侧块步长 * 内侧块大小
+    size_t cshape[TENSOR_MAX_DIMS];
+    ptrdiff_t cst[TENSOR_ITER_MAX_OPS][TENSOR_MAX_DIMS];
+    size_t n = 0;
+    for (int d = (int)nd - 1; d >= 0; d --) {
+        if (shape[d] == 1) continue;
+
+        bool mergeable = (n > 0);
+        for (size_t k = 0; mergeable && k < nops; k ++) {
+            if (st[k][d] != cst[k][n - 1] * (ptrdiff_t)cshape[n - 1]) mergeable = false;
+        }
+
+        if (mergeable) {
+            cshape[n - 1] *= shape[d];
+        } else {
+            cshape[n] = shape[d];
+            for (size_t k = 0; k < nops; k ++) cst[k][n] = st[k][d];
+            n ++;
+        }
+    }
+
+    // 3. 最内层维度作为段，其余作为外层（由内向外存放）
+    if (n == 0) {
+        // 单元素张量
+        it->inner_size = 1;
+        return 0;
+    }
+
+    it->inner_size = cshape[0];
+    for (size_t k = 0; k < nops; k ++) it->inner_stride[k] = cst[k][0];
+
+    it->ndim = n - 1;
+    for (size_t j = 0; j < it->ndim; j ++) {
+        it->shape[j] = cshape[j + 1];
+        for (size_t k = 0; k < nops; k ++) it->strides[k][j] = cst[k][j + 1];
+    }
+    return 0;
+}
+
+bool tensor_iter_next(tensor_iter_t *it) {
+    if (it->done) return false;
+
+    // 第一段即初始化时的起始指针
+    if (!it->started) {
+        it->started = true;
+        return true;
+    }
+
+    // 外层里程表式进位，只做指针增量
+    for (size_t j = 0; j < it->ndim; j ++) {
+        it->index[j] ++;
+        for (size_t k = 0; k < it->nops; k ++) it->ptr[k] += it->strides[k][j];
+        if (it->index[j] < it->shape[j]) return true;
+
+        for (size_t k = 0; k < it->nops; k ++) {
+            it->ptr[k] -= it->strides[k][j] * (ptrdiff_t)it->shape[j];
+        }
+        it->index[j] = 0;
+    }
+
+    it->done = true;
+    return false;
+}
+
+int tensor_copy(Tensor *dst, const Tensor *src) {
+    const Tensor *ops[] = {dst, src};
+    tensor_iter_t it;
+    if (tensor_iter_init(&it, 2, ops) != 0) return -1;
+
+    while (tensor_iter_next(&it)) {
+        float *o = it.ptr[0];
+        const float *a = it.ptr[1];
+        ptrdiff_t so = it.inner_stride[0];
+        ptrdiff_t sa = it.inner_stride[1];
+        size_t n = it.inner_size;
+
+        if (so == 1 && sa == 1) {
+            if (o != a) memcpy(o, a, n * sizeof(float));
+        } else if (so == 1 && sa == 0) {
+            const float v = a[0];
+            for (size_t i = 0; i < n; i ++) o[i] = v;
+        } else {
+            for (size_t i = 0; i < n; i ++) o[i * so] = a[i * sa];
+        }
+    }
+    return 0;
+}
+
+int tensor_add(Tensor *out, const Tensor *a, const Tensor *b) {
+    return _tensor_binary(out, a, b, _kernel_add);
+}
+
+int tensor_mul(Tensor *out, const Tensor *a, const Tensor *b) {
+    return _tensor_binary(out, a, b, _kernel_mul);
+}
+
+int tensor_scale(Tensor *out, const Tensor *a, float scale) {
+    const Tensor *ops[] = {out, a};
+    tensor_iter_t it;
+    if (tensor_iter_init(&it, 2, ops) != 0) return -1;
+
+    while (tensor_iter_next(&it)) {
+        float *o = it.ptr[0];
+        const float *x = it.ptr[1];
+        ptrdiff_t so = it.inner_stride[0];
+        ptrdiff_t sa = it.inner_stride[1];
+        size_t n = it.inner_size;
+
+        if (so == 1 && sa == 1) {
+            for (size_t i = 0; i < n; i ++) o[i] = x[i] * scale;
+        } else {
+            for (size_t i = 0; i < n; i ++) o[i * so] = x[i * sa] * scale;
+        }
+    }
+    return 0;
+}
@@ -1,11 +1,59 @@
+#define _GNU_SOURCE
 #include "thread_pool.h"
+#include "trace.h"
+#include <sched.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/time.h>
+#include <time.h>
 #include <unistd.h> 
+#include <sys/syscall.h>
+
+#define WORKER_TID_TIMEOUT_NS (1000ull * 1000000ull)   // 等待工作线程发布 tid 的上限
 
 /* ======== 内部函数 ======== */
 
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @name _hist_record
+ * @brief 记录一个样本（仅由直方图所属线程调用）
+ */
+static void _hist_record(pool_histogram_t *hist, uint64_t ns) {
+    int bucket = (ns == 0) ? 0 : 63 - __builtin_clzll(ns);
+    if (bucket >= POOL_HIST_BUCKETS) bucket = POOL_HIST_BUCKETS - 1;
+
+    __atomic_fetch_add(&hist->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->sum_ns, ns, __ATOMIC_RELAXED);
+    if (ns > __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&hist->max_ns, ns, __ATOMIC_RELAXED);
+    }
+}
+
+static void _hist_merge(pool_histogram_t *dst, const pool_histogram_t *src) {
+    for (int i = 0; i < POOL_HIST_BUCKETS; i ++) {
+        dst->buckets[i] += __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+    }
+    dst->count += __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+    dst->sum_ns += __atomic_load_n(&src->sum_ns, __ATOMIC_RELAXED);
+
+    uint64_t max_ns = __atomic_load_n(&src->max_ns, __ATOMIC_RELAXED);
+    if (max_ns > dst->max_ns) dst->max_ns = max_ns;
+}
+
+static void _hist_reset(pool_histogram_t *hist) {
+    for (int i = 0; i < POOL_HIST_BUCKETS; i ++) {
+        __atomic_store_n(&hist->buckets[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&hist->count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->sum_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->max_ns, 0, __ATOMIC_RELAXED);
+}
+
 /**
  * 线程信息（用于监控）
  */
@@ -14,6 +62,32 @@ typedef struct {
 	thread_info_t *info;
 } thread_arg_t;
 
+typedef struct {
+    thread_info_t *info;
+    uint64_t start_ns;                  // 本轮取任务的起点，回调后推进到回调时刻
+} worker_done_ctx_t;
+
+/**
+ * @name _worker_on_task_done
+ * @brief 任务完成回调：在队列计入完成之前记录该 worker 的耗时与直方图
+ */
+static void _worker_on_task_done(const task_exec_info_t *exec_info, void *arg) {
+    worker_done_ctx_t *ctx = (worker_done_ctx_t *)arg;
+    thread_info_t *info = ctx->info;
+    uint64_t now_ns = _now_ns();
+    uint64_t elapsed_ns = now_ns - ctx->start_ns;
+    uint64_t exec_ns = MIN(exec_info->exec_ns, elapsed_ns);
+
+    info->tasks_completed++;
+    __atomic_fetch_add(&info->busy_ns, exec_ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&info->idle_ns, elapsed_ns - exec_ns, __ATOMIC_RELAXED);
+    _hist_record(&info->wait_hist, exec_info->wait_ns);
+    _hist_record(&info->exec_hist, exec_info->exec_ns);
+    ctx->start_ns = now_ns;
+
+    DEBUG_PRINT("Worker %d completed task (%.2f ms)", info->id, exec_ns / 1e6);
+}
+
 static void *_work_thread(void *arg) {
     thread_arg_t *thread_arg = (thread_arg_t *)arg;
     thread_pool_t *pool = thread_arg->pool;
@@ -21,10 +95,29 @@ static void *_work_thread(void *arg) {
     
     // 保存线程 ID
     info->tid = pthread_self();
+    __atomic_store_n(&info->os_tid, (int)syscall(SYS_gettid), __ATOMIC_RELEASE);
     INFO_PRINT("Worker thread started (id: %d, tid: %lu)",
             info->id, (unsigned long)info->tid);
     free(thread_arg);
 
+    char trace_name[32];
+    snprintf(trace_name, sizeof(trace_name), "worker-%d", info->id);
+    trace_set_thread_name(trace_name);
+
+    // 绑定到分配的 CPU（失败时继续以不绑定方式运行）
+    if (info->cpu >= 0) {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(info->cpu, &mask);
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+        if (ret != 0) {
+            WARN_PRINT("Worker %d failed to pin to cpu %d: %s",
+                    info->id, info->cpu, strerror(ret));
+        } else {
+            DEBUG_PRINT("Worker %d pinned to cpu %d", info->id, info->cpu);
+        }
+    }
+
     while (true) {
         // 线程安全地检查退出标志
         pthread_mutex_lock(&pool->state_lock);
@@ -37,22 +130,19 @@ static void *_work_thread(void *arg) {
         }
 
         info->is_active = true;
-        struct timeval start, end;
-        gettimeofday(&start, NULL);
+        worker_done_ctx_t done_ctx = { .info = info, .start_ns = _now_ns() };
 
         // 直接传递 pool->shutdown 的地址，确保读取到最新值
-        int ret = task_queue_pop_and_execute(pool->task_queue, (bool*)&pool->shutdown);
+        // 统计在回调中记录，保证 thread_pool_wait_all 返回时已经可见
+        int ret = task_queue_pop_and_execute(pool->task_queue, (bool*)&pool->shutdown,
+                                             _worker_on_task_done, &done_ctx);
         
-        gettimeofday(&end, NULL);
-        double elapsed = (end.tv_sec - start.tv_sec) * 1000.0 +
-                         ((double)end.tv_usec - start.tv_usec) / 1000.0;
+        // 回调之后（或未执行任务时）的剩余时间计为空闲
+        __atomic_fetch_add(&info->idle_ns, _now_ns() - done_ctx.start_ns, __ATOMIC_RELAXED);
 
         if (ret == 1) {
             DEBUG_PRINT("Worker %d received shutdown signal", info->id);
             break;
-        } else if (ret == 0) {
-            info->tasks_completed++;
-            DEBUG_PRINT("Worker %d completed task (%.2f ms)", info->id, elapsed);
         }
         
         info->is_active = false;
@@ -64,6 +154,59 @@ static void *_work_thread(void *arg) {
     return NULL;
 }
 
+/**
+ * @name _thread_pool_init_affinity
+ * @brief 根据配置计算候选 CPU 列表
+ * 
+ * @return 成功返回 0（包括不绑定的情况），失败返回 -1
+ */
+static int _thread_pool_init_affinity(thread_pool_t *pool, const thread_pool_cfg_t *config) {
+    pool->cpu_list = NULL;
+    pool->num_cpus = 0;
+
+    if (config->affinity == AFFINITY_NONE) {
+        if (config->avoid_smt) {
+            WARN_PRINT("avoid_smt ignored without an affinity mode");
+        }
+        return 0;
+    }
+
+    cpu_topology_t *topo = cpu_topology_detect();
+    if (topo == NULL) {
+        ERROR_PRINT("Failed to detect CPU topology");
+        return -1;
+    }
+
+    pool->cpu_list = (int *)malloc(topo->num_cpus * sizeof(int));
+    if (pool->cpu_list == NULL) {
+        ERROR_PRINT("Failed to allocate cpu list");
+        cpu_topology_free(topo);
+        return -1;
+    }
+
+    int n = cpu_topology_select(topo, config->affinity, config->avoid_smt,
+                                config->numa_node, config->cpuset,
+                                pool->cpu_list, topo->num_cpus);
+    cpu_topology_free(topo);
+    if (n <= 0) {
+        free(pool->cpu_list);
+        pool->cpu_list = NULL;
+        return -1;
+    }
+    pool->num_cpus = n;
+
+    if (config->num_threads > n) {
+        WARN_PRINT("%d threads share %d pinned cpus", config->num_threads, n);
+    }
+    INFO_PRINT("Thread pool affinity: mode %d, %d candidate cpus", config->affinity, n);
+    return 0;
+}
+
+static int _thread_pool_cpu_for(const thread_pool_t *pool, int thread_id) {
+    if (pool->num_cpus <= 0) return -1;
+    return pool->cpu_list[thread_id % pool->num_cpus];
+}
+
 static int _thread_pool_expand(thread_pool_t *pool, int new_size, int cur_size) {
     INFO_PRINT("Expanding thread pool by %d threads", new_size - cur_size);
 
@@ -88,7 +231,9 @@ static int _thread_pool_expand(thread_pool_t *pool, int new_size, int cur_size)
 
     // 创建新线程
     for (int i = cur_size; i < new_size; i ++) {
+        memset(&pool->thread_infos[i], 0, sizeof(thread_info_t));
         pool->thread_infos[i].id = i;
+        pool->thread_infos[i].cpu = _thread_pool_cpu_for(pool, i);
         pool->thread_infos[i].tasks_completed = 0;
         pool->thread_infos[i].is_active = false;
         pool->thread_infos[i].should_exit = false;
@@ -223,6 +368,9 @@ thread_pool_t *thread_pool_create(const thread_pool_cfg_t *config) {
 	pool->num_threads =config->num_threads;
 	pool->state = POOL_CREATED;
 	pool->shutdown = false;
+	pool->stats.total_tasks = 0;
+	pool->stats.failed_tasks = 0;
+	pool->stats.start_ns = _now_ns();
 
 	if (pthread_mutex_init(&pool->state_lock, NULL) != 0) {
 		ERROR_PRINT("Failed to initialize mutex");
@@ -261,9 +409,23 @@ thread_pool_t *thread_pool_create(const thread_pool_cfg_t *config) {
 		return NULL;
 	}
 
+	// 计算 CPU 亲和性
+	if (_thread_pool_init_affinity(pool, config) != 0) {
+		ERROR_PRINT("Failed to apply affinity configuration");
+		task_queue_destroy(pool->task_queue);
+		free(pool->threads);
+		free(pool->thread_infos);
+		pthread_mutex_destroy(&pool->state_lock);
+		pthread_cond_destroy(&pool->state_changed);
+		free(pool);
+		return NULL;
+	}
+
 	// 创建工作线程
 	for (int i = 0; i < config->num_threads; i ++) {
+		memset(&pool->thread_infos[i], 0, sizeof(thread_info_t));
 		pool->thread_infos[i].id = i;
+		pool->thread_infos[i].cpu = _thread_pool_cpu_for(pool, i);
 		pool->thread_infos[i].tasks_completed = 0;
 		pool->thread_infos[i].is_active = false;
 		pool->thread_infos[i].should_exit = false;
@@ -282,6 +444,7 @@ thread_pool_t *thread_pool_create(const thread_pool_cfg_t *config) {
 			task_queue_destroy(pool->task_queue);
 			free(pool->threads);
 			free(pool->thread_infos);
+			free(pool->cpu_list);
 			pthread_mutex_destroy(&pool->state_lock);
 			pthread_cond_destroy(&pool->state_changed);
 			free(pool);
@@ -319,6 +482,7 @@ thread_pool_t *thread_pool_create(const thread_pool_cfg_t *config) {
 			task_queue_destroy(pool->task_queue);
 			free(pool->threads);
 			free(pool->thread_infos);
+			free(pool->cpu_list);
 			pthread_mutex_destroy(&pool->state_lock);
 			pthread_cond_destroy(&pool->state_changed);
 			free(pool);
@@ -366,6 +530,7 @@ void thread_pool_destroy(thread_pool_t *pool) {
 	task_queue_destroy(pool->task_queue);
 	free(pool->threads);
 	free(pool->thread_infos);
+	free(pool->cpu_list);
 
 	pthread_mutex_lock(&pool->state_lock);
 	pool->state = POOL_STOPPED;
@@ -383,6 +548,11 @@ void thread_pool_destroy(thread_pool_t *pool) {
 }
 
 int thread_pool_submit(thread_pool_t *pool, void (*func)(void *), void *arg, void (*cleanup)(void *)) {
+    return thread_pool_submit_prio(pool, func, arg, cleanup, TASK_PRIO_NORMAL);
+}
+
+int thread_pool_submit_prio(thread_pool_t *pool, void (*func)(void *), void *arg,
+                            void (*cleanup)(void *), task_priority_t priority) {
     if (pool == NULL || func == NULL) {
         ERROR_PRINT("Invalid arguments");
         return -1;
@@ -393,25 +563,30 @@ int thread_pool_submit(thread_pool_t *pool, void (*func)(void *), void *arg, voi
     if (pool->state != POOL_RUNNING) {
         ERROR_PRINT("Thread pool is not running");
         pthread_mutex_unlock(&pool->state_lock);
+        __atomic_fetch_add(&pool->stats.failed_tasks, 1, __ATOMIC_RELAXED);
         return -1;
     }
     pthread_mutex_unlock(&pool->state_lock);
 
-    int ret = task_queue_submit(pool->task_queue, func, arg, cleanup);
+    int ret = task_queue_submit_prio(pool->task_queue, func, arg, cleanup, priority);
     if (ret != 0) {
         ERROR_PRINT("Failed to submit task to queue");
+        __atomic_fetch_add(&pool->stats.failed_tasks, 1, __ATOMIC_RELAXED);
         return -1;
     }
 
+    __atomic_fetch_add(&pool->stats.total_tasks, 1, __ATOMIC_RELAXED);
     return 0;
 }
 
 void thread_pool_wait_all(thread_pool_t *pool) {
 	if (pool == NULL) return;
 
-	INFO_PRINT("Waiting for all tasks to complete");
+	DEBUG_PRINT("Waiting for all tasks to complete");
+	uint64_t trace_start_ns = trace_now();
 	task_queue_wait_empty(pool->task_queue);
-	INFO_PRINT("All tasks completed");
+	trace_complete("wait_all", "pool", trace_start_ns, 0);
+	DEBUG_PRINT("All tasks completed");
 	
 	return;
 }
@@ -486,13 +661,193 @@ void thread_pool_print_info(const thread_pool_t *pool) {
     
     if (thread_infos_snapshot != NULL) {
         for (int i = 0; i < num_threads; i++) {
-            printf("║   [%2d] tasks=%-8zu %-13s║\n",
+            char cpu_str[8] = "-";
+            if (thread_infos_snapshot[i].cpu >= 0) {
+                snprintf(cpu_str, sizeof(cpu_str), "%d", thread_infos_snapshot[i].cpu);
+            }
+            printf("║   [%2d] tasks=%-7zu %-6s cpu=%-3s║\n",
                    i,
                    thread_infos_snapshot[i].tasks_completed,
-                   thread_infos_snapshot[i].is_active ? "ACTIVE" : "IDLE");
+                   thread_infos_snapshot[i].is_active ? "ACTIVE" : "IDLE",
+                   cpu_str);
         }
         free(thread_infos_snapshot);
     }
     
     printf("╚════════════════════════════════════╝\n");
-}
\ No newline at end of file
+}
+
+/* ======== 遥测 API ======== */
+
+uint64_t pool_histogram_percentile(const pool_histogram_t *hist, double q) {
+    if (hist == NULL || hist->count == 0) return 0;
+
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+
+    uint64_t rank = (uint64_t)(q * (double)hist->count);
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < POOL_HIST_BUCKETS; i ++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint64_t upper = (i + 1 < 64) ? (1ull << (i + 1)) : UINT64_MAX;
+            return MIN(upper, hist->max_ns);
+        }
+    }
+    return hist->max_ns;
+}
+
+int thread_pool_get_worker_tids(thread_pool_t *pool, int *tids, int max) {
+    if (pool == NULL || tids == NULL || max <= 0) {
+        ERROR_PRINT("Invalid arguments");
+        return -1;
+    }
+
+    pthread_mutex_lock(&pool->state_lock);
+    int count = MIN(pool->num_threads, max);
+    uint64_t deadline = _now_ns() + WORKER_TID_TIMEOUT_NS;
+
+    for (int i = 0; i < count; i ++) {
+        // 线程在启动后才发布自己的 tid，创建后立即调用时需要短暂等待
+        int tid;
+        while ((tid = __atomic_load_n(&pool->thread_infos[i].os_tid, __ATOMIC_ACQUIRE)) == 0) {
+            if (_now_ns() > deadline) {
+                pthread_mutex_unlock(&pool->state_lock);
+                ERROR_PRINT("Timed out waiting for worker %d to start", i);
+                return -1;
+            }
+            sched_yield();
+        }
+        tids[i] = tid;
+    }
+    pthread_mutex_unlock(&pool->state_lock);
+
+    return count;
+}
+
+int thread_pool_get_stats(thread_pool_t *pool, thread_pool_stats_t *stats) {
+    if (pool == NULL || stats == NULL) {
+        ERROR_PRINT("Invalid arguments");
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    pthread_mutex_lock(&pool->state_lock);
+    int num_threads = pool->num_threads;
+    stats->workers = (pool_worker_stats_t *)calloc(num_threads, sizeof(pool_worker_stats_t));
+    if (stats->workers == NULL) {
+        pthread_mutex_unlock(&pool->state_lock);
+        ERROR_PRINT("Failed to allocate worker stats");
+        return -1;
+    }
+    stats->num_threads = num_threads;
+
+    for (int i = 0; i < num_threads; i ++) {
+        thread_info_t *info = &pool->thread_infos[i];
+        pool_worker_stats_t *w = &stats->workers[i];
+
+        w->id = info->id;
+        w->cpu = info->cpu;
+        w->tasks_completed = __atomic_load_n(&info->exec_hist.count, __ATOMIC_RELAXED);
+        w->busy_ns = __atomic_load_n(&info->busy_ns, __ATOMIC_RELAXED);
+        w->idle_ns = __atomic_load_n(&info->idle_ns, __ATOMIC_RELAXED);
+        uint64_t total_ns = w->busy_ns + w->idle_ns;
+        w->utilization = total_ns > 0 ? (double)w->busy_ns / total_ns : 0.0;
+
+        _hist_merge(&stats->wait_hist, &info->wait_hist);
+        _hist_merge(&stats->exec_hist, &info->exec_hist);
+        stats->completed += w->tasks_completed;
+    }
+    stats->elapsed_ms = (_now_ns() - pool->stats.start_ns) / 1e6;
+    pthread_mutex_unlock(&pool->state_lock);
+
+    stats->submitted = __atomic_load_n(&pool->stats.total_tasks, __ATOMIC_RELAXED);
+    stats->failed = __atomic_load_n(&pool->stats.failed_tasks, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&pool->task_queue->mutex);
+    stats->queue_depth = pool->task_queue->count;
+    stats->queue_high_water = pool->task_queue->stats.max_depth;
+    pthread_mutex_unlock(&pool->task_queue->mutex);
+
+    return 0;
+}
+
+void thread_pool_stats_free(thread_pool_stats_t *stats) {
+    if (stats == NULL) return;
+
+    free(stats->workers);
+    stats->workers = NULL;
+    stats->num_threads = 0;
+}
+
+void thread_pool_reset_stats(thread_pool_t *pool) {
+    if (pool == NULL) return;
+
+    pthread_mutex_lock(&pool->state_lock);
+    for (int i = 0; i < pool->num_threads; i ++) {
+        thread_info_t *info = &pool->thread_infos[i];
+        __atomic_store_n(&info->busy_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&info->idle_ns, 0, __ATOMIC_RELAXED);
+        _hist_reset(&info->wait_hist);
+        _hist_reset(&info->exec_hist);
+    }
+    __atomic_store_n(&pool->stats.total_tasks, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->stats.failed_tasks, 0, __ATOMIC_RELAXED);
+    pool->stats.start_ns = _now_ns();
+    pthread_mutex_unlock(&pool->state_lock);
+
+    task_queue_reset_stats(pool->task_queue);
+}
+
+static void _dump_histogram(FILE *fp, const char *name, const pool_histogram_t *hist) {
+    fprintf(fp, "\"%s\":{\"count\":%llu,\"mean\":%.1f,"
+                "\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%llu,\"buckets\":[",
+            name,
+            (unsigned long long)hist->count,
+            hist->count > 0 ? (double)hist->sum_ns / hist->count : 0.0,
+            (unsigned long long)pool_histogram_percentile(hist, 0.50),
+            (unsigned long long)pool_histogram_percentile(hist, 0.90),
+            (unsigned long long)pool_histogram_percentile(hist, 0.99),
+            (unsigned long long)hist->max_ns);
+    for (int i = 0; i < POOL_HIST_BUCKETS; i ++) {
+        fprintf(fp, "%s%llu", i > 0 ? "," : "", (unsigned long long)hist->buckets[i]);
+    }
+    fprintf(fp, "]}");
+}
+
+int thread_pool_dump_stats(thread_pool_t *pool, FILE *fp) {
+    if (pool == NULL || fp == NULL) {
+        ERROR_PRINT("Invalid arguments");
+        return -1;
+    }
+
+    thread_pool_stats_t stats;
+    if (thread_pool_get_stats(pool, &stats) != 0) {
+        return -1;
+    }
+
+    fprintf(fp, "{\"num_threads\":%d,\"elapsed_ms\":%.3f,", stats.num_threads, stats.elapsed_ms);
+    fprintf(fp, "\"tasks\":{\"submitted\":%zu,\"failed\":%zu,\"completed\":%zu},",
+            stats.submitted, stats.failed, stats.completed);
+    fprintf(fp, "\"queue\":{\"depth\":%zu,\"high_water\":%zu,\"capacity\":%zu},",
+            stats.queue_depth, stats.queue_high_water, pool->task_queue->max_count);
+    _dump_histogram(fp, "wait_ns", &stats.wait_hist);
+    fprintf(fp, ",");
+    _dump_histogram(fp, "exec_ns", &stats.exec_hist);
+    fprintf(fp, ",\"workers\":[");
+    for (int i = 0; i < stats.num_threads; i ++) {
+        const pool_worker_stats_t *w = &stats.workers[i];
+        fprintf(fp, "%s{\"id\":%d,\"cpu\":%d,\"tasks\":%zu,\"busy_ns\":%llu,"
+                    "\"idle_ns\":%llu,\"utilization\":%.4f}",
+                i > 0 ? "," : "", w->id, w->cpu, w->tasks_completed,
+                (unsigned long long)w->busy_ns, (unsigned long long)w->idle_ns,
+                w->utilization);
+    }
+    fprintf(fp, "]}\n");
+
+    thread_pool_stats_free(&stats);
+    return 0;
+}
@@ -0,0 +1,247 @@
+#define _GNU_SOURCE
+#include "trace.h"
+#include <pthread.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+/* ============= 内部数据结构 ============= */
+
+typedef struct {
+    const char *name;
+    const char *cat;
+    uint64_t start_ns;
+    uint64_t dur_ns;
+    int64_t arg;
+} trace_event_t;
+
+/**
+ * 线程私有事件缓冲区
+ *
+ * 只有所属线程写入 events/count；导出时由调用者保证线程静止。
+ */
+typedef struct trace_buffer {
+    trace_event_t *events;
+    size_t count;
+    size_t capacity;
+    size_t dropped;
+    int tid;
+    char thread_name[32];
+    struct trace_buffer *next;
+} trace_buffer_t;
+
+static int g_trace_enabled = 0;
+static unsigned g_trace_generation = 1;     // trace_start/trace_reset 时递增，使旧的线程缓冲区指针失效
+static size_t g_events_per_thread = TRACE_DEFAULT_EVENTS_PER_THREAD;
+static uint64_t g_trace_origin_ns = 0;
+static trace_buffer_t *g_buffers = NULL;
+static pthread_mutex_t g_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static _Thread_local trace_buffer_t *tls_buffer = NULL;
+static _Thread_local unsigned tls_generation = 0;
+static _Thread_local char tls_thread_name[32] = "";
+
+/* ============= 内部辅助函数 ============= */
+
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @name _trace_free_buffers_locked
+ * @brief 释放所有线程缓冲区（调用者需持有 g_trace_lock）
+ */
+static void _trace_free_buffers_locked(void) {
+    trace_buffer_t *buf = g_buffers;
+    while (buf != NULL) {
+        trace_buffer_t *next = buf->next;
+        free(buf->events);
+        free(buf);
+        buf = next;
+    }
+    g_buffers = NULL;
+}
+
+/**
+ * @name _trace_get_buffer
+ * @brief 获取当前线程的缓冲区，首次调用时分配并注册
+ *
+ * @return 缓冲区指针；分配失败返回 NULL
+ */
+static trace_buffer_t* _trace_get_buffer(void) {
+    unsigned generation = __atomic_load_n(&g_trace_generation, __ATOMIC_ACQUIRE);
+    if (tls_buffer != NULL && tls_generation == generation) {
+        return tls_buffer;
+    }
+
+    trace_buffer_t *buf = (trace_buffer_t *)calloc(1, sizeof(trace_buffer_t));
+    if (buf == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_trace_lock);
+    buf->capacity = g_events_per_thread;
+    buf->events = (trace_event_t *)malloc(buf->capacity * sizeof(trace_event_t));
+    if (buf->events == NULL) {
+        pthread_mutex_unlock(&g_trace_lock);
+        free(buf);
+        return NULL;
+    }
+    buf->tid = (int)syscall(SYS_gettid);
+    if (tls_thread_name[0] != '\0') {
+        snprintf(buf->thread_name, sizeof(buf->thread_name), "%s", tls_thread_name);
+    } else {
+        snprintf(buf->thread_name, sizeof(buf->thread_name), "thread-%d", buf->tid);
+    }
+    buf->next = g_buffers;
+    g_buffers = buf;
+    generation = g_trace_generation;
+    pthread_mutex_unlock(&g_trace_lock);
+
+    tls_buffer = buf;
+    tls_generation = generation;
+    return buf;
+}
+
+/* ============= 对外接口函数 ============= */
+
+int trace_start(size_t events_per_thread) {
+    pthread_mutex_lock(&g_trace_lock);
+
+    _trace_free_buffers_locked();
+    g_events_per_thread = events_per_thread > 0 ? events_per_thread
+                                                : TRACE_DEFAULT_EVENTS_PER_THREAD;
+    g_trace_origin_ns = _now_ns();
+    __atomic_add_fetch(&g_trace_generation, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_trace_enabled, 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&g_trace_lock);
+
+    INFO_PRINT("Tracing started (%zu events per thread)", g_events_per_thread);
+    return 0;
+}
+
+void trace_stop(void) {
+    __atomic_store_n(&g_trace_enabled, 0, __ATOMIC_RELEASE);
+}
+
+void trace_reset(void) {
+    pthread_mutex_lock(&g_trace_lock);
+    __atomic_store_n(&g_trace_enabled, 0, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&g_trace_generation, 1, __ATOMIC_RELEASE);
+    _trace_free_buffers_locked();
+    pthread_mutex_unlock(&g_trace_lock);
+}
+
+bool trace_enabled(void) {
+    return __atomic_load_n(&g_trace_enabled, __ATOMIC_RELAXED) != 0;
+}
+
+uint64_t trace_now(void) {
+    if (!trace_enabled()) return 0;
+    return _now_ns();
+}
+
+void trace_complete(const char *name, const char *cat, uint64_t start_ns, int64_t arg) {
+    if (start_ns == 0 || !trace_enabled()) return;
+
+    uint64_t end_ns = _now_ns();
+
+    trace_buffer_t *buf = _trace_get_buffer();
+    if (buf == NULL) return;
+
+    if (buf->count >= buf->capacity) {
+        buf->dropped ++;
+        return;
+    }
+
+    trace_event_t *ev = &buf->events[buf->count ++];
+    ev->name = name;
+    ev->cat = cat;
+    ev->start_ns = start_ns;
+    ev->dur_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+    ev->arg = arg;
+}
+
+void trace_set_thread_name(const char *name) {
+    if (name == NULL) return;
+
+    snprintf(tls_thread_name, sizeof(tls_thread_name), "%s", name);
+
+    unsigned generation = __atomic_load_n(&g_trace_generation, __ATOMIC_ACQUIRE);
+    if (tls_buffer != NULL && tls_generation == generation) {
+        pthread_mutex_lock(&g_trace_lock);
+        snprintf(tls_buffer->thread_name, sizeof(tls_buffer->thread_name), "%s", name);
+        pthread_mutex_unlock(&g_trace_lock);
+    }
+}
+
+size_t trace_event_count(size_t *dropped) {
+    size_t total = 0;
+    size_t total_dropped = 0;
+
+    pthread_mutex_lock(&g_trace_lock);
+    for (trace_buffer_t *buf = g_buffers; buf != NULL; buf = buf->next) {
+        total += buf->count;
+        total_dropped += buf->dropped;
+    }
+    pthread_mutex_unlock(&g_trace_lock);
+
+    if (dropped != NULL) *dropped = total_dropped;
+    return total;
+}
+
+int trace_export_chrome(const char *path) {
+    if (path == NULL) {
+        ERROR_PRINT("Invalid trace output path");
+        return -1;
+    }
+
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        ERROR_PRINT("Failed to open trace file %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    int pid = (int)getpid();
+    size_t total = 0;
+    size_t dropped = 0;
+    bool first = true;
+
+    pthread_mutex_lock(&g_trace_lock);
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (trace_buffer_t *buf = g_buffers; buf != NULL; buf = buf->next) {
+        // 线程名元数据事件
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                    "\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", pid, buf->tid, buf->thread_name);
+        first = false;
+
+        for (size_t i = 0; i < buf->count; i ++) {
+            const trace_event_t *ev = &buf->events[i];
+            uint64_t rel_ns = ev->start_ns > g_trace_origin_ns ? ev->start_ns - g_trace_origin_ns : 0;
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                        "\"pid\":%d,\"tid\":%d,\"args\":{\"arg\":%lld}}",
+                    ev->name, ev->cat, rel_ns / 1000.0, ev->dur_ns / 1000.0,
+                    pid, buf->tid, (long long)ev->arg);
+        }
+        total += buf->count;
+        dropped += buf->dropped;
+    }
+    fprintf(fp, "\n]}\n");
+
+    pthread_mutex_unlock(&g_trace_lock);
+
+    if (fclose(fp) != 0) {
+        ERROR_PRINT("Failed to write trace file %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    if (dropped > 0) {
+        WARN_PRINT("Trace buffers overflowed, %zu events dropped", dropped);
+    }
+    INFO_PRINT("Exported %zu trace events to %s", total, path);
+    return 0;
+}
@@ -0,0 +1,543 @@
+#define _GNU_SOURCE
+#include "gpt2.h"
+#include "matrix_parallel.h"
+#include "matrix_autotune.h"
+#include "tensor.h"
+#include "common.h"
+#include <sys/resource.h>
+#include <time.h>
+#include <math.h>
+
+/**
+ * 端到端 GPT-2 推理基准
+ *
+ * 用随机权重构建模型，模拟一次生成请求：
+ *   prefill: 对 prompt 做一次前向，取最后一个位置的 argmax 作为第一个生成 token
+ *   decode:  每步把上一步生成的 token 追加到上下文，再做一次前向
+ *
+ * 当前没有 KV cache，decode 每步都重算整个前缀，因此单步延迟随上下文增长；
+ * 基准如实测量这一点，将来引入 KV cache 后 decode 指标会直接体现收益。
+ *
+ * 用法：
+ *   benchmark_gpt2 [--config tiny|small|gpt2] [--threads N] [--prompt N] [--gen N]
+ *                  [--warmup N] [--repeat N] [--json out.json] [--compare baseline.json]
+ *                  [--threshold PCT]
+ *
+ * 整个测量重复 --repeat 次（默认 3），每项指标取中位数，避免单次抖动触发门禁。
+ * 最近秩 p99 至少需要 100 个 decode 步才不退化为最大值，预设的生成长度据此选取。
+ *
+ * --compare 时逐项与基线比较，任一指标变差超过阈值（默认 10%）即返回 1，
+ * 可直接作为上线前的门禁。
+ */
+
+#define DEFAULT_THRESHOLD_PCT 10.0
+#define DEFAULT_REPEAT 3
+#define MIN_P99_STEPS 100           // 少于此步数时 p99 就是最慢的那一步
+
+typedef struct {
+    const char *name;
+    gpt2_config_t cfg;
+    size_t prompt_len;
+    size_t gen_len;
+} bench_preset_t;
+
+static const bench_preset_t g_presets[] = {
+    // tiny：make benchmark 中默认运行，几秒内完成
+    {"tiny",  {512,   128,  64,  4,  2,  256,  0.0f}, 16,  112},
+    {"small", {8192,  256,  256, 8,  4,  1024, 0.0f}, 64,  128},
+    // GPT-2 small 的真实形状
+    {"gpt2",  {50257, 1024, 768, 12, 12, 3072, 0.0f}, 128, 128},
+};
+
+/**
+ * 基准指标（JSON 中的键名与比较方向）
+ */
+typedef enum {
+    METRIC_SCORE = 0,           // 端到端生成吞吐（tokens/s，含 prefill），即上线前要盯的那个数
+    METRIC_PREFILL_TOK_S,
+    METRIC_TTFT_MS,
+    METRIC_DECODE_P50_MS,
+    METRIC_DECODE_P99_MS,
+    METRIC_DECODE_MEAN_MS,
+    METRIC_PEAK_RSS_KB,
+    METRIC_ALLOCS_PER_TOKEN,
+    METRIC_COUNT
+} metric_id_t;
+
+typedef struct {
+    const char *key;
+    bool higher_is_better;
+} metric_def_t;
+
+static const metric_def_t g_metrics[METRIC_COUNT] = {
+    [METRIC_SCORE]            = {"score_tok_s", true},
+    [METRIC_PREFILL_TOK_S]    = {"prefill_tok_s", true},
+    [METRIC_TTFT_MS]          = {"ttft_ms", false},
+    [METRIC_DECODE_P50_MS]    = {"decode_p50_ms", false},
+    [METRIC_DECODE_P99_MS]    = {"decode_p99_ms", false},
+    [METRIC_DECODE_MEAN_MS]   = {"decode_mean_ms", false},
+    [METRIC_PEAK_RSS_KB]      = {"peak_rss_kb", false},
+    [METRIC_ALLOCS_PER_TOKEN] = {"allocs_per_token", false},
+};
+
+typedef struct {
+    const bench_preset_t *preset;
+    int num_threads;
+    size_t prompt_len;
+    size_t gen_len;
+    size_t repeat;                      // 测量重复次数，指标取中位数
+    char cpu_model[128];
+    double values[METRIC_COUNT];
+} bench_result_t;
+
+static double _now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int _cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * 最近秩百分位（输入需已排序）
+ */
+static double _percentile(const double *sorted, size_t n, double p) {
+    size_t rank = (size_t)ceil(p / 100.0 * (double)n);
+    if (rank == 0) rank = 1;
+    return sorted[MIN(rank, n) - 1];
+}
+
+static size_t _argmax_last_row(const Tensor *logits, size_t seq_len, size_t vocab) {
+    const float *row = logits->data + (seq_len - 1) * vocab;
+    size_t best = 0;
+    for (size_t v = 1; v < vocab; v ++) {
+        if (row[v] > row[best]) best = v;
+    }
+    return best;
+}
+
+/**
+ * 中位数（会就地排序输入）
+ */
+static double _median(double *values, size_t n) {
+    qsort(values, n, sizeof(double), _cmp_double);
+    return (n % 2) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+/**
+ * 对 ids[0, seq_len) 做一次前向，下一个 token 写入 *next
+ *
+ * @return 成功返回 0，分配或前向失败返回 -1
+ */
+static int _next_token(gpt2_model_t *model, const float *ids, size_t seq_len, size_t *next) {
+    size_t vocab = model->cfg.vocab_size;
+    size_t in_shape[] = {seq_len};
+    size_t out_shape[] = {seq_len, vocab};
+    int ret = -1;
+
+    Tensor *input = tensor_from_data(1, in_shape, ids);
+    Tensor *logits = tensor_create(2, out_shape);
+    if (input == NULL || logits == NULL) {
+        ERROR_PRINT("Failed to allocate forward buffers");
+    } else if (gpt2_forward(model, input, logits) != 0) {
+        ERROR_PRINT("Forward failed at seq_len %zu", seq_len);
+    } else {
+        *next = _argmax_last_row(logits, seq_len, vocab);
+        ret = 0;
+    }
+
+    if (input != NULL) tensor_free(input);
+    if (logits != NULL) tensor_free(logits);
+    return ret;
+}
+
+/**
+ * 一次完整测量：prefill 生成第一个 token，再 decode 其余 gen_len - 1 个，指标写入 values
+ *
+ * @return 成功返回 0，任一步前向失败返回 -1
+ */
+static int _measure_once(gpt2_model_t *model, float *ids, size_t prompt_len, size_t gen_len,
+                         double *step_ms, double *values) {
+    size_t next = 0;
+
+    // Prefill + 第一个 token
+    double t0 = _now_ms();
+    if (_next_token(model, ids, prompt_len, &next) != 0) return -1;
+    double ttft_ms = _now_ms() - t0;
+    ids[prompt_len] = (float)next;
+
+    // Decode：其余 gen_len - 1 个 token
+    size_t steps = gen_len - 1;
+    uint64_t allocs_before = tensor_alloc_count();
+    double decode_total_ms = 0.0;
+    for (size_t s = 0; s < steps; s ++) {
+        size_t ctx = prompt_len + 1 + s;
+        double ts = _now_ms();
+        if (_next_token(model, ids, ctx, &next) != 0) return -1;
+        step_ms[s] = _now_ms() - ts;
+        ids[ctx] = (float)next;
+        decode_total_ms += step_ms[s];
+    }
+    uint64_t allocs = tensor_alloc_count() - allocs_before;
+
+    qsort(step_ms, steps, sizeof(double), _cmp_double);
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    values[METRIC_SCORE] = gen_len / ((ttft_ms + decode_total_ms) / 1000.0);
+    values[METRIC_PREFILL_TOK_S] = prompt_len / (ttft_ms / 1000.0);
+    values[METRIC_TTFT_MS] = ttft_ms;
+    values[METRIC_DECODE_P50_MS] = _percentile(step_ms, steps, 50.0);
+    values[METRIC_DECODE_P99_MS] = _percentile(step_ms, steps, 99.0);
+    values[METRIC_DECODE_MEAN_MS] = decode_total_ms / steps;
+    values[METRIC_PEAK_RSS_KB] = (double)ru.ru_maxrss;
+    values[METRIC_ALLOCS_PER_TOKEN] = (double)allocs / steps;
+    return 0;
+}
+
+static int run_benchmark(bench_result_t *res, size_t warmup) {
+    const gpt2_config_t *cfg = &res->preset->cfg;
+    size_t prompt_len = res->prompt_len;
+    size_t gen_len = res->gen_len;
+
+    if (prompt_len == 0 || gen_len < 2 || prompt_len + gen_len > cfg->max_seq_len) {
+        ERROR_PRINT("Need prompt >= 1, gen >= 2 and prompt + gen <= %zu", cfg->max_seq_len);
+        return -1;
+    }
+    if (gen_len - 1 < MIN_P99_STEPS) {
+        WARN_PRINT("Only %zu decode steps: decode_p99_ms is just the slowest step", gen_len - 1);
+    }
+
+    matrix_config_t mcfg = {
+        .num_threads = res->num_threads,
+        .block_size = 32,
+        .use_blocking = true,
+        .use_simd = false
+    };
+    if (matrix_init(&mcfg) != 0) {
+        ERROR_PRINT("matrix_init failed");
+        return -1;
+    }
+    matmul_autotune_cpu_model(res->cpu_model, sizeof(res->cpu_model));
+
+    gpt2_model_t *model = gpt2_create(cfg);
+    if (model == NULL) {
+        matrix_cleanup();
+        return -1;
+    }
+
+    int ret = -1;
+    float *ids = (float *)malloc((prompt_len + gen_len) * sizeof(float));
+    double *step_ms = (double *)malloc(gen_len * sizeof(double));
+    // 按指标连续存放：runs[m * repeat + r]
+    double *runs = (double *)malloc(METRIC_COUNT * res->repeat * sizeof(double));
+    if (ids == NULL || step_ms == NULL || runs == NULL) {
+        ERROR_PRINT("Failed to allocate benchmark buffers");
+        goto out;
+    }
+
+    // 确定性的 prompt，使不同次运行的工作量一致
+    for (size_t i = 0; i < prompt_len; i ++) {
+        ids[i] = (float)((i * 2654435761u) % cfg->vocab_size);
+    }
+
+    // 预热：线程池启动、首次缺页、autotune 表查找
+    for (size_t w = 0; w < warmup; w ++) {
+        size_t next;
+        if (_next_token(model, ids, prompt_len, &next) != 0) goto out;
+    }
+
+    for (size_t r = 0; r < res->repeat; r ++) {
+        double values[METRIC_COUNT];
+        if (_measure_once(model, ids, prompt_len, gen_len, step_ms, values) != 0) {
+            ERROR_PRINT("Run %zu/%zu failed", r + 1, res->repeat);
+            goto out;
+        }
+        for (int m = 0; m < METRIC_COUNT; m ++) {
+            runs[m * res->repeat + r] = values[m];
+        }
+    }
+
+    // 每项指标独立取中位数
+    for (int m = 0; m < METRIC_COUNT; m ++) {
+        res->values[m] = _median(runs + m * res->repeat, res->repeat);
+    }
+    ret = 0;
+
+out:
+    free(ids);
+    free(step_ms);
+    free(runs);
+    gpt2_free(model);
+    matrix_cleanup();
+    return ret;
+}
+
+static void print_result(const bench_result_t *res) {
+    const gpt2_config_t *cfg = &res->preset->cfg;
+
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   GPT-2 End-to-End Results             ║");
+    INFO_PRINT("╚════════════════════════════════════════╝");
+    INFO_PRINT("Config: %s (layers=%zu, d_model=%zu, heads=%zu, vocab=%zu), threads=%d",
+               res->preset->name, cfg->num_layers, cfg->d_model, cfg->num_heads,
+               cfg->vocab_size, res->num_threads);
+    INFO_PRINT("Prompt: %zu tokens, generated: %zu tokens, median of %zu run(s)",
+               res->prompt_len, res->gen_len, res->repeat);
+    INFO_PRINT("CPU: %s", res->cpu_model);
+    for (int i = 0; i < METRIC_COUNT; i ++) {
+        INFO_PRINT("  %-18s %12.3f", g_metrics[i].key, res->values[i]);
+    }
+}
+
+static int write_json(const bench_result_t *res, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        ERROR_PRINT("Failed to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    const gpt2_config_t *cfg = &res->preset->cfg;
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"config\": \"%s\",\n", res->preset->name);
+    fprintf(fp, "  \"cpu_model\": \"%s\",\n", res->cpu_model);
+    fprintf(fp, "  \"threads\": %d,\n", res->num_threads);
+    fprintf(fp, "  \"num_layers\": %zu,\n", cfg->num_layers);
+    fprintf(fp, "  \"d_model\": %zu,\n", cfg->d_model);
+    fprintf(fp, "  \"num_heads\": %zu,\n", cfg->num_heads);
+    fprintf(fp, "  \"d_ff\": %zu,\n", cfg->d_ff);
+    fprintf(fp, "  \"vocab_size\": %zu,\n", cfg->vocab_size);
+    fprintf(fp, "  \"prompt_len\": %zu,\n", res->prompt_len);
+    fprintf(fp, "  \"gen_len\": %zu,\n", res->gen_len);
+    fprintf(fp, "  \"repeat\": %zu,\n", res->repeat);
+    for (int i = 0; i < METRIC_COUNT; i ++) {
+        fprintf(fp, "  \"%s\": %.6f%s\n", g_metrics[i].key, res->values[i],
+                i + 1 < METRIC_COUNT ? "," : "");
+    }
+    fprintf(fp, "}\n");
+
+    if (fclose(fp) != 0) {
+        ERROR_PRINT("Failed to write %s", path);
+        return -1;
+    }
+    INFO_PRINT("Results written to %s", path);
+    return 0;
+}
+
+static char* read_file(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        ERROR_PRINT("Failed to open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char *buf = (len >= 0) ? (char *)malloc((size_t)len + 1) : NULL;
+    if (buf != NULL) {
+        size_t n = fread(buf, 1, (size_t)len, fp);
+        buf[n] = '\0';
+    }
+    fclose(fp);
+    return buf;
+}
+
+/**
+ * 在扁平 JSON 对象中查找 "key": 之后的值起始位置
+ */
+static const char* json_find(const char *json, const char *key) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+
+    const char *p = strstr(json, pattern);
+    if (p == NULL) return NULL;
+    p += strlen(pattern);
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p ++;
+    if (*p != ':') return NULL;
+    p ++;
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p ++;
+    return p;
+}
+
+static bool json_number(const char *json, const char *key, double *value) {
+    const char *p = json_find(json, key);
+    if (p == NULL) return false;
+
+    char *end = NULL;
+    *value = strtod(p, &end);
+    return end != p;
+}
+
+static bool json_string(const char *json, const char *key, char *buf, size_t size) {
+    const char *p = json_find(json, key);
+    if (p == NULL || *p != '"' || size == 0) return false;
+    p ++;
+
+    size_t n = 0;
+    while (*p != '\0' && *p != '"' && n + 1 < size) buf[n ++] = *p ++;
+    buf[n] = '\0';
+    return true;
+}
+
+/**
+ * 与基线比较，返回变差超过阈值的指标数（-1 表示基线不可用）
+ */
+static int compare_baseline(const bench_result_t *res, const char *path, double threshold_pct) {
+    char *json = read_file(path);
+    if (json == NULL) return -1;
+
+    char text[128];
+    if (json_string(json, "config", text, sizeof(text)) && strcmp(text, res->preset->name) != 0) {
+        WARN_PRINT("Baseline config '%s' differs from current '%s'", text, res->preset->name);
+    }
+    if (json_string(json, "cpu_model", text, sizeof(text)) && strcmp(text, res->cpu_model) != 0) {
+        WARN_PRINT("Baseline was recorded on '%s', this machine is '%s'", text, res->cpu_model);
+    }
+    double base_threads = 0.0;
+    if (json_number(json, "threads", &base_threads) && (int)base_threads != res->num_threads) {
+        WARN_PRINT("Baseline used %d threads, current run uses %d", (int)base_threads, res->num_threads);
+    }
+
+    INFO_PRINT("Comparing against %s (threshold %.1f%%)", path, threshold_pct);
+    INFO_PRINT("  %-18s %12s %12s %9s  %s", "metric", "baseline", "current", "delta", "status");
+
+    int regressions = 0;
+    for (int i = 0; i < METRIC_COUNT; i ++) {
+        const metric_def_t *m = &g_metrics[i];
+        double base = 0.0;
+        if (!json_number(json, m->key, &base)) {
+            INFO_PRINT("  %-18s %12s %12.3f %9s  missing", m->key, "-", res->values[i], "-");
+            continue;
+        }
+
+        double cur = res->values[i];
+        double delta_pct = (base != 0.0) ? (cur - base) / fabs(base) * 100.0 : 0.0;
+        // 统一为 “变差的百分比”
+        double worse_pct = m->higher_is_better ? -delta_pct : delta_pct;
+        if (base == 0.0 && cur > 0.0 && !m->higher_is_better) worse_pct = INFINITY;
+
+        const char *status = "ok";
+        if (worse_pct > threshold_pct) {
+            status = "REGRESSION";
+            regressions ++;
+        } else if (worse_pct < -threshold_pct) {
+            status = "improved";
+        }
+        INFO_PRINT("  %-18s %12.3f %12.3f %+8.1f%%  %s", m->key, base, cur, delta_pct, status);
+    }
+
+    free(json);
+    return regressions;
+}
+
+static void usage(const char *prog) {
+    INFO_PRINT("Usage: %s [--config tiny|small|gpt2] [--threads N] [--prompt N] [--gen N]", prog);
+    INFO_PRINT("       %*s [--warmup N] [--repeat N] [--json out.json] [--compare baseline.json]",
+               (int)strlen(prog), "");
+    INFO_PRINT("       %*s [--threshold PCT]", (int)strlen(prog), "");
+}
+
+int main(int argc, char **argv) {
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   GPT-2 End-to-End Benchmark           ║");
+    INFO_PRINT("╚════════════════════════════════════════╝\n");
+
+    bench_result_t res;
+    memset(&res, 0, sizeof(res));
+    res.preset = &g_presets[0];
+    res.num_threads = 4;
+    res.repeat = DEFAULT_REPEAT;
+
+    size_t prompt_len = 0;
+    size_t gen_len = 0;
+    size_t warmup = 1;
+    const char *json_path = NULL;
+    const char *baseline_path = NULL;
+    double threshold_pct = DEFAULT_THRESHOLD_PCT;
+
+    for (int i = 1; i < argc; i ++) {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            usage(argv[0]);
+            return 0;
+        }
+        if (val == NULL) {
+            ERROR_PRINT("Missing value for %s", arg);
+            usage(argv[0]);
+            return 2;
+        }
+
+        if (strcmp(arg, "--config") == 0) {
+            res.preset = NULL;
+            for (size_t p = 0; p < ARRAY_SIZE(g_presets); p ++) {
+                if (strcmp(val, g_presets[p].name) == 0) res.preset = &g_presets[p];
+            }
+            if (res.preset == NULL) {
+                ERROR_PRINT("Unknown config '%s'", val);
+                return 2;
+            }
+        } else if (strcmp(arg, "--threads") == 0) {
+            res.num_threads = atoi(val);
+        } else if (strcmp(arg, "--prompt") == 0) {
+            prompt_len = (size_t)atol(val);
+        } else if (strcmp(arg, "--gen") == 0) {
+            gen_len = (size_t)atol(val);
+        } else if (strcmp(arg, "--warmup") == 0) {
+            warmup = (size_t)atol(val);
+        } else if (strcmp(arg, "--repeat") == 0) {
+            res.repeat = (size_t)atol(val);
+        } else if (strcmp(arg, "--json") == 0) {
+            json_path = val;
+        } else if (strcmp(arg, "--compare") == 0) {
+            baseline_path = val;
+        } else if (strcmp(arg, "--threshold") == 0) {
+            threshold_pct = atof(val);
+        } else {
+            ERROR_PRINT("Unknown option %s", arg);
+            usage(argv[0]);
+            return 2;
+        }
+        i ++;
+    }
+
+    if (res.num_threads < 1) {
+        ERROR_PRINT("--threads must be >= 1");
+        return 2;
+    }
+    if (res.repeat < 1) {
+        ERROR_PRINT("--repeat must be >= 1");
+        return 2;
+    }
+    res.prompt_len = prompt_len ? prompt_len : res.preset->prompt_len;
+    res.gen_len = gen_len ? gen_len : res.preset->gen_len;
+
+    if (run_benchmark(&res, warmup) != 0) {
+        return 2;
+    }
+    print_result(&res);
+
+    if (json_path != NULL && write_json(&res, json_path) != 0) {
+        return 2;
+    }
+
+    if (baseline_path != NULL) {
+        int regressions = compare_baseline(&res, baseline_path, threshold_pct);
+        if (regressions < 0) return 2;
+        if (regressions > 0) {
+            ERROR_PRINT("%d metric(s) regressed beyond %.1f%%", regressions, threshold_pct);
+            return 1;
+        }
+        INFO_PRINT("No regressions beyond %.1f%%", threshold_pct);
+    }
+
+    return 0;
+}
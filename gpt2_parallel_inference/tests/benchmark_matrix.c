@@ -1,4 +1,7 @@
 #include "matrix_parallel.h"
+#include "matrix_autotune.h"
+#include "perf_counters.h"
+#include "gpt2.h"
 #include "tensor.h"
 #include "common.h"
 #include <sys/time.h>
@@ -234,6 +237,357 @@ void run_thread_scaling() {
     }
 }
 
+/**
+ * 自动调优：为 GPT-2 small 的 prefill / decode GEMM 形状搜索最优方案并写入缓存
+ */
+void run_autotune(const char *cache_path, size_t seq_len) {
+    INFO_PRINT("\n╔════════════════════════════════════════╗");
+    INFO_PRINT("║     Matmul Autotune                    ║");
+    INFO_PRINT("╚════════════════════════════════════════╝\n");
+
+    gpt2_config_t gpt2_cfg = {
+        .vocab_size = 50257,
+        .max_seq_len = 1024,
+        .d_model = 768,
+        .num_heads = 12,
+        .num_layers = 12,
+        .d_ff = 3072,
+        .dropout = 0.0f
+    };
+
+    // 不加载旧缓存，所有形状从默认方案开始比较
+    matrix_config_t config = {
+        .num_threads = (int)MAX(sysconf(_SC_NPROCESSORS_ONLN), 1),
+        .block_size = 32,
+        .use_blocking = true,
+        .use_simd = false,
+        .tune_cache = ""
+    };
+    matrix_init(&config);
+
+    char model[128];
+    matmul_autotune_cpu_model(model, sizeof(model));
+    INFO_PRINT("CPU: %s, threads: %d", model, config.num_threads);
+
+    size_t shapes[16][3];
+    size_t count = gpt2_gemm_shapes(&gpt2_cfg, seq_len, shapes, ARRAY_SIZE(shapes));
+    size_t decode_shapes[8][3];
+    size_t decode_count = gpt2_gemm_shapes(&gpt2_cfg, 1, decode_shapes, ARRAY_SIZE(decode_shapes));
+    for (size_t i = 0; i < decode_count && count < ARRAY_SIZE(shapes); i++) {
+        memcpy(shapes[count++], decode_shapes[i], sizeof(shapes[0]));
+    }
+
+    printf("M\tK\tN\tDefault(ms)\tTuned(ms)\tGain\tPlan\n");
+    printf("─\t─\t─\t───────────\t─────────\t────\t────\n");
+
+    for (size_t i = 0; i < count; i++) {
+        size_t M = shapes[i][0], K = shapes[i][1], N = shapes[i][2];
+
+        // 默认方案的耗时（取 3 次最短）
+        size_t shape_A[] = {M, K};
+        size_t shape_B[] = {K, N};
+        size_t shape_C[] = {M, N};
+        Tensor *A = tensor_create(2, shape_A);
+        Tensor *B = tensor_create(2, shape_B);
+        Tensor *C = tensor_create(2, shape_C);
+        tensor_fill_random(A, -1.0f, 1.0f);
+        tensor_fill_random(B, -1.0f, 1.0f);
+
+        matmul_plan_t plan;
+        matmul_default_plan(&plan);
+        double default_ms = INFINITY;
+        for (int run = 0; run < 3; run++) {
+            double start = get_time_ms();
+            matmul_parallel_plan(A, B, C, &plan);
+            default_ms = fmin(default_ms, get_time_ms() - start);
+        }
+        tensor_free(A);
+        tensor_free(B);
+        tensor_free(C);
+
+        matmul_tune_entry_t best;
+        if (matmul_autotune_shape(M, K, N, &best) != 0) {
+            ERROR_PRINT("Autotune failed for [%zu x %zu] @ [%zu x %zu]", M, K, K, N);
+            continue;
+        }
+
+        printf("%zu\t%zu\t%zu\t%.3f\t\t%.3f\t\t%.2fx\t%s t=%d b=%zu s=%d\n",
+               M, K, N, default_ms, best.time_ms, default_ms / best.time_ms,
+               best.plan.kernel == MATMUL_KERNEL_BLOCKED ? "blocked" : "row",
+               best.plan.num_threads, best.plan.block_size, (int)best.plan.schedule);
+    }
+
+    matmul_autotune_save(cache_path);
+    matrix_cleanup();
+}
+
+/* ============= 硬件计数器 + Roofline ============= */
+
+#define PEAK_LANES       64                 // 独立累加链数，覆盖浮点流水线延迟
+#define PEAK_ITERS       (4u * 1000u * 1000u)
+#define STREAM_ELEMS     ((size_t)8 << 20)  // 每个数组 32 MB，远大于常见 LLC
+#define STREAM_REPEATS   5
+#define CACHE_LINE_BYTES 64
+
+typedef struct {
+    size_t iters;
+    float sink;
+} peak_task_t;
+
+typedef struct {
+    float *a;
+    const float *b;
+    const float *c;
+    size_t start;
+    size_t end;
+} triad_task_t;
+
+/**
+ * 峰值算力微内核：PEAK_LANES 条互不依赖的乘加链，全部驻留寄存器
+ */
+static void peak_flops_task(void *arg) {
+    peak_task_t *task = (peak_task_t *)arg;
+    float acc[PEAK_LANES];
+    for (int l = 0; l < PEAK_LANES; l++) acc[l] = 1.0f + l * 1e-3f;
+
+    const float mul = 0.999999f;
+    const float add = 1e-6f;
+    for (size_t it = 0; it < task->iters; it++) {
+        for (int l = 0; l < PEAK_LANES; l++) {
+            acc[l] = acc[l] * mul + add;
+        }
+    }
+
+    float sum = 0.0f;
+    for (int l = 0; l < PEAK_LANES; l++) sum += acc[l];
+    task->sink = sum;
+}
+
+static void stream_triad_task(void *arg) {
+    triad_task_t *task = (triad_task_t *)arg;
+    const float scalar = 3.0f;
+    for (size_t i = task->start; i < task->end; i++) {
+        task->a[i] = task->b[i] + scalar * task->c[i];
+    }
+}
+
+/**
+ * 实测峰值 GFLOPS（线程池全部线程同时运行乘加微内核）
+ */
+static double measure_peak_gflops(int num_threads) {
+    thread_pool_t *pool = matrix_get_thread_pool();
+    peak_task_t *tasks = (peak_task_t *)calloc(num_threads, sizeof(peak_task_t));
+    ASSERT(tasks != NULL, "Failed to allocate peak tasks");
+
+    double best_ms = INFINITY;
+    for (int rep = 0; rep < 3; rep++) {
+        double start = get_time_ms();
+        for (int t = 0; t < num_threads; t++) {
+            tasks[t].iters = PEAK_ITERS;
+            thread_pool_submit(pool, peak_flops_task, &tasks[t], NULL);
+        }
+        thread_pool_wait_all(pool);
+        best_ms = fmin(best_ms, get_time_ms() - start);
+    }
+    free(tasks);
+
+    double flops = 2.0 * PEAK_LANES * PEAK_ITERS * num_threads;
+    return flops / (best_ms * 1e6);
+}
+
+/**
+ * 实测 STREAM triad 带宽（GB/s，按 STREAM 惯例每元素计 3 次 4 字节访问）
+ */
+static double measure_stream_bandwidth(int num_threads) {
+    thread_pool_t *pool = matrix_get_thread_pool();
+    float *a = (float *)malloc(STREAM_ELEMS * sizeof(float));
+    float *b = (float *)malloc(STREAM_ELEMS * sizeof(float));
+    float *c = (float *)malloc(STREAM_ELEMS * sizeof(float));
+    triad_task_t *tasks = (triad_task_t *)calloc(num_threads, sizeof(triad_task_t));
+    ASSERT(a && b && c && tasks, "Failed to allocate STREAM arrays");
+
+    for (size_t i = 0; i < STREAM_ELEMS; i++) {
+        a[i] = 0.0f;
+        b[i] = 1.0f;
+        c[i] = 2.0f;
+    }
+
+    size_t chunk = (STREAM_ELEMS + num_threads - 1) / num_threads;
+    double best_ms = INFINITY;
+    for (int rep = 0; rep < STREAM_REPEATS; rep++) {
+        double start = get_time_ms();
+        for (int t = 0; t < num_threads; t++) {
+            tasks[t] = (triad_task_t){
+                .a = a, .b = b, .c = c,
+                .start = MIN(t * chunk, STREAM_ELEMS),
+                .end = MIN((t + 1) * chunk, STREAM_ELEMS)
+            };
+            thread_pool_submit(pool, stream_triad_task, &tasks[t], NULL);
+        }
+        thread_pool_wait_all(pool);
+        best_ms = fmin(best_ms, get_time_ms() - start);
+    }
+
+    free(a);
+    free(b);
+    free(c);
+    free(tasks);
+
+    double bytes = 3.0 * sizeof(float) * STREAM_ELEMS;
+    return bytes / (best_ms * 1e6);
+}
+
+typedef struct {
+    const char *name;
+    void (*fn)(const Tensor *, const Tensor *, Tensor *);
+    bool parallel;
+} kernel_case_t;
+
+/**
+ * 每个计算核的计数器、派生指标与 roofline 定位
+ */
+void run_perf_counters(size_t N, int num_threads) {
+    INFO_PRINT("\n╔════════════════════════════════════════╗");
+    INFO_PRINT("║     Hardware Counters + Roofline       ║");
+    INFO_PRINT("╚════════════════════════════════════════╝\n");
+
+    matrix_config_t config = {
+        .num_threads = num_threads,
+        .block_size = 32,
+        .use_blocking = true,
+        .use_simd = false
+    };
+    matrix_init(&config);
+    thread_pool_t *pool = matrix_get_thread_pool();
+
+    // 计数器：主线程 + 每个工作线程
+    int num_ctx = num_threads + 1;
+    int *tids = (int *)calloc(num_ctx, sizeof(int));
+    perf_counters_t *ctrs = (perf_counters_t *)calloc(num_ctx, sizeof(perf_counters_t));
+    perf_sample_t *samples = (perf_sample_t *)calloc(num_ctx, sizeof(perf_sample_t));
+    ASSERT(tids && ctrs && samples, "Failed to allocate counter state");
+
+    tids[0] = 0;
+    int num_workers = thread_pool_get_worker_tids(pool, tids + 1, num_threads);
+    if (num_workers != num_threads) {
+        WARN_PRINT("Worker tids unavailable, counting the main thread only");
+        num_ctx = 1;
+    }
+
+    bool have_hw = false;
+    for (int t = 0; t < num_ctx; t++) {
+        perf_counters_open(&ctrs[t], tids[t]);
+        have_hw = have_hw || ctrs[t].fds[PERF_CTR_CYCLES] >= 0;
+    }
+    if (!have_hw) {
+        WARN_PRINT("Hardware counters unavailable (%s); reporting time-based metrics only",
+                   strerror(ctrs[0].first_errno));
+    }
+
+    // 机器上限
+    double peak_gflops = measure_peak_gflops(num_threads);
+    double peak_bw = measure_stream_bandwidth(num_threads);
+    double ridge = peak_gflops / peak_bw;
+    printf("Peak compute: %.2f GFLOPS, STREAM triad: %.2f GB/s, ridge point: %.2f FLOP/byte\n\n",
+           peak_gflops, peak_bw, ridge);
+
+    size_t shape[] = {N, N};
+    Tensor *A = tensor_create(2, shape);
+    Tensor *B = tensor_create(2, shape);
+    Tensor *C = tensor_create(2, shape);
+    tensor_fill_random(A, -1.0f, 1.0f);
+    tensor_fill_random(B, -1.0f, 1.0f);
+
+    const kernel_case_t cases[] = {
+        {"serial_ijk", matmul_serial, false},
+        {"serial_ikj", matmul_serial_ikj, false},
+        {"serial_blocked", matmul_serial_blocked, false},
+        {"parallel_row", matmul_parallel_row, true},
+        {"parallel_blocked", matmul_parallel_blocked, true},
+    };
+
+    double flops = 2.0 * N * N * N;
+    double compulsory_bytes = 3.0 * sizeof(float) * N * N;
+
+    printf("Kernel\t\t\tTime(ms)\tGFLOPS\tIPC\tL1D-miss\tLLC-miss\tdTLB-miss\tStall%%\tB/FLOP\tGB/s\tBound\t%%Roof\n");
+    printf("──────\t\t\t────────\t──────\t───\t────────\t────────\t─────────\t──────\t──────\t────\t─────\t─────\n");
+
+    for (size_t k = 0; k < ARRAY_SIZE(cases); k++) {
+        for (int t = 0; t < num_ctx; t++) perf_counters_start(&ctrs[t]);
+        double start = get_time_ms();
+        cases[k].fn(A, B, C);
+        double elapsed_ms = get_time_ms() - start;
+        for (int t = 0; t < num_ctx; t++) perf_counters_stop(&ctrs[t]);
+
+        perf_sample_t total;
+        memset(&total, 0, sizeof(total));
+        for (int t = 0; t < num_ctx; t++) {
+            perf_counters_read(&ctrs[t], &samples[t]);
+            perf_sample_add(&total, &samples[t]);
+        }
+
+        const uint64_t *v = total.values;
+        const bool *ok = total.valid;
+        double gflops = flops / (elapsed_ms * 1e6);
+
+        // LLC 缺失可用时按实际搬运量估算，否则退化为每个矩阵只读写一次的下界
+        double bytes = ok[PERF_CTR_LLC_MISSES] ? (double)v[PERF_CTR_LLC_MISSES] * CACHE_LINE_BYTES
+                                               : compulsory_bytes;
+        double intensity = flops / MAX(bytes, 1.0);
+        double bound = fmin(peak_gflops, intensity * peak_bw);
+
+        char ipc[16] = "-", stall[16] = "-";
+        if (ok[PERF_CTR_CYCLES] && ok[PERF_CTR_INSTRUCTIONS] && v[PERF_CTR_CYCLES] > 0) {
+            snprintf(ipc, sizeof(ipc), "%.2f", (double)v[PERF_CTR_INSTRUCTIONS] / v[PERF_CTR_CYCLES]);
+        }
+        if (ok[PERF_CTR_CYCLES] && ok[PERF_CTR_STALLED_CYCLES] && v[PERF_CTR_CYCLES] > 0) {
+            snprintf(stall, sizeof(stall), "%.1f", 100.0 * v[PERF_CTR_STALLED_CYCLES] / v[PERF_CTR_CYCLES]);
+        }
+
+        char misses[3][24];
+        const perf_counter_id_t miss_ids[3] = {PERF_CTR_L1D_MISSES, PERF_CTR_LLC_MISSES, PERF_CTR_DTLB_MISSES};
+        for (int m = 0; m < 3; m++) {
+            if (ok[miss_ids[m]]) {
+                snprintf(misses[m], sizeof(misses[m]), "%llu", (unsigned long long)v[miss_ids[m]]);
+            } else {
+                snprintf(misses[m], sizeof(misses[m]), "-");
+            }
+        }
+
+        printf("%-16s\t%8.2f\t%6.2f\t%s\t%-8s\t%-8s\t%-9s\t%s\t%.4f%s\t%.2f\t%s\t%.1f\n",
+               cases[k].name, elapsed_ms, gflops, ipc, misses[0], misses[1], misses[2], stall,
+               bytes / flops, ok[PERF_CTR_LLC_MISSES] ? "" : "*", bytes / (elapsed_ms * 1e6),
+               intensity >= ridge ? "compute" : "memory", 100.0 * gflops / bound);
+
+        // 并行核的逐线程明细
+        if (cases[k].parallel) {
+            for (int t = 0; t < num_ctx; t++) {
+                const perf_sample_t *s = &samples[t];
+                printf("  %-8s tid=%-7d cpu=%7.2fms", t == 0 ? "main" : "worker", tids[t] ? tids[t] : (int)getpid(),
+                       s->valid[PERF_CTR_TASK_CLOCK] ? s->values[PERF_CTR_TASK_CLOCK] / 1e6 : 0.0);
+                if (s->valid[PERF_CTR_CYCLES] && s->valid[PERF_CTR_INSTRUCTIONS] && s->values[PERF_CTR_CYCLES] > 0) {
+                    printf(" cycles=%llu IPC=%.2f", (unsigned long long)s->values[PERF_CTR_CYCLES],
+                           (double)s->values[PERF_CTR_INSTRUCTIONS] / s->values[PERF_CTR_CYCLES]);
+                }
+                if (s->valid[PERF_CTR_L1D_MISSES]) {
+                    printf(" l1d_miss=%llu", (unsigned long long)s->values[PERF_CTR_L1D_MISSES]);
+                }
+                printf("\n");
+            }
+        }
+    }
+    printf("\n* LLC misses unavailable: bytes are the compulsory lower bound (A, B, C touched once)\n");
+
+    for (int t = 0; t < num_ctx; t++) perf_counters_close(&ctrs[t]);
+    free(tids);
+    free(ctrs);
+    free(samples);
+    tensor_free(A);
+    tensor_free(B);
+    tensor_free(C);
+    matrix_cleanup();
+}
+
 int main(int argc, char **argv) {
     INFO_PRINT("╔════════════════════════════════════════╗");
     INFO_PRINT("║   Matrix Multiplication Benchmark      ║");
@@ -243,6 +597,16 @@ int main(int argc, char **argv) {
         run_size_sweep();
     } else if (argc > 1 && strcmp(argv[1], "--scaling") == 0) {
         run_thread_scaling();
+    } else if (argc > 1 && strcmp(argv[1], "--perf") == 0) {
+        // --perf [N] [threads]
+        size_t N = argc > 2 ? (size_t)atoi(argv[2]) : 512;
+        int num_threads = argc > 3 ? atoi(argv[3]) : 4;
+        run_perf_counters(N, num_threads);
+    } else if (argc > 1 && strcmp(argv[1], "--autotune") == 0) {
+        // --autotune [cache_path] [seq_len]
+        const char *cache_path = argc > 2 ? argv[2] : "matmul_tune.tsv";
+        size_t seq_len = argc > 3 ? (size_t)atoi(argv[3]) : 128;
+        run_autotune(cache_path, seq_len);
     } else {
         // 默认：单个测试
         size_t N = 1024;
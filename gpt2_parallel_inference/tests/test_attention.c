@@ -121,8 +121,12 @@ void test_multi_head_attention_small() {
     // 并行计算
     INFO_PRINT("Computing parallel multi-head attention...");
     start = get_time_ms();
-    attention_multi_head_parallel(X, &weights, num_heads, NULL, output_parallel);
+    int ret = attention_multi_head_parallel(X, &weights, num_heads, NULL, output_parallel);
     double parallel_time = get_time_ms() - start;
+    if (ret != 0) {
+        ERROR_PRINT("Parallel attention failed");
+        exit(EXIT_FAILURE);
+    }
     INFO_PRINT("Parallel time: %.2f ms", parallel_time);
     INFO_PRINT("Speedup: %.2fx", serial_time / parallel_time);
     
@@ -218,8 +222,12 @@ void test_multi_head_attention_large() {
     // ===== 并行计算 =====
     INFO_PRINT("Computing parallel multi-head attention...");
     start = get_time_ms();
-    attention_multi_head_parallel(X, &weights, num_heads, NULL, output_parallel);
+    int ret = attention_multi_head_parallel(X, &weights, num_heads, NULL, output_parallel);
     double parallel_time = get_time_ms() - start;
+    if (ret != 0) {
+        ERROR_PRINT("Parallel attention failed");
+        exit(EXIT_FAILURE);
+    }
     INFO_PRINT("Parallel time: %.2f ms", parallel_time);
     
     // ===== 性能报告 =====
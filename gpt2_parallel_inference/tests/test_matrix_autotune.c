@@ -0,0 +1,157 @@
+#include "matrix_parallel.h"
+#include "matrix_autotune.h"
+#include "gpt2.h"
+#include <math.h>
+
+#define TUNE_TEST_PATH "/tmp/gpt2_tune_test.tsv"
+
+static void init_matrix(const char *tune_cache) {
+    matrix_config_t config = {
+        .num_threads = 4,
+        .block_size = 32,
+        .use_blocking = true,
+        .use_simd = false,
+        .tune_cache = tune_cache
+    };
+    int ret = matrix_init(&config);
+    ASSERT(ret == 0, "matrix_init failed");
+}
+
+void test_cpu_model() {
+    INFO_PRINT("=== Test: CPU Model Key ===");
+
+    char model[128];
+    matmul_autotune_cpu_model(model, sizeof(model));
+    ASSERT(model[0] != '\0', "CPU model must not be empty");
+    ASSERT(strchr(model, '\t') == NULL, "CPU model must not contain tabs");
+    INFO_PRINT("CPU model: %s", model);
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+void test_gemm_shapes() {
+    INFO_PRINT("=== Test: GPT-2 GEMM Shapes ===");
+
+    gpt2_config_t cfg = {
+        .vocab_size = 1000,
+        .max_seq_len = 64,
+        .d_model = 64,
+        .num_heads = 4,
+        .num_layers = 2,
+        .d_ff = 256,
+        .dropout = 0.0f
+    };
+
+    size_t shapes[8][3];
+    size_t count = gpt2_gemm_shapes(&cfg, 16, shapes, ARRAY_SIZE(shapes));
+    ASSERT(count == 4, "Expected projection, two FFN and LM head shapes");
+    for (size_t i = 0; i < count; i++) {
+        ASSERT(shapes[i][0] == 16, "M must be the sequence length");
+    }
+    ASSERT(shapes[1][1] == 64 && shapes[1][2] == 256, "FFN up-projection shape mismatch");
+    ASSERT(shapes[3][2] == 1000, "LM head must project to vocab");
+
+    // d_ff == d_model 时去重
+    cfg.d_ff = 64;
+    count = gpt2_gemm_shapes(&cfg, 1, shapes, ARRAY_SIZE(shapes));
+    ASSERT(count == 2, "Duplicate shapes must be merged");
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+void test_tune_and_lookup() {
+    INFO_PRINT("=== Test: Tune, Save and Reload ===");
+
+    remove(TUNE_TEST_PATH);
+    init_matrix("");
+
+    ASSERT(matmul_autotune_lookup(24, 32, 48) == NULL, "Table must start empty");
+
+    matmul_tune_entry_t best;
+    int ret = matmul_autotune_shape(24, 32, 48, &best);
+    ASSERT(ret == 0, "Autotune failed");
+    ASSERT(best.time_ms > 0.0, "Best time must be positive");
+    ASSERT(best.plan.num_threads >= 1 && best.plan.num_threads <= 4, "Thread count out of range");
+
+    const matmul_plan_t *plan = matmul_autotune_lookup(24, 32, 48);
+    ASSERT(plan != NULL, "Tuned shape must be in the table");
+    ASSERT(plan->kernel == best.plan.kernel && plan->block_size == best.plan.block_size,
+           "Lookup must return the tuned plan");
+
+    // 调优后的 matmul_parallel 结果正确
+    size_t a_shape[] = {24, 32};
+    size_t b_shape[] = {32, 48};
+    size_t c_shape[] = {24, 48};
+    Tensor *A = tensor_create(2, a_shape);
+    Tensor *B = tensor_create(2, b_shape);
+    Tensor *C = tensor_create(2, c_shape);
+    Tensor *ref = tensor_create(2, c_shape);
+    tensor_fill_random(A, -1.0f, 1.0f);
+    tensor_fill_random(B, -1.0f, 1.0f);
+    matmul_serial(A, B, ref);
+    matmul_parallel(A, B, C);
+    for (size_t i = 0; i < C->size; i++) {
+        ASSERT(fabsf(C->data[i] - ref->data[i]) < 1e-4f, "Tuned matmul result mismatch");
+    }
+    tensor_free(A);
+    tensor_free(B);
+    tensor_free(C);
+    tensor_free(ref);
+
+    // 另一台机器的表项：保存时保留、加载时忽略
+    FILE *fp = fopen(TUNE_TEST_PATH, "w");
+    ASSERT(fp != NULL, "Failed to create cache file");
+    fprintf(fp, "Other CPU Model\t24\t32\t48\trow\t1\t16\tstatic\t0\t9.0\n");
+    fclose(fp);
+
+    ret = matmul_autotune_save(TUNE_TEST_PATH);
+    ASSERT(ret == 0, "Save failed");
+    matrix_cleanup();
+    ASSERT(matmul_autotune_count() == 0, "Cleanup must clear the table");
+
+    init_matrix(TUNE_TEST_PATH);
+    ASSERT(matmul_autotune_count() == 1, "Only this CPU's entry must be loaded");
+    plan = matmul_autotune_lookup(24, 32, 48);
+    ASSERT(plan != NULL, "Reloaded shape must be in the table");
+    ASSERT(plan->kernel == best.plan.kernel, "Reloaded kernel mismatch");
+    ASSERT(plan->num_threads == best.plan.num_threads, "Reloaded thread count mismatch");
+    ASSERT(plan->block_size == best.plan.block_size, "Reloaded block size mismatch");
+    ASSERT(plan->schedule == best.plan.schedule, "Reloaded schedule mismatch");
+    matrix_cleanup();
+
+    // 其它型号的表项仍在文件中
+    fp = fopen(TUNE_TEST_PATH, "r");
+    ASSERT(fp != NULL, "Cache file missing");
+    char line[512];
+    bool found_other = false;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (strncmp(line, "Other CPU Model\t", 16) == 0) found_other = true;
+    }
+    fclose(fp);
+    ASSERT(found_other, "Save must keep entries of other CPU models");
+
+    remove(TUNE_TEST_PATH);
+
+    // 缓存不存在不是错误
+    init_matrix("/tmp/gpt2_tune_missing.tsv");
+    ASSERT(matmul_autotune_count() == 0, "Missing cache must load nothing");
+    matrix_cleanup();
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+int main() {
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   Matmul Autotune Tests                ║");
+    INFO_PRINT("╚════════════════════════════════════════╝\n");
+
+    test_cpu_model();
+    test_gemm_shapes();
+    test_tune_and_lookup();
+
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   All Tests PASSED!                    ║");
+    INFO_PRINT("╚════════════════════════════════════════╝");
+
+    return 0;
+}
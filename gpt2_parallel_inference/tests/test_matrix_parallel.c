@@ -0,0 +1,167 @@
+#include "matrix_parallel.h"
+#include <math.h>
+
+#define TEST_THREADS 4
+
+static void init_with_schedule(matmul_schedule_t schedule, size_t grain) {
+    matrix_config_t config = {
+        .num_threads = TEST_THREADS,
+        .block_size = 16,
+        .use_blocking = true,
+        .use_simd = false,
+        .schedule = schedule,
+        .grain = grain
+    };
+    int ret = matrix_init(&config);
+    ASSERT(ret == 0, "matrix_init failed");
+}
+
+static float max_abs_diff(const Tensor *x, const Tensor *y) {
+    float diff = 0.0f;
+    for (size_t i = 0; i < x->size; i++) {
+        diff = fmaxf(diff, fabsf(x->data[i] - y->data[i]));
+    }
+    return diff;
+}
+
+/**
+ * 用给定调度计算 [M x K] @ [K x N]，与串行结果比较，返回提交的任务数
+ */
+static size_t check_shape(size_t M, size_t K, size_t N, bool blocked) {
+    size_t a_shape[] = {M, K};
+    size_t b_shape[] = {K, N};
+    size_t c_shape[] = {M, N};
+
+    Tensor *A = tensor_create(2, a_shape);
+    Tensor *B = tensor_create(2, b_shape);
+    Tensor *C = tensor_create(2, c_shape);
+    Tensor *ref = tensor_create(2, c_shape);
+    tensor_fill_random(A, -1.0f, 1.0f);
+    tensor_fill_random(B, -1.0f, 1.0f);
+
+    // 预填垃圾值，确认并行版本会清零输出
+    for (size_t i = 0; i < C->size; i++) C->data[i] = 42.0f;
+
+    matmul_serial(A, B, ref);
+
+    thread_pool_t *pool = matrix_get_thread_pool();
+    thread_pool_reset_stats(pool);
+
+    if (blocked) {
+        matmul_parallel_blocked(A, B, C);
+    } else {
+        matmul_parallel_row(A, B, C);
+    }
+
+    thread_pool_stats_t stats;
+    int ret = thread_pool_get_stats(pool, &stats);
+    ASSERT(ret == 0, "Failed to get pool stats");
+    size_t submitted = stats.submitted;
+    thread_pool_stats_free(&stats);
+
+    float diff = max_abs_diff(C, ref);
+    if (diff > 1e-4f) {
+        ERROR_PRINT("[%zu x %zu] @ [%zu x %zu] (%s): max diff %f",
+                    M, K, K, N, blocked ? "blocked" : "row", diff);
+    }
+    ASSERT(diff <= 1e-4f, "Parallel result differs from serial");
+
+    tensor_free(A);
+    tensor_free(B);
+    tensor_free(C);
+    tensor_free(ref);
+
+    return submitted;
+}
+
+void test_schedules_correctness() {
+    INFO_PRINT("=== Test: Schedules Match Serial Result ===");
+
+    const matmul_schedule_t schedules[] = {
+        MATMUL_SCHED_STATIC, MATMUL_SCHED_DYNAMIC, MATMUL_SCHED_GUIDED
+    };
+    const size_t grains[] = {0, 1, 5};
+    const size_t shapes[][3] = {
+        {64, 48, 80},   // 常规
+        {37, 19, 23},   // 非整除
+        {3, 17, 100},   // M < 线程数，2D 分块
+        {1, 32, 70},    // 单行（逐 token 推理）
+        {2, 9, 5}       // N 太窄无法分列条
+    };
+
+    for (size_t s = 0; s < ARRAY_SIZE(schedules); s++) {
+        for (size_t g = 0; g < ARRAY_SIZE(grains); g++) {
+            init_with_schedule(schedules[s], grains[g]);
+            for (size_t i = 0; i < ARRAY_SIZE(shapes); i++) {
+                check_shape(shapes[i][0], shapes[i][1], shapes[i][2], false);
+                check_shape(shapes[i][0], shapes[i][1], shapes[i][2], true);
+            }
+            matrix_cleanup();
+        }
+    }
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+void test_2d_tiling() {
+    INFO_PRINT("=== Test: 2D Tiling When M < Threads ===");
+
+    init_with_schedule(MATMUL_SCHED_STATIC, 0);
+
+    // 单行、足够宽：应切成 TEST_THREADS 个列条，每个线程一个
+    size_t tasks = check_shape(1, 64, 256, false);
+    ASSERT(tasks == TEST_THREADS, "Single-row matmul must be split across all threads");
+
+    // 两行：每行两个列条
+    tasks = check_shape(2, 64, 256, false);
+    ASSERT(tasks == TEST_THREADS, "Two-row matmul must be split into row x column tiles");
+
+    // 过窄的矩阵不切列条（列条至少 MIN_COLS_PER_TILE 列）
+    tasks = check_shape(1, 64, 8, false);
+    ASSERT(tasks == 1, "Narrow matmul must not be split into columns");
+
+    // 行数足够时与旧的静态行分块一致
+    tasks = check_shape(64, 32, 32, false);
+    ASSERT(tasks == TEST_THREADS, "Static schedule must give one slice per thread");
+
+    matrix_cleanup();
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+void test_dynamic_workers() {
+    INFO_PRINT("=== Test: Dynamic Schedule Worker Count ===");
+
+    // 动态调度为每个线程提交一个领取循环，而非每块一个任务
+    init_with_schedule(MATMUL_SCHED_DYNAMIC, 1);
+    size_t tasks = check_shape(128, 16, 32, false);
+    ASSERT(tasks == TEST_THREADS, "Dynamic schedule must submit one claiming task per thread");
+
+    // 块数少于线程数时不提交空转任务
+    tasks = check_shape(2, 16, 8, false);
+    ASSERT(tasks == 2, "Dynamic schedule must not submit more workers than chunks");
+    matrix_cleanup();
+
+    init_with_schedule(MATMUL_SCHED_GUIDED, 8);
+    tasks = check_shape(100, 16, 32, true);
+    ASSERT(tasks == TEST_THREADS, "Guided schedule must submit one claiming task per thread");
+    matrix_cleanup();
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+int main() {
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   Parallel Matmul Scheduling Tests     ║");
+    INFO_PRINT("╚════════════════════════════════════════╝\n");
+
+    test_schedules_correctness();
+    test_2d_tiling();
+    test_dynamic_workers();
+
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   All Tests PASSED!                    ║");
+    INFO_PRINT("╚════════════════════════════════════════╝");
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "perf_counters.h"
+#include "thread_pool.h"
+
+static volatile float g_sink;
+
+static void busy_task(void *arg) {
+    size_t iters = *(size_t *)arg;
+    float acc = 1.0f;
+    for (size_t i = 0; i < iters; i++) {
+        acc = acc * 0.999999f + 1e-6f;
+    }
+    g_sink = acc;
+}
+
+void test_counters_self() {
+    INFO_PRINT("=== Test: Counters On Calling Thread ===");
+
+    perf_counters_t pc;
+    int opened = perf_counters_open(&pc, 0);
+    ASSERT(opened >= 0, "perf_counters_open must not fail on valid arguments");
+    INFO_PRINT("Opened %d/%d counters (first error: %s)", opened, PERF_CTR_COUNT,
+               pc.first_errno ? strerror(pc.first_errno) : "none");
+
+    size_t iters = 2 * 1000 * 1000;
+    perf_counters_start(&pc);
+    busy_task(&iters);
+    perf_counters_stop(&pc);
+
+    perf_sample_t sample;
+    perf_counters_read(&pc, &sample);
+    for (int i = 0; i < PERF_CTR_COUNT; i++) {
+        ASSERT(sample.valid[i] == (pc.fds[i] >= 0), "Validity must follow open state");
+        if (sample.valid[i]) {
+            INFO_PRINT("  %-16s %llu", perf_counter_name((perf_counter_id_t)i),
+                       (unsigned long long)sample.values[i]);
+        }
+    }
+    if (sample.valid[PERF_CTR_TASK_CLOCK]) {
+        ASSERT(sample.values[PERF_CTR_TASK_CLOCK] > 0, "Busy loop must consume CPU time");
+    }
+    if (sample.valid[PERF_CTR_INSTRUCTIONS]) {
+        ASSERT(sample.values[PERF_CTR_INSTRUCTIONS] >= iters, "Too few instructions counted");
+    }
+
+    // 停止后计数不再增长
+    perf_sample_t again;
+    busy_task(&iters);
+    perf_counters_read(&pc, &again);
+    for (int i = 0; i < PERF_CTR_COUNT; i++) {
+        ASSERT(again.values[i] == sample.values[i], "Stopped counters must not advance");
+    }
+
+    perf_counters_close(&pc);
+    ASSERT(pc.num_open == 0, "Close must release all counters");
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+void test_sample_add() {
+    INFO_PRINT("=== Test: Sample Accumulation ===");
+
+    perf_sample_t total, a, b;
+    memset(&total, 0, sizeof(total));
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+
+    a.values[PERF_CTR_CYCLES] = 100;
+    a.valid[PERF_CTR_CYCLES] = true;
+    b.values[PERF_CTR_CYCLES] = 50;
+    b.valid[PERF_CTR_CYCLES] = true;
+    b.values[PERF_CTR_LLC_MISSES] = 7;
+    b.valid[PERF_CTR_LLC_MISSES] = true;
+    b.values[PERF_CTR_DTLB_MISSES] = 99;    // 无效读数不参与累加
+
+    perf_sample_add(&total, &a);
+    perf_sample_add(&total, &b);
+
+    ASSERT(total.values[PERF_CTR_CYCLES] == 150 && total.valid[PERF_CTR_CYCLES], "Cycles sum mismatch");
+    ASSERT(total.values[PERF_CTR_LLC_MISSES] == 7 && total.valid[PERF_CTR_LLC_MISSES], "LLC sum mismatch");
+    ASSERT(total.values[PERF_CTR_DTLB_MISSES] == 0 && !total.valid[PERF_CTR_DTLB_MISSES],
+           "Invalid readings must be ignored");
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+void test_counters_workers() {
+    INFO_PRINT("=== Test: Per-Worker Counters ===");
+
+    thread_pool_cfg_t config = {
+        .num_threads = 2,
+        .queue_size = 16,
+        .stack_size = 0,
+        .daemon_threads = false
+    };
+    thread_pool_t *pool = thread_pool_create(&config);
+    ASSERT(pool != NULL, "Failed to create thread pool");
+
+    int tids[2];
+    int count = thread_pool_get_worker_tids(pool, tids, 2);
+    ASSERT(count == 2, "Expected two worker tids");
+    ASSERT(tids[0] > 0 && tids[1] > 0 && tids[0] != tids[1], "Worker tids must be distinct");
+
+    perf_counters_t pcs[2];
+    for (int i = 0; i < 2; i++) {
+        perf_counters_open(&pcs[i], tids[i]);
+        perf_counters_start(&pcs[i]);
+    }
+
+    size_t iters = 2 * 1000 * 1000;
+    for (int i = 0; i < 4; i++) {
+        int ret = thread_pool_submit(pool, busy_task, &iters, NULL);
+        ASSERT(ret == 0, "Submit failed");
+    }
+    thread_pool_wait_all(pool);
+
+    uint64_t worker_cpu_ns = 0;
+    bool have_clock = false;
+    for (int i = 0; i < 2; i++) {
+        perf_counters_stop(&pcs[i]);
+        perf_sample_t sample;
+        perf_counters_read(&pcs[i], &sample);
+        if (sample.valid[PERF_CTR_TASK_CLOCK]) {
+            have_clock = true;
+            worker_cpu_ns += sample.values[PERF_CTR_TASK_CLOCK];
+        }
+        perf_counters_close(&pcs[i]);
+    }
+    if (have_clock) {
+        ASSERT(worker_cpu_ns > 0, "Workers must accumulate CPU time");
+    }
+
+    thread_pool_destroy(pool);
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+int main() {
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   Perf Counter Tests                   ║");
+    INFO_PRINT("╚════════════════════════════════════════╝\n");
+
+    test_counters_self();
+    test_sample_add();
+    test_counters_workers();
+
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   All Tests PASSED!                    ║");
+    INFO_PRINT("╚════════════════════════════════════════╝");
+
+    return 0;
+}
@@ -16,7 +16,7 @@ void test_create_and_destroy() {
     ASSERT(t->ndim == 3, "Tensor ndim incorrect");
     ASSERT(t->size == 24, "Tensor size incorrect");
     ASSERT(t->data != NULL, "Tensor data allocation failed");
-    ASSERT(t->shape != NULL, "Tensor shape allocation failed");
+    ASSERT(((uintptr_t)t->data % TENSOR_ALIGNMENT) == 0, "Tensor data must be aligned");
 
     // 验证 shape 拷贝
     for (size_t i = 0; i < 3; i++) {
@@ -140,7 +140,79 @@ void test_edge_cases() {
 
 
 /**
- * 测试 5：性能测试
+ * 测试 5：单次分配与 arena
+ */
+void test_allocation() {
+    INFO_PRINT("=== Test: Single Allocation and Arena ===");
+
+    // 每个张量（含视图）只计一次分配
+    size_t shape[] = {3, 5};
+    uint64_t before = tensor_alloc_count();
+    Tensor *t = tensor_create(2, shape);
+    size_t new_shape[] = {5, 3};
+    Tensor *r = tensor_reshape(t, 2, new_shape);
+    ASSERT(t != NULL && r != NULL, "Failed to create tensors");
+    ASSERT(tensor_alloc_count() - before == 2, "Tensor and view must be one allocation each");
+    ASSERT(r->data == t->data && !r->owns_data, "Reshape must share data");
+    ASSERT(r->stride[0] == 3 && r->stride[1] == 1, "Reshape strides incorrect");
+    tensor_free(r);
+    tensor_free(t);
+
+    // 超过内联维度上限
+    size_t big_shape[TENSOR_MAX_DIMS + 1];
+    for (size_t i = 0; i < ARRAY_SIZE(big_shape); i ++) big_shape[i] = 1;
+    ASSERT(tensor_create(TENSOR_MAX_DIMS + 1, big_shape) == NULL, "Too many dims must fail");
+
+    // arena 分配：对齐、清零、reset 后复用
+    tensor_arena_t *arena = tensor_arena_create(4096);
+    ASSERT(arena != NULL, "Failed to create arena");
+    const tensor_allocator_t *alloc = tensor_arena_allocator(arena);
+
+    size_t small_shape[] = {7};
+    Tensor *a = tensor_create_with_allocator(1, small_shape, alloc);
+    Tensor *b = tensor_create_with_allocator(1, small_shape, alloc);
+    ASSERT(a != NULL && b != NULL, "Arena allocation failed");
+    ASSERT(((uintptr_t)a->data % TENSOR_ALIGNMENT) == 0, "Arena data must be aligned");
+    ASSERT(((uintptr_t)b->data % TENSOR_ALIGNMENT) == 0, "Arena data must be aligned");
+    ASSERT(b->data[0] == 0.0f && b->data[6] == 0.0f, "Arena tensor must be zeroed");
+    ASSERT(tensor_arena_used(arena) > 0, "Arena usage must grow");
+
+    size_t start[] = {2};
+    size_t end[] = {5};
+    Tensor *view = tensor_slice(a, start, end, false);
+    ASSERT(view != NULL && view->allocator == alloc, "View must come from the same arena");
+    tensor_free(view);
+    tensor_free(a);
+    tensor_free(b);
+
+    size_t huge_shape[] = {4096};
+    Tensor *huge = tensor_create_with_allocator(1, huge_shape, alloc);
+    ASSERT(huge == NULL, "Arena overflow must fail");
+
+    // 放不下剩余空间（但不超过容量）的请求失败后不能占用空间
+    size_t used_before = tensor_arena_used(arena);
+    size_t rest_shape[] = {(4096 - used_before) / sizeof(float)};
+    Tensor *rest = tensor_create_with_allocator(1, rest_shape, alloc);
+    ASSERT(rest == NULL, "Request larger than the remaining space must fail");
+    ASSERT(tensor_arena_used(arena) == used_before, "Failed request must not consume arena space");
+    Tensor *fits = tensor_create_with_allocator(1, small_shape, alloc);
+    ASSERT(fits != NULL, "Small request must still fit after a failed one");
+    tensor_free(fits);
+
+    tensor_arena_reset(arena);
+    ASSERT(tensor_arena_used(arena) == 0, "Reset must release everything");
+    Tensor *c = tensor_create_with_allocator(1, small_shape, alloc);
+    ASSERT(c != NULL, "Arena must be reusable after reset");
+    tensor_free(c);
+
+    tensor_arena_destroy(arena);
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+
+/**
+ * 测试 6：性能测试
  */
 void test_performance() {
     INFO_PRINT("=== Test: Performance ===");
@@ -189,6 +261,7 @@ int main() {
     test_indexing();
     test_memory_layout();
     test_edge_cases();
+    test_allocation();
     test_performance();
     
     INFO_PRINT("╔════════════════════════════════════════╗");
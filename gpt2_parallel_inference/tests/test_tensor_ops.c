@@ -0,0 +1,197 @@
+#include "tensor.h"
+#include "common.h"
+#include <math.h>
+
+static Tensor* make_iota(size_t ndim, const size_t *shape) {
+    Tensor *t = tensor_create(ndim, shape);
+    ASSERT(t != NULL, "Tensor creation failed");
+    for (size_t i = 0; i < t->size; i ++) {
+        t->data[i] = (float)i;
+    }
+    return t;
+}
+
+static size_t count_segments(size_t nops, const Tensor *const *ops, size_t *total) {
+    tensor_iter_t it;
+    int ret = tensor_iter_init(&it, nops, ops);
+    ASSERT(ret == 0, "tensor_iter_init failed");
+
+    size_t segments = 0;
+    *total = 0;
+    while (tensor_iter_next(&it)) {
+        segments ++;
+        *total += it.inner_size;
+    }
+    return segments;
+}
+
+void test_iter_collapse() {
+    INFO_PRINT("=== Test: Iterator Dimension Collapse ===");
+
+    // 连续张量折叠为一段
+    size_t shape[] = {4, 5, 6};
+    Tensor *t = make_iota(3, shape);
+    const Tensor *ops1[] = {t};
+    size_t total = 0;
+    ASSERT(count_segments(1, ops1, &total) == 1, "Contiguous tensor must collapse to one segment");
+    ASSERT(total == t->size, "Segment must cover all elements");
+
+    // 最后一维切片：每行一段，前两维仍可折叠
+    size_t start[] = {0, 0, 1};
+    size_t end[] = {4, 5, 4};
+    Tensor *view = tensor_slice(t, start, end, false);
+    ASSERT(view != NULL, "Slice failed");
+    const Tensor *ops2[] = {view};
+    ASSERT(count_segments(1, ops2, &total) == 20, "Row-sliced view must give one segment per row");
+    ASSERT(total == 60, "Slice element count mismatch");
+
+    // 单元素
+    size_t one_shape[] = {1, 1};
+    Tensor *one = tensor_create(2, one_shape);
+    const Tensor *ops3[] = {one};
+    ASSERT(count_segments(1, ops3, &total) == 1 && total == 1, "Scalar must be a single element");
+
+    // 不可广播
+    size_t bad_shape[] = {3};
+    Tensor *bad = tensor_create(1, bad_shape);
+    const Tensor *ops4[] = {t, bad};
+    tensor_iter_t it;
+    int ret = tensor_iter_init(&it, 2, ops4);
+    ASSERT(ret == -1, "Mismatched shapes must be rejected");
+
+    tensor_free(view);
+    tensor_free(t);
+    tensor_free(one);
+    tensor_free(bad);
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+void test_copy_views() {
+    INFO_PRINT("=== Test: Copy, Clone and Transpose of Views ===");
+
+    size_t shape[] = {3, 4, 5};
+    Tensor *t = make_iota(3, shape);
+
+    // 切片副本与逐元素读取一致
+    size_t start[] = {1, 1, 2};
+    size_t end[] = {3, 4, 5};
+    Tensor *view = tensor_slice(t, start, end, false);
+    Tensor *copy = tensor_slice(t, start, end, true);
+    Tensor *clone = tensor_clone(view);
+    ASSERT(view != NULL && copy != NULL && clone != NULL, "Slice/clone failed");
+    ASSERT(clone->offset == 0 && clone->owns_data, "Clone must be contiguous and owning");
+
+    size_t idx[3];
+    for (idx[0] = 0; idx[0] < 2; idx[0] ++) {
+        for (idx[1] = 0; idx[1] < 3; idx[1] ++) {
+            for (idx[2] = 0; idx[2] < 3; idx[2] ++) {
+                float expected = tensor_get(view, idx);
+                ASSERT(tensor_get(copy, idx) == expected, "Slice copy mismatch");
+                ASSERT(tensor_get(clone, idx) == expected, "Clone of view mismatch");
+            }
+        }
+    }
+
+    // 转置（改变布局的复制）
+    size_t m_shape[] = {3, 7};
+    Tensor *m = make_iota(2, m_shape);
+    Tensor *mt = tensor_transpose(m);
+    ASSERT(mt != NULL && mt->shape[0] == 7 && mt->shape[1] == 3, "Transpose shape mismatch");
+    for (size_t i = 0; i < 3; i ++) {
+        for (size_t j = 0; j < 7; j ++) {
+            ASSERT(mt->data[j * 3 + i] == m->data[i * 7 + j], "Transpose value mismatch");
+        }
+    }
+
+    // 广播复制：[7] -> [3, 7]
+    size_t row_shape[] = {7};
+    Tensor *row = make_iota(1, row_shape);
+    int ret = tensor_copy(m, row);
+    ASSERT(ret == 0, "Broadcast copy failed");
+    for (size_t i = 0; i < m->size; i ++) {
+        ASSERT(m->data[i] == (float)(i % 7), "Broadcast copy value mismatch");
+    }
+
+    tensor_free(view);
+    tensor_free(copy);
+    tensor_free(clone);
+    tensor_free(t);
+    tensor_free(m);
+    tensor_free(mt);
+    tensor_free(row);
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+void test_binary_ops() {
+    INFO_PRINT("=== Test: Broadcast Add / Mul / Scale ===");
+
+    size_t shape[] = {4, 6};
+    size_t bias_shape[] = {6};
+    size_t col_shape[] = {4, 1};
+    Tensor *x = make_iota(2, shape);
+    Tensor *bias = make_iota(1, bias_shape);
+    Tensor *col = make_iota(2, col_shape);
+    Tensor *out = tensor_create(2, shape);
+
+    // 偏置广播（原地）
+    int ret = tensor_add(x, x, bias);
+    ASSERT(ret == 0, "Bias add failed");
+    for (size_t i = 0; i < 4; i ++) {
+        for (size_t j = 0; j < 6; j ++) {
+            ASSERT(x->data[i * 6 + j] == (float)(i * 6 + j + j), "Bias add value mismatch");
+        }
+    }
+
+    // 列广播乘法
+    ret = tensor_mul(out, x, col);
+    ASSERT(ret == 0, "Column mul failed");
+    for (size_t i = 0; i < 4; i ++) {
+        for (size_t j = 0; j < 6; j ++) {
+            ASSERT(out->data[i * 6 + j] == x->data[i * 6 + j] * (float)i, "Column mul value mismatch");
+        }
+    }
+
+    // 视图上的运算只影响视图覆盖的元素
+    size_t start[] = {1, 2};
+    size_t end[] = {3, 5};
+    Tensor *view = tensor_slice(out, start, end, false);
+    ret = tensor_scale(view, view, 0.0f);
+    ASSERT(ret == 0, "Scale on view failed");
+    for (size_t i = 0; i < 4; i ++) {
+        for (size_t j = 0; j < 6; j ++) {
+            bool inside = (i >= 1 && i < 3 && j >= 2 && j < 5);
+            float expected = inside ? 0.0f : x->data[i * 6 + j] * (float)i;
+            ASSERT(out->data[i * 6 + j] == expected, "Scale on view touched wrong elements");
+        }
+    }
+
+    // 形状不匹配
+    ret = tensor_add(bias, x, x);
+    ASSERT(ret == -1, "Output smaller than inputs must be rejected");
+
+    tensor_free(view);
+    tensor_free(x);
+    tensor_free(bias);
+    tensor_free(col);
+    tensor_free(out);
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+int main() {
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   Tensor Iterator & Elementwise Tests  ║");
+    INFO_PRINT("╚════════════════════════════════════════╝\n");
+
+    test_iter_collapse();
+    test_copy_views();
+    test_binary_ops();
+
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   All Tests PASSED!                    ║");
+    INFO_PRINT("╚════════════════════════════════════════╝");
+
+    return 0;
+}
@@ -1,5 +1,8 @@
+#define _GNU_SOURCE
 #include "thread_pool.h"
 #include "task_queue.h"
+#include "cpu_topology.h"
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -285,6 +288,276 @@ void test_pool_performance() {
     print_test_result("test_pool_performance", passed);
 }
 
+typedef struct {
+    int *cpus;              // 每个任务观测到的 CPU
+    int index;
+} cpu_probe_arg_t;
+
+static void cpu_probe_task(void *arg) {
+    cpu_probe_arg_t *probe = (cpu_probe_arg_t *)arg;
+    usleep(1000);
+    probe->cpus[probe->index] = sched_getcpu();
+}
+
+void test_cpu_topology() {
+    print_test_header("Test 6: CPU Topology Detection");
+    
+    int passed = 1;
+    
+    // CPU 列表解析
+    int cpus[16];
+    int n = cpu_topology_parse_list("0-3,8,10-11", cpus, 16);
+    assert(n == 7);
+    assert(cpus[0] == 0 && cpus[3] == 3 && cpus[4] == 8 && cpus[6] == 11);
+    assert(cpu_topology_parse_list("2", cpus, 16) == 1 && cpus[0] == 2);
+    assert(cpu_topology_parse_list("0-3", cpus, 2) == 2);
+    assert(cpu_topology_parse_list("3-1", cpus, 16) == -1);
+    assert(cpu_topology_parse_list("a", cpus, 16) == -1);
+    
+    // 拓扑探测
+    cpu_topology_t *topo = cpu_topology_detect();
+    assert(topo != NULL);
+    assert(topo->num_cpus > 0);
+    assert(topo->num_cores > 0 && topo->num_cores <= topo->num_cpus);
+    assert(topo->num_nodes > 0);
+    printf("Topology: %d cpus, %d cores, %d nodes\n",
+           topo->num_cpus, topo->num_cores, topo->num_nodes);
+    
+    // 避开 SMT 兄弟时每个候选 CPU 都是物理核的第一个硬件线程
+    int *selected = malloc(topo->num_cpus * sizeof(int));
+    int count = cpu_topology_select(topo, AFFINITY_CORES, true, 0, NULL,
+                                    selected, topo->num_cpus);
+    assert(count > 0 && count <= topo->num_cores);
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < topo->num_cpus; j++) {
+            if (topo->cpus[j].cpu == selected[i]) {
+                assert(topo->cpus[j].smt_index == 0);
+            }
+        }
+    }
+    
+    // cpuset 模式只选出列表中的 CPU
+    char cpuset[16];
+    snprintf(cpuset, sizeof(cpuset), "%d", selected[0]);
+    count = cpu_topology_select(topo, AFFINITY_CPUSET, false, 0, cpuset,
+                                selected, topo->num_cpus);
+    assert(count == 1);
+    
+    free(selected);
+    cpu_topology_free(topo);
+    
+    print_test_result("test_cpu_topology", passed);
+}
+
+void test_pool_affinity() {
+    print_test_header("Test 7: Thread Pool CPU Affinity");
+    
+    int passed = 1;
+    
+    thread_pool_cfg_t config = {
+        .num_threads = 4,
+        .queue_size = 100,
+        .stack_size = 0,
+        .daemon_threads = false,
+        .affinity = AFFINITY_CORES,
+        .avoid_smt = true
+    };
+    
+    thread_pool_t *pool = thread_pool_create(&config);
+    assert(pool != NULL);
+    assert(pool->num_cpus > 0);
+    
+    for (int i = 0; i < pool->num_threads; i++) {
+        assert(pool->thread_infos[i].cpu == pool->cpu_list[i % pool->num_cpus]);
+    }
+    
+    // 任务只会运行在候选 CPU 上
+    const int NUM_TASKS = 32;
+    int observed[32];
+    cpu_probe_arg_t args[32];
+    for (int i = 0; i < NUM_TASKS; i++) {
+        args[i].cpus = observed;
+        args[i].index = i;
+        int ret = thread_pool_submit(pool, cpu_probe_task, &args[i], NULL);
+        assert(ret == 0);
+    }
+    thread_pool_wait_all(pool);
+    
+    for (int i = 0; i < NUM_TASKS; i++) {
+        bool found = false;
+        for (int j = 0; j < pool->num_cpus; j++) {
+            if (observed[i] == pool->cpu_list[j]) found = true;
+        }
+        assert(found);
+    }
+    
+    thread_pool_print_info(pool);
+    thread_pool_destroy(pool);
+    
+    // 不存在的 NUMA 节点应当创建失败
+    config.affinity = AFFINITY_NUMA_NODE;
+    config.numa_node = 4096;
+    assert(thread_pool_create(&config) == NULL);
+    
+    print_test_result("test_pool_affinity", passed);
+}
+
+typedef struct {
+    int *order;             // 执行顺序记录
+    int *next;              // 下一个写入位置
+    int tag;
+} order_task_arg_t;
+
+static void order_task(void *arg) {
+    order_task_arg_t *task_arg = (order_task_arg_t *)arg;
+    task_arg->order[(*task_arg->next)++] = task_arg->tag;
+}
+
+void test_queue_priority() {
+    print_test_header("Test 8: Queue Priority Classes");
+    
+    int passed = 1;
+    bool shutdown = false;
+    int ret;
+    
+    // 高优先级先出队，同优先级内保持 FIFO
+    task_queue_t *queue = task_queue_create(0);
+    assert(queue != NULL);
+    
+    int order[64];
+    int next = 0;
+    order_task_arg_t args[64];
+    const task_priority_t prios[] = {
+        TASK_PRIO_BACKGROUND, TASK_PRIO_NORMAL, TASK_PRIO_HIGH,
+        TASK_PRIO_NORMAL, TASK_PRIO_HIGH, TASK_PRIO_BACKGROUND
+    };
+    for (int i = 0; i < 6; i++) {
+        args[i] = (order_task_arg_t){ order, &next, i };
+        ret = task_queue_submit_prio(queue, order_task, &args[i], NULL, prios[i]);
+        assert(ret == 0);
+    }
+    ret = task_queue_submit_prio(queue, order_task, &args[0], NULL, TASK_PRIO_COUNT);
+    assert(ret == -1);
+    
+    for (int i = 0; i < 6; i++) {
+        Task *task = task_queue_pop(queue, &shutdown);
+        assert(task != NULL);
+        task->function(task->arg);
+        free(task);
+    }
+    const int expected[] = {2, 4, 1, 3, 0, 5};
+    for (int i = 0; i < 6; i++) {
+        assert(order[i] == expected[i]);
+    }
+    
+    // 饥饿保护：后台任务最多被插队 TASK_QUEUE_STARVATION_LIMIT 次
+    next = 0;
+    args[0] = (order_task_arg_t){ order, &next, -1 };
+    ret = task_queue_submit_prio(queue, order_task, &args[0], NULL, TASK_PRIO_BACKGROUND);
+    assert(ret == 0);
+    for (int i = 1; i < 40; i++) {
+        args[i] = (order_task_arg_t){ order, &next, i };
+        ret = task_queue_submit_prio(queue, order_task, &args[i], NULL, TASK_PRIO_HIGH);
+        assert(ret == 0);
+    }
+    for (int i = 0; i < 40; i++) {
+        Task *task = task_queue_pop(queue, &shutdown);
+        assert(task != NULL);
+        task->function(task->arg);
+        free(task);
+    }
+    printf("Background task ran at position %d\n", TASK_QUEUE_STARVATION_LIMIT);
+    assert(order[TASK_QUEUE_STARVATION_LIMIT] == -1);
+    assert(queue->stats.starvation_promotions == 1);
+    task_queue_print_stats(queue);
+    task_queue_destroy(queue);
+    
+    // 高优先级任务不受背压限制
+    queue = task_queue_create(2);
+    assert(queue != NULL);
+    for (int i = 0; i < 2; i++) {
+        ret = task_queue_submit_prio(queue, order_task, &args[i], NULL, TASK_PRIO_BACKGROUND);
+        assert(ret == 0);
+    }
+    ret = task_queue_submit_prio(queue, order_task, &args[2], NULL, TASK_PRIO_HIGH);
+    assert(ret == 0);
+    assert(task_queue_get_count(queue) == 3);
+    task_queue_destroy(queue);
+    
+    print_test_result("test_queue_priority", passed);
+}
+
+void test_pool_telemetry() {
+    print_test_header("Test 9: Thread Pool Telemetry");
+    
+    int passed = 1;
+    int ret;
+    
+    thread_pool_cfg_t config = {
+        .num_threads = 2,
+        .queue_size = 100,
+        .stack_size = 0,
+        .daemon_threads = false
+    };
+    
+    thread_pool_t *pool = thread_pool_create(&config);
+    assert(pool != NULL);
+    
+    const int NUM_TASKS = 20;
+    int counter = 0;
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    
+    for (int i = 0; i < NUM_TASKS; i++) {
+        test_task_arg_t *arg = malloc(sizeof(test_task_arg_t));
+        arg->value = i;
+        arg->sleep_ms = 2;
+        arg->mutex = &mutex;
+        arg->counter = &counter;
+        ret = thread_pool_submit(pool, counter_task, arg, cleanup_task_arg);
+        assert(ret == 0);
+    }
+    thread_pool_wait_all(pool);
+    
+    thread_pool_stats_t stats;
+    ret = thread_pool_get_stats(pool, &stats);
+    assert(ret == 0);
+    assert(stats.num_threads == 2);
+    assert(stats.submitted == (size_t)NUM_TASKS);
+    assert(stats.completed == (size_t)NUM_TASKS);
+    assert(stats.failed == 0);
+    assert(stats.queue_depth == 0);
+    assert(stats.queue_high_water >= 1);
+    assert(stats.exec_hist.count == (uint64_t)NUM_TASKS);
+    assert(stats.wait_hist.count == (uint64_t)NUM_TASKS);
+    
+    // 每个任务至少睡眠 2ms
+    assert(pool_histogram_percentile(&stats.exec_hist, 0.5) >= 1000000);
+    assert(pool_histogram_percentile(&stats.exec_hist, 1.0) == stats.exec_hist.max_ns);
+    
+    uint64_t busy_total = 0;
+    for (int i = 0; i < stats.num_threads; i++) {
+        busy_total += stats.workers[i].busy_ns;
+        assert(stats.workers[i].utilization >= 0.0 && stats.workers[i].utilization <= 1.0);
+    }
+    assert(busy_total >= (uint64_t)NUM_TASKS * 2000000);
+    thread_pool_stats_free(&stats);
+    
+    thread_pool_dump_stats(pool, stdout);
+    
+    // 重置后开始新的统计窗口
+    thread_pool_reset_stats(pool);
+    ret = thread_pool_get_stats(pool, &stats);
+    assert(ret == 0);
+    assert(stats.completed == 0 && stats.submitted == 0);
+    assert(stats.exec_hist.count == 0);
+    thread_pool_stats_free(&stats);
+    
+    pthread_mutex_destroy(&mutex);
+    thread_pool_destroy(pool);
+    
+    print_test_result("test_pool_telemetry", passed);
+}
+
 /* ======== 主测试函数 ======== */
 
 int main() {
@@ -298,6 +571,10 @@ int main() {
     test_pool_concurrent_execution();
     test_queue_backpressure();
     test_pool_performance();
+    test_cpu_topology();
+    test_pool_affinity();
+    test_queue_priority();
+    test_pool_telemetry();
     
     printf("\n");
     printf("════════════════════════════════════════════════════════════\n");
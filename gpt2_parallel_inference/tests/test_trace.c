@@ -0,0 +1,171 @@
+#include "gpt2.h"
+#include "matrix_parallel.h"
+#include "trace.h"
+
+#define TRACE_TEST_PATH "/tmp/gpt2_trace_test.json"
+
+/**
+ * 读取整个文件到内存（调用者释放）
+ */
+static char* read_file(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) return NULL;
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char *buf = (char *)malloc(size + 1);
+    if (buf != NULL) {
+        size_t n = fread(buf, 1, size, fp);
+        buf[n] = '\0';
+    }
+    fclose(fp);
+    return buf;
+}
+
+void test_trace_disabled() {
+    INFO_PRINT("=== Test: Tracing Disabled ===");
+
+    trace_reset();
+    ASSERT(!trace_enabled(), "Tracing must be off by default");
+    ASSERT(trace_now() == 0, "trace_now must return 0 when disabled");
+
+    trace_complete("ignored", "test", 12345, 0);
+    ASSERT(trace_event_count(NULL) == 0, "No events expected when disabled");
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+void test_trace_overflow() {
+    INFO_PRINT("=== Test: Trace Buffer Overflow ===");
+
+    trace_start(4);
+    for (int i = 0; i < 10; i++) {
+        uint64_t t0 = trace_now();
+        ASSERT(t0 != 0, "trace_now must return a timestamp when enabled");
+        trace_complete("loop", "test", t0, i);
+    }
+
+    size_t dropped = 0;
+    size_t count = trace_event_count(&dropped);
+    ASSERT(count == 4, "Buffer must keep exactly its capacity");
+    ASSERT(dropped == 6, "Overflowing events must be counted as dropped");
+
+    trace_reset();
+    ASSERT(trace_event_count(NULL) == 0, "Reset must discard events");
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+void test_trace_parallel_regions() {
+    INFO_PRINT("=== Test: Trace Parallel Regions ===");
+
+    trace_start(0);
+    trace_set_thread_name("main");
+
+    matrix_config_t config = {
+        .num_threads = 2,
+        .block_size = 16,
+        .use_blocking = true,
+        .use_simd = false
+    };
+    matrix_init(&config);
+
+    // 矩阵乘法
+    size_t shape[] = {32, 32};
+    Tensor *A = tensor_create(2, shape);
+    Tensor *B = tensor_create(2, shape);
+    Tensor *C = tensor_create(2, shape);
+    tensor_fill_random(A, -1.0f, 1.0f);
+    tensor_fill_random(B, -1.0f, 1.0f);
+    matmul_parallel_row(A, B, C);
+    matmul_parallel_blocked(A, B, C);
+
+    // 多头注意力
+    size_t seq_len = 4;
+    size_t d_model = 16;
+    size_t input_shape[] = {seq_len, d_model};
+    size_t weight_shape[] = {d_model, d_model};
+    size_t bias_shape[] = {d_model};
+
+    Tensor *X = tensor_create(2, input_shape);
+    Tensor *out = tensor_create(2, input_shape);
+    tensor_fill_random(X, -1.0f, 1.0f);
+
+    attention_weights_t weights;
+    weights.W_Q = tensor_create(2, weight_shape);
+    weights.W_K = tensor_create(2, weight_shape);
+    weights.W_V = tensor_create(2, weight_shape);
+    weights.W_O = tensor_create(2, weight_shape);
+    weights.b_Q = tensor_create(1, bias_shape);
+    weights.b_K = tensor_create(1, bias_shape);
+    weights.b_V = tensor_create(1, bias_shape);
+    weights.b_O = tensor_create(1, bias_shape);
+    tensor_fill_random(weights.W_Q, -0.1f, 0.1f);
+    tensor_fill_random(weights.W_K, -0.1f, 0.1f);
+    tensor_fill_random(weights.W_V, -0.1f, 0.1f);
+    tensor_fill_random(weights.W_O, -0.1f, 0.1f);
+
+    int ret = attention_multi_head_parallel(X, &weights, 2, NULL, out);
+    ASSERT(ret == 0, "Parallel attention failed");
+
+    trace_stop();
+    ASSERT(trace_event_count(NULL) > 0, "Expected recorded events");
+    ret = trace_export_chrome(TRACE_TEST_PATH);
+    ASSERT(ret == 0, "Export failed");
+
+    char *json = read_file(TRACE_TEST_PATH);
+    ASSERT(json != NULL, "Failed to read exported trace");
+
+    const char *expected[] = {
+        "\"traceEvents\"", "\"ph\":\"X\"", "\"name\":\"main\"", "\"name\":\"worker-0\"",
+        "\"name\":\"task\"", "\"name\":\"wait_all\"",
+        "\"name\":\"matmul_parallel_row\"", "\"name\":\"matmul_row_task\"",
+        "\"name\":\"matmul_parallel_blocked\"", "\"name\":\"matmul_blocked_task\"",
+        "\"name\":\"attention_head\"", "\"name\":\"attn.qkv_proj\"", "\"name\":\"attn.out_proj\""
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(expected); i++) {
+        if (strstr(json, expected[i]) == NULL) {
+            ERROR_PRINT("Missing %s in exported trace", expected[i]);
+        }
+        ASSERT(strstr(json, expected[i]) != NULL, "Exported trace missing expected event");
+    }
+    free(json);
+    remove(TRACE_TEST_PATH);
+
+    tensor_free(A);
+    tensor_free(B);
+    tensor_free(C);
+    tensor_free(X);
+    tensor_free(out);
+    tensor_free(weights.W_Q);
+    tensor_free(weights.W_K);
+    tensor_free(weights.W_V);
+    tensor_free(weights.W_O);
+    tensor_free(weights.b_Q);
+    tensor_free(weights.b_K);
+    tensor_free(weights.b_V);
+    tensor_free(weights.b_O);
+
+    matrix_cleanup();
+    trace_reset();
+
+    INFO_PRINT("✓ PASSED\n");
+}
+
+int main() {
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   Trace Export Tests                   ║");
+    INFO_PRINT("╚════════════════════════════════════════╝\n");
+
+    test_trace_disabled();
+    test_trace_overflow();
+    test_trace_parallel_regions();
+
+    INFO_PRINT("╔════════════════════════════════════════╗");
+    INFO_PRINT("║   All Tests PASSED!                    ║");
+    INFO_PRINT("╚════════════════════════════════════════╝");
+
+    return 0;
+}
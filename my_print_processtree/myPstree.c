@@ -1,24 +1,74 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <dirent.h>
+#include <fcntl.h>
 #include <ctype.h>
 #include <getopt.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/syscall.h>
 
 #define VERSION "1.0.0.0"
-#define MAX_PROCESSES 32768
+#define DIRENT_BUFFER_SIZE (64 * 1024)  // getdents64 每批读取的缓冲区大小
+#define STAT_BUFFER_SIZE 1024           // /proc/PID/stat 只需要前面的若干字段
+#define MAX_SCAN_THREADS 8              // 并行扫描的最大线程数
+#define MIN_PIDS_PER_THREAD 1024        // 每个线程至少分到的 PID 数，进程少时不开线程
+
+// getdents64 返回的目录项（glibc 不一定导出该结构）
+struct linuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// /proc 中的一个 PID 目录；进程退出后 PID 被复用时目录的 inode 号会变
+typedef struct {
+    int pid;
+    uint64_t ino;
+} PidEntry;
+
+// 进程中除主线程外的一个线程（/proc/PID/task/TID）
+typedef struct {
+    int tid;
+    char comm[256];
+    unsigned long long cpu;             // utime + stime，时钟节拍
+} ThreadInfo;
 
 typedef struct Process {
     int pid;
     int ppid;
     char comm[256];
+    unsigned long long starttime;       // 与 pid 一起唯一标识一个进程（PID 会被复用）
+    uint64_t ino;                       // 读取时 /proc/PID 的 inode 号，--watch 据此跳过未变的进程
+    bool seen;                          // --watch：本轮扫描仍然存在
+    ThreadInfo *threadList;             // -t：按名字、TID 排序
+    int threadListCount;
+    unsigned long long utime, stime;    // 时钟节拍
+    long rss;                           // 页数
+    long threads;
+    unsigned long long totalCpu;        // 整个子树（含自身）的 utime + stime
+    long totalRss;
+    long totalThreads;
+    struct Process *parent;
     struct Process **children;
     int childCount;
-    int childCapacity;
 } Process;
 
+// 扫描线程：解析分到的一段 PID，结果先放在线程自己的数组里，结束后统一合并
+typedef struct {
+    int procFd;
+    const PidEntry *pids;
+    int pidCount;
+    Process **procs;
+    int procCount;
+} ScanWorker;
+
 typedef struct {
     char comm[256];
     int count;
@@ -26,18 +76,45 @@ typedef struct {
     int procCount;
 } MergedProc;
 
-Process *processes[MAX_PROCESSES];
+Process **processes = NULL;
 int processCount = 0;
+int processCapacity = 0;
+
+// pid -> Process 的开放寻址哈希表（线性探测），大小为 2 的幂且至少是进程数的两倍
+Process **pidTable = NULL;
+int pidTableMask = 0;
+
+// 所有子进程数组共用的一块内存，按各父进程的子进程数切分
+Process **childPool = NULL;
 bool isShowPids = false;
 bool isNumericSort = false;
+bool isShowRollup = false;
+bool isShowThreads = false;
+bool isShowThreadCpu = false;
+double watchInterval = 0;               // --watch 的扫描间隔（秒），0 表示只输出一次
+
+// 子进程的排序方式：名字（默认）或按子树资源占用从大到小
+typedef enum {
+    SORT_NAME,
+    SORT_CPU,
+    SORT_RSS,
+    SORT_THREADS,
+} CostSort;
+
+CostSort costSort = SORT_NAME;
+
+static void freeProcess(Process *proc) {
+    free(proc->threadList);
+    free(proc);
+}
 
 static void freeProcesses() {
     for(int i = 0; i < processCount; i++) {
-        if(processes[i]->children) {
-            free(processes[i]->children);
-        }
-        free(processes[i]);
+        freeProcess(processes[i]);
     }
+    free(processes);
+    free(pidTable);
+    free(childPool);
 }
 
 static bool processNameIsNumber(const char *pstr) {
@@ -49,55 +126,105 @@ static bool processNameIsNumber(const char *pstr) {
     return true;
 }
 
-static bool readProcessInfo(int pid, Process *proc) {
-    char path[512];
-    char line[1024];
-    FILE *fp;
-    
+/**
+ * 读取一个进程的信息：相对 /proc 目录描述符 openat 打开 PID/stat，一次 read 读入栈上缓冲区，
+ * 从中解析 comm 和 ppid。comm 可能含空格和括号，以最后一个 ')' 为界
+ */
+static bool readProcessInfo(int procFd, int pid, Process *proc) {
+    char path[64];
+    char buf[STAT_BUFFER_SIZE];
+
     proc->pid = pid;
     proc->ppid = 0;
+    proc->ino = 0;
+    proc->seen = false;
+    proc->threadList = NULL;
+    proc->threadListCount = 0;
+    proc->parent = NULL;
     proc->children = NULL;
     proc->childCount = 0;
-    proc->childCapacity = 0;
-    
-    snprintf(path, sizeof(path), "/proc/%d/comm", pid);
-    fp = fopen(path, "r");
-    if(!fp) return false;
-    
-    if(fgets(proc->comm, sizeof(proc->comm), fp)) {
-        proc->comm[strcspn(proc->comm, "\n")] = 0;
-    }
-    fclose(fp);
-    
-    snprintf(path, sizeof(path), "/proc/%d/status", pid);
-    fp = fopen(path, "r");
-    if(!fp) return false;
-    
-    while(fgets(line, sizeof(line), fp)) {
-        if(sscanf(line, "PPid:\t%d", &proc->ppid) == 1) break;
-    }
-    fclose(fp);
-    
+
+    snprintf(path, sizeof(path), "%d/stat", pid);
+    int fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return false;
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if(len <= 0) return false;
+    buf[len] = '\0';
+
+    char *lparen = strchr(buf, '(');
+    char *rparen = strrchr(buf, ')');
+    if(!lparen || !rparen || rparen < lparen) return false;
+
+    size_t commLen = rparen - lparen - 1;
+    if(commLen >= sizeof(proc->comm)) commLen = sizeof(proc->comm) - 1;
+    memcpy(proc->comm, lparen + 1, commLen);
+    proc->comm[commLen] = '\0';
+
+    // ") state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt utime stime
+    //    cutime cstime priority nice num_threads itrealvalue starttime vsize rss ..."
+    char state;
+    if(sscanf(rparen + 1, " %c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu %*d %*d %*d %*d %ld %*d %llu %*u %ld",
+              &state, &proc->ppid, &proc->utime, &proc->stime, &proc->threads,
+              &proc->starttime, &proc->rss) != 7) return false;
+
     return true;
 }
 
-static void addChild(Process *parent, Process *child) {
-    if(parent->childCount >= parent->childCapacity) {
-        parent->childCapacity = parent->childCapacity == 0 ? 4 : parent->childCapacity * 2;
-        parent->children = (Process **)realloc(parent->children, 
-                                               parent->childCapacity * sizeof(Process *));
-        if(!parent->children) {
+static void addProcess(Process *proc) {
+    if(processCount >= processCapacity) {
+        processCapacity = processCapacity == 0 ? 1024 : processCapacity * 2;
+        processes = (Process **)realloc(processes, processCapacity * sizeof(Process *));
+        if(!processes) {
             perror("realloc");
             exit(1);
         }
     }
-    parent->children[parent->childCount++] = child;
+    processes[processCount++] = proc;
+}
+
+static unsigned pidHash(int pid) {
+    return ((unsigned)pid * 2654435761u) & (unsigned)pidTableMask;
+}
+
+static void buildPidTable() {
+    int size = 1;
+    while(size < processCount * 2) size <<= 1;
+
+    free(pidTable);
+    pidTable = (Process **)calloc(size, sizeof(Process *));
+    if(!pidTable) {
+        perror("calloc");
+        exit(1);
+    }
+    pidTableMask = size - 1;
+
+    for(int i = 0; i < processCount; i++) {
+        unsigned h = pidHash(processes[i]->pid);
+        while(pidTable[h]) h = (h + 1) & (unsigned)pidTableMask;
+        pidTable[h] = processes[i];
+    }
+}
+
+static Process *findProcess(int pid) {
+    for(unsigned h = pidHash(pid); pidTable[h]; h = (h + 1) & (unsigned)pidTableMask) {
+        if(pidTable[h]->pid == pid) return pidTable[h];
+    }
+    return NULL;
 }
 
 static int compareProcesses(const void *a, const void *b) {
     Process *p1 = *(Process**)a;
     Process *p2 = *(Process**)b;
     
+    if(costSort != SORT_NAME) {
+        long long d1 = costSort == SORT_CPU ? (long long)p1->totalCpu :
+                       costSort == SORT_RSS ? p1->totalRss : p1->totalThreads;
+        long long d2 = costSort == SORT_CPU ? (long long)p2->totalCpu :
+                       costSort == SORT_RSS ? p2->totalRss : p2->totalThreads;
+        if(d1 != d2) return d1 > d2 ? -1 : 1;
+    }
+
     if(isNumericSort) {
         return p1->pid - p2->pid;
     } else {
@@ -106,43 +233,205 @@ static int compareProcesses(const void *a, const void *b) {
     }
 }
 
-void scanProcfs() {
-    DIR *dir = opendir("/proc");
-    if(!dir) {
-        perror("opendir /proc");
+static PidEntry *listPids(int procFd, int *count);
+static void readThreads(int procFd, Process *proc);
+
+static void *scanWorker(void *arg) {
+    ScanWorker *worker = (ScanWorker *)arg;
+
+    // 最多 pidCount 个结果，一次分配即可
+    worker->procs = (Process **)malloc((worker->pidCount > 0 ? worker->pidCount : 1) * sizeof(Process *));
+    if(!worker->procs) return NULL;
+
+    for(int i = 0; i < worker->pidCount; i++) {
+        Process *proc = (Process *)malloc(sizeof(Process));
+        if(!proc) break;
+
+        if(readProcessInfo(worker->procFd, worker->pids[i].pid, proc)) {
+            proc->ino = worker->pids[i].ino;
+            if(isShowThreads) readThreads(worker->procFd, proc);
+            worker->procs[worker->procCount++] = proc;
+        } else {
+            free(proc);                     // 扫描期间已退出
+        }
+    }
+    return NULL;
+}
+
+// 用 getdents64 成批读取 /proc（或 /proc/PID/task）的目录项，返回其中的 PID 列表（每次从头读取）
+static PidEntry *listPids(int procFd, int *count) {
+    char *dirents = (char *)malloc(DIRENT_BUFFER_SIZE);
+    int capacity = 1024;
+    PidEntry *pids = (PidEntry *)malloc(capacity * sizeof(PidEntry));
+    if(!dirents || !pids) {
+        perror("malloc");
         exit(1);
     }
-    
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if(!processNameIsNumber(entry->d_name)) continue;
-        
-        int pid = atoi(entry->d_name);
-        Process *proc = (Process *)malloc(sizeof(Process));
-        if(!proc) {
-            perror("malloc");
-            continue;
+
+    *count = 0;
+    lseek(procFd, 0, SEEK_SET);
+    long nread;
+    while((nread = syscall(SYS_getdents64, procFd, dirents, DIRENT_BUFFER_SIZE)) > 0) {
+        for(long pos = 0; pos < nread; ) {
+            struct linuxDirent64 *entry = (struct linuxDirent64 *)(dirents + pos);
+            pos += entry->d_reclen;
+            if(!processNameIsNumber(entry->d_name)) continue;
+
+            if(*count >= capacity) {
+                capacity *= 2;
+                pids = (PidEntry *)realloc(pids, capacity * sizeof(PidEntry));
+                if(!pids) {
+                    perror("realloc");
+                    exit(1);
+                }
+            }
+            pids[*count].pid = atoi(entry->d_name);
+            pids[*count].ino = entry->d_ino;
+            (*count)++;
         }
-        
-        if(readProcessInfo(pid, proc)) {
-            processes[processCount++] = proc;
-            if(processCount >= MAX_PROCESSES) break;
-        } else {
-            free(proc);
+    }
+    if(nread < 0) perror("getdents64 /proc");
+
+    free(dirents);
+    return pids;
+}
+
+static int compareThreads(const void *a, const void *b) {
+    const ThreadInfo *t1 = (const ThreadInfo *)a;
+    const ThreadInfo *t2 = (const ThreadInfo *)b;
+    int cmp = strcmp(t1->comm, t2->comm);
+    return cmp == 0 ? t1->tid - t2->tid : cmp;
+}
+
+/**
+ * 读取进程的其他线程：与 /proc 相同，用 getdents64 列出 PID/task 下的 TID，
+ * 相对 task 目录描述符逐个读取一次 TID/stat（格式与进程的 stat 相同）
+ */
+static void readThreads(int procFd, Process *proc) {
+    if(proc->threads <= 1) return;
+
+    char path[64];
+    snprintf(path, sizeof(path), "%d/task", proc->pid);
+    int taskFd = openat(procFd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(taskFd < 0) return;
+
+    int tidCount;
+    PidEntry *tids = listPids(taskFd, &tidCount);
+    proc->threadList = (ThreadInfo *)malloc((tidCount > 0 ? tidCount : 1) * sizeof(ThreadInfo));
+    if(proc->threadList) {
+        for(int i = 0; i < tidCount; i++) {
+            Process thread;
+            if(tids[i].pid == proc->pid) continue;                         // 主线程即进程本身
+            if(!readProcessInfo(taskFd, tids[i].pid, &thread)) continue;   // 已退出
+
+            ThreadInfo *info = &proc->threadList[proc->threadListCount++];
+            info->tid = thread.pid;
+            memcpy(info->comm, thread.comm, sizeof(info->comm));
+            info->cpu = thread.utime + thread.stime;
         }
+        qsort(proc->threadList, proc->threadListCount, sizeof(ThreadInfo), compareThreads);
+    }
+
+    free(tids);
+    close(taskFd);
+}
+
+/**
+ * 先列出全部 PID，再平均分给若干线程并行读取各自的 stat
+ * 线程只写自己的结果数组，合并时按线程顺序追加，与单线程扫描的顺序一致；
+ * 扫描期间退出的进程读取失败直接跳过，其子进程找不到父进程时不出现在树中
+ */
+void scanProcfs() {
+    int procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(procFd < 0) {
+        perror("open /proc");
+        exit(1);
+    }
+
+    int pidCount;
+    PidEntry *pids = listPids(procFd, &pidCount);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threadCount = pidCount / MIN_PIDS_PER_THREAD;
+    if(threadCount > cpus) threadCount = (int)cpus;
+    if(threadCount > MAX_SCAN_THREADS) threadCount = MAX_SCAN_THREADS;
+    if(threadCount < 1) threadCount = 1;
+
+    ScanWorker workers[MAX_SCAN_THREADS];
+    pthread_t threads[MAX_SCAN_THREADS];
+    bool started[MAX_SCAN_THREADS];
+    memset(workers, 0, sizeof(workers));
+    for(int i = 0; i < threadCount; i++) {
+        int first = (int)((long)pidCount * i / threadCount);
+        int last = (int)((long)pidCount * (i + 1) / threadCount);
+        workers[i].procFd = procFd;
+        workers[i].pids = pids + first;
+        workers[i].pidCount = last - first;
+        // 只有一段时直接在当前线程扫描，线程创建失败也退回到当前线程
+        started[i] = threadCount > 1 && pthread_create(&threads[i], NULL, scanWorker, &workers[i]) == 0;
+        if(!started[i]) scanWorker(&workers[i]);
+    }
+
+    for(int i = 0; i < threadCount; i++) {
+        if(started[i]) pthread_join(threads[i], NULL);
+        for(int j = 0; j < workers[i].procCount; j++) {
+            addProcess(workers[i].procs[j]);
+        }
+        free(workers[i].procs);
+    }
+
+    free(pids);
+    close(procFd);
+}
+
+// 后序遍历：子树总量 = 自身 + 各子树总量
+static void rollupTree(Process *proc) {
+    proc->totalCpu = proc->utime + proc->stime;
+    proc->totalRss = proc->rss;
+    proc->totalThreads = proc->threads;
+    for(int i = 0; i < proc->childCount; i++) {
+        Process *child = proc->children[i];
+        rollupTree(child);
+        proc->totalCpu += child->totalCpu;
+        proc->totalRss += child->totalRss;
+        proc->totalThreads += child->totalThreads;
     }
-    closedir(dir);
 }
 
 void buildTree() {
+    buildPidTable();
+
+    // 第一遍：找父进程并统计每个父进程的子进程数（--watch 下进程会被重复使用，先清零）
+    for(int i = 0; i < processCount; i++) {
+        processes[i]->childCount = 0;
+    }
     for(int i = 0; i < processCount; i++) {
         Process *child = processes[i];
-        for(int j = 0; j < processCount; j++) {
-            if(processes[j]->pid == child->ppid) {
-                addChild(processes[j], child);
-                break;
-            }
-        }
+        child->parent = child->ppid != child->pid ? findProcess(child->ppid) : NULL;
+        if(child->parent) child->parent->childCount++;
+    }
+
+    // 按统计的大小从同一块内存中切出各自的子进程数组，第二遍填入
+    free(childPool);
+    childPool = (Process **)malloc((processCount > 0 ? processCount : 1) * sizeof(Process *));
+    if(!childPool) {
+        perror("malloc");
+        exit(1);
+    }
+    int offset = 0;
+    for(int i = 0; i < processCount; i++) {
+        processes[i]->children = childPool + offset;
+        offset += processes[i]->childCount;
+        processes[i]->childCount = 0;
+    }
+    for(int i = 0; i < processCount; i++) {
+        Process *child = processes[i];
+        if(child->parent) child->parent->children[child->parent->childCount++] = child;
+    }
+
+    // 从每棵树的根开始汇总，排序要用到子树总量
+    for(int i = 0; i < processCount; i++) {
+        if(!processes[i]->parent) rollupTree(processes[i]);
     }
     
     for(int i = 0; i < processCount; i++) {
@@ -153,15 +442,46 @@ void buildTree() {
     }
 }
 
+// 以 K/M/G 显示字节数
+static void formatBytes(double bytes, char *buf, size_t size) {
+    const char *units = "KMGT";
+    int unit = -1;
+    while(bytes >= 1024.0 && unit < 3) {
+        bytes /= 1024.0;
+        unit++;
+    }
+    if(unit < 0) snprintf(buf, size, "%.0f", bytes);
+    else snprintf(buf, size, "%.1f%c", bytes, units[unit]);
+}
+
 void printTree(Process *proc, const char *prefix) {
     if (isShowPids) {
-        printf("%s(%d)\n", proc->comm, proc->pid);
+        printf("%s(%d)", proc->comm, proc->pid);
     } else {
-        printf("%s\n", proc->comm);
+        printf("%s", proc->comm);
     }
+    if (isShowRollup) {
+        static long ticks = 0, pageSize = 0;
+        if(ticks == 0) ticks = sysconf(_SC_CLK_TCK);
+        if(pageSize == 0) pageSize = sysconf(_SC_PAGESIZE);
+
+        char rss[32];
+        formatBytes((double)proc->totalRss * pageSize, rss, sizeof(rss));
+        printf(" [cpu %.2fs, rss %s, %ld thr]", (double)proc->totalCpu / ticks, rss, proc->totalThreads);
+    }
+    printf("\n");
+
+    // 线程排在子进程之后；不显示 PID 时同名线程合并为一行
+    int threadLines = 0;
+    for (int i = 0; i < proc->threadListCount; i++) {
+        if (isShowPids || i == 0 || strcmp(proc->threadList[i].comm, proc->threadList[i - 1].comm) != 0) {
+            threadLines++;
+        }
+    }
+    int lineCount = proc->childCount + threadLines;
     
     for (int i = 0; i < proc->childCount; i++) {
-        bool isChildLast = (i == proc->childCount - 1);
+        bool isChildLast = (i == lineCount - 1);
         
         printf("%s%s", prefix, isChildLast ? "└─" : "├─");
         
@@ -170,6 +490,174 @@ void printTree(Process *proc, const char *prefix) {
         
         printTree(proc->children[i], newPrefix);
     }
+
+    int line = proc->childCount;
+    for (int i = 0; i < proc->threadListCount; ) {
+        const ThreadInfo *thread = &proc->threadList[i];
+        int count = 1;
+        unsigned long long cpu = thread->cpu;
+        while (!isShowPids && i + count < proc->threadListCount &&
+               strcmp(proc->threadList[i + count].comm, thread->comm) == 0) {
+            cpu += proc->threadList[i + count].cpu;
+            count++;
+        }
+        i += count;
+
+        printf("%s%s{%s}", prefix, ++line == lineCount ? "└─" : "├─", thread->comm);
+        if (isShowPids) printf("(%d)", thread->tid);
+        if (count > 1) printf("×%d", count);
+        if (isShowThreadCpu) printf(" [cpu %.2fs]", (double)cpu / sysconf(_SC_CLK_TCK));
+        printf("\n");
+    }
+}
+
+static void printEventTime() {
+    char buf[16];
+    time_t now = time(NULL);
+    strftime(buf, sizeof(buf), "%H:%M:%S", localtime(&now));
+    printf("[%s] ", buf);
+}
+
+static void printProcessName(const Process *proc) {
+    if(proc) printf("%s(%d)", proc->comm, proc->pid);
+    else printf("?");
+}
+
+/**
+ * 增量重扫一次，输出与上一轮的差异
+ * 目录项 inode 号未变的进程直接沿用上一轮解析的数据；inode 号变了才重新读 stat，
+ * 并用 (pid, starttime) 判断是同一个进程还是 PID 被复用；
+ * 进程只在父进程退出时被重新认领，所以只有父进程刚退出的进程需要重读 ppid
+ */
+static void rescanProcfs(int procFd) {
+    int pidCount;
+    PidEntry *pids = listPids(procFd, &pidCount);
+
+    Process **current = (Process **)malloc((pidCount > 0 ? pidCount : 1) * sizeof(Process *));
+    Process **forks = (Process **)malloc((pidCount > 0 ? pidCount : 1) * sizeof(Process *));
+    Process **exits = (Process **)malloc((processCount > 0 ? processCount : 1) * sizeof(Process *));
+    int *oldPpids = (int *)malloc((pidCount > 0 ? pidCount : 1) * sizeof(int));
+    if(!current || !forks || !exits || !oldPpids) {
+        perror("malloc");
+        exit(1);
+    }
+    int currentCount = 0, forkCount = 0, exitCount = 0;
+
+    for(int i = 0; i < processCount; i++) {
+        processes[i]->seen = false;
+    }
+
+    for(int i = 0; i < pidCount; i++) {
+        Process *old = findProcess(pids[i].pid);
+        if(old && old->ino == pids[i].ino) {
+            old->seen = true;
+            oldPpids[currentCount] = old->ppid;
+            current[currentCount++] = old;
+            continue;
+        }
+
+        Process *proc = (Process *)malloc(sizeof(Process));
+        if(!proc) {
+            perror("malloc");
+            exit(1);
+        }
+        if(!readProcessInfo(procFd, pids[i].pid, proc)) {
+            free(proc);                     // 刚出现就已退出
+            continue;
+        }
+        proc->ino = pids[i].ino;
+
+        if(old && old->starttime == proc->starttime) {
+            // 同一个进程，只是 /proc 的 inode 被重新分配了
+            old->ino = proc->ino;
+            old->seen = true;
+            oldPpids[currentCount] = old->ppid;
+            old->ppid = proc->ppid;
+            memcpy(old->comm, proc->comm, sizeof(old->comm));
+            current[currentCount++] = old;
+            free(proc);
+        } else {
+            oldPpids[currentCount] = proc->ppid;
+            current[currentCount++] = proc;
+            forks[forkCount++] = proc;
+        }
+    }
+
+    for(int i = 0; i < processCount; i++) {
+        if(!processes[i]->seen) exits[exitCount++] = processes[i];
+    }
+
+    // 父进程已退出的进程被 init 或 subreaper 认领，重新读取 ppid
+    for(int i = 0; i < currentCount; i++) {
+        Process *proc = current[i];
+        if(!proc->parent || proc->parent->seen) continue;
+
+        Process fresh;
+        if(readProcessInfo(procFd, proc->pid, &fresh) && fresh.starttime == proc->starttime) {
+            proc->ppid = fresh.ppid;
+        }
+    }
+
+    for(int i = 0; i < exitCount; i++) {
+        printEventTime();
+        printf("- ");
+        printProcessName(exits[i]);
+        printf(" exited, parent ");
+        printProcessName(exits[i]->parent);
+        printf("\n");
+    }
+
+    // 旧的父进程指针在 buildTree 之前仍然有效（退出的进程尚未释放）
+    free(processes);
+    processes = current;
+    processCount = currentCount;
+    processCapacity = pidCount > 0 ? pidCount : 1;
+    for(int i = 0; i < exitCount; i++) {
+        freeProcess(exits[i]);
+    }
+    buildTree();
+
+    for(int i = 0; i < currentCount; i++) {
+        Process *proc = current[i];
+        if(proc->ppid == oldPpids[i]) continue;
+        printEventTime();
+        printf("~ ");
+        printProcessName(proc);
+        printf(" reparented %d -> ", oldPpids[i]);
+        printProcessName(proc->parent);
+        printf("\n");
+    }
+    for(int i = 0; i < forkCount; i++) {
+        printEventTime();
+        printf("+ ");
+        printProcessName(forks[i]);
+        printf(" parent ");
+        printProcessName(forks[i]->parent);
+        printf("\n");
+    }
+    fflush(stdout);
+
+    free(forks);
+    free(exits);
+    free(oldPpids);
+    free(pids);
+}
+
+// --watch：先输出完整的树，之后每隔 interval 秒增量重扫并只输出变化
+static void watchProcfs(double interval) {
+    int procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(procFd < 0) {
+        perror("open /proc");
+        exit(1);
+    }
+
+    struct timespec delay;
+    delay.tv_sec = (time_t)interval;
+    delay.tv_nsec = (long)((interval - (double)delay.tv_sec) * 1e9);
+    while(1) {
+        nanosleep(&delay, NULL);
+        rescanProcfs(procFd);
+    }
 }
 
 void printVersion() {
@@ -182,6 +670,12 @@ void printUsage(const char *progname) {
     printf("Options:\n");
     printf("  -p, --show-pids    Show PIDs\n");
     printf("  -n, --numeric-sort Sort by PID instead of name\n");
+    printf("  -r, --rollup       Show CPU time, RSS and threads summed over each subtree\n");
+    printf("  -s, --sort=KEY     Sort children by subtree cost: cpu, rss or threads\n");
+    printf("  -t, --threads      Show threads, identical names collapsed as {name}×N\n");
+    printf("  -T, --thread-cpu   Like -t, also show CPU time per thread (summed when collapsed)\n");
+    printf("  -w, --watch=SEC    After the tree, rescan every SEC seconds and print forks,\n");
+    printf("                     exits and reparenting as they happen\n");
     printf("  -V, --version      Display version information\n");
     printf("  -h, --help         Display this help message\n");
 }
@@ -191,12 +685,17 @@ int main(int argc, char *argv[]) {
     static struct option options[] = {
         {"show-pids", no_argument, 0, 'p'},
         {"numeric-sort", no_argument, 0, 'n'},
+        {"rollup", no_argument, 0, 'r'},
+        {"sort", required_argument, 0, 's'},
+        {"threads", no_argument, 0, 't'},
+        {"thread-cpu", no_argument, 0, 'T'},
+        {"watch", required_argument, 0, 'w'},
         {"version", no_argument, 0, 'V'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
     
-    while((opt = getopt_long(argc, argv, "pnVh", options, NULL)) != -1) {
+    while((opt = getopt_long(argc, argv, "pnrs:tTw:Vh", options, NULL)) != -1) {
         switch (opt) {
             case 'p':
                 isShowPids = true;
@@ -204,6 +703,35 @@ int main(int argc, char *argv[]) {
             case 'n':
                 isNumericSort = true;
                 break;
+            case 'r':
+                isShowRollup = true;
+                break;
+            case 's':
+                if(strcmp(optarg, "cpu") == 0) costSort = SORT_CPU;
+                else if(strcmp(optarg, "rss") == 0) costSort = SORT_RSS;
+                else if(strcmp(optarg, "threads") == 0) costSort = SORT_THREADS;
+                else {
+                    fprintf(stderr, "Unknown sort key: %s\n", optarg);
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'T':
+                isShowThreadCpu = true;
+                isShowThreads = true;
+                break;
+            case 't':
+                isShowThreads = true;
+                break;
+            case 'w': {
+                char *end;
+                watchInterval = strtod(optarg, &end);
+                if(*end != '\0' || watchInterval <= 0) {
+                    fprintf(stderr, "Invalid watch interval: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            }
             case 'V':
                 printVersion();
                 return 0;
@@ -225,13 +753,7 @@ int main(int argc, char *argv[]) {
     
     buildTree();
     
-    Process *root = NULL;
-    for(int i = 0; i < processCount; i++) {
-        if(processes[i]->pid == 1) {
-            root = processes[i];
-            break;
-        }
-    }
+    Process *root = findProcess(1);
     
     if(!root) {
         for(int i = 0; i < processCount; i++) {
@@ -247,6 +769,11 @@ int main(int argc, char *argv[]) {
     } else {
         fprintf(stderr, "Could not find root process\n");
     }
+
+    if(watchInterval > 0) {
+        fflush(stdout);
+        watchProcfs(watchInterval);
+    }
     
     freeProcesses();
     return 0;
@@ -1,103 +1,1619 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
+#include <sched.h>
 #include <errno.h>
+#include <stdint.h>
+#include <getopt.h>
 #include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <sys/user.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <elf.h>
+#include <pthread.h>
 #include <sys/time.h>
+#include <dirent.h>
 #include <time.h>
+#include <math.h>
 
-#define MAX_SYSCALLS 512
-#define MAX_LINE 4096
+#include "syscall_names.h"      // 由 Makefile 从 <sys/syscall.h> 生成
+
+#define MAX_SYSCALLS 512           // 按系统调用号直接索引，另有一个槽位收集超出范围的号
 #define REPORT_INTERVAL 0.1
+#define NUM_SYSCALL_NAMES (sizeof(syscall_names) / sizeof(syscall_names[0]))
+#define LIVE_DISPLAY_COUNT 10
+#define LIVE_TASK_COUNT 5
+#define TASK_HASH_SIZE 1024
+#define TASK_TOP_SYSCALLS 3
+#define MAX_TREE_DEPTH 64
+#define MAX_ATTACH_PIDS 64
+#define FD_HASH_SIZE 1024
+#define FILE_HASH_SIZE 1024
+#define FILE_REPORT_COUNT 20
+#define TIMER_TICK_US 10000       // -d 与采样窗口切换的检查间隔
+#define MAX_STACK_DEPTH 64
+#define STACK_HASH_SIZE 4096
+#define MAPS_HASH_SIZE 256
+#define MAPS_REREAD_NS 1000000000ull    // 地址不在已知映射中时，至多每秒重读一次 maps
+#define TOP_STACK_COUNT 5
+#define TOP_STACK_FRAMES 6
+#define TRACE_BUFFER_RECORDS 8192   // 记录文件：每个缓冲区的记录数
+#define TRACE_BUFFER_COUNT 4        // 写线程与跟踪循环之间轮转的缓冲区数
+#define REPORT_MAX_THREADS 16       // sperf report 的最大解析线程数
+
+/**
+ * 对数-线性（HDR 风格）延迟直方图，单位纳秒
+ * [0, 2^SUB_BITS) 每纳秒一个桶；之后每个 [2^e, 2^(e+1)) 区间等分为 2^SUB_BITS 个桶，
+ * 相对误差不超过 1/2^SUB_BITS（约 6%），覆盖到 2^HIST_MAX_EXP ns（约 18 分钟），更大的值落入最后一个桶
+ */
+#define HIST_SUB_BITS  4
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_MAX_EXP   40
+#define HIST_BUCKETS   ((HIST_MAX_EXP - HIST_SUB_BITS + 2) * HIST_SUB_COUNT)
+
+// 系统调用停止点类型
+#define SYSCALL_STOP_UNKNOWN 0
+#define SYSCALL_STOP_ENTRY   1
+#define SYSCALL_STOP_EXIT    2
+
+// I/O 系统调用的方向
+#define IO_NONE  0
+#define IO_READ  1
+#define IO_WRITE 2
+
+// 百分位（报告列）
+enum { PCT_P50, PCT_P90, PCT_P99, PCT_P999, PCT_COUNT };
+static const double percentiles[PCT_COUNT] = { 50.0, 90.0, 99.0, 99.9 };
+
+// 排序依据
+typedef enum { SORT_TOTAL, SORT_COUNT, SORT_AVG, SORT_P99, SORT_MAX } sort_key_t;
 
 typedef struct {
     char name[64];
-    double total_time;
-    int count;
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t win_ns;                // 当前采样窗口内的时间
+    uint64_t sum_win_ns;            // 各完整窗口时间之和
+    double sumsq_win_ns;            // 各完整窗口时间的平方和
+    uint32_t hist[HIST_BUCKETS];
 } syscall_stat_t;
 
-syscall_stat_t syscalls[MAX_SYSCALLS];
-int syscall_count = 0;
-struct timeval program_start;
-double last_report_time = 0.0;
-int child_pid = -1;
+// 报告行：聚合数据的只读快照引用，附带报告时计算的百分位和排序键
+typedef struct {
+    const syscall_stat_t *st;
+    uint64_t pct_ns[PCT_COUNT];
+    double key;
+} report_row_t;
+
+// 单个任务内按系统调用号的计数
+typedef struct {
+    uint64_t count;
+    uint64_t total_ns;
+} task_syscall_t;
+
+// 被跟踪任务（线程）的状态（入口时记录，出口时结算）与按任务的统计
+typedef struct trace_task {
+    pid_t pid;                  // TID
+    pid_t tgid;                 // 所属进程
+    pid_t ppid;                 // 所属进程的父进程，用于进程树归属
+    char comm[16];
+    int attached;               // 已收到首次停止（自动附加的新任务先报告一次 SIGSTOP）
+    int exited;                 // 已退出或已分离，不再跟踪
+    int detached;
+    int exit_status;            // 退出时的 wait 状态
+    int in_syscall;             // 是否处于入口与出口之间
+    long nr;                    // 当前系统调用号
+    uint64_t entry_ns;          // 入口时间戳（CLOCK_MONOTONIC）
+    uint64_t args[6];           // 入口参数，出口时解码 I/O
+    uint64_t count;
+    uint64_t total_ns;
+    task_syscall_t *per_nr;     // 按系统调用号索引，长度 NUM_SYSCALL_NAMES
+    struct stack_stat *stack;   // -g：入口处捕获的调用栈，出口时结算
+    struct trace_task *hnext;   // TID 哈希链
+} trace_task_t;
+
+// 按文件（/proc/PID/fd 链接目标，如路径、socket:[inode]、pipe:[inode]）的 I/O 统计
+typedef struct file_stat {
+    char path[256];
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t total_ns;
+    struct file_stat *hnext;
+} file_stat_t;
+
+// (进程, fd) -> 文件 的解析缓存，close 时失效
+typedef struct fd_entry {
+    pid_t tgid;
+    int fd;
+    file_stat_t *file;
+    struct fd_entry *hnext;
+} fd_entry_t;
+
+// 调用栈中的一帧：模块（可执行映射对应的文件）内的文件偏移，与 ASLR 无关；module 为 -1 时 offset 为原始地址
+typedef struct {
+    int module;
+    uint64_t offset;
+} stack_frame_t;
+
+// 按 (进程名, 系统调用, 调用栈) 聚合的时间
+typedef struct stack_stat {
+    char comm[16];
+    long nr;
+    int depth;
+    uint64_t count;
+    uint64_t total_ns;
+    struct stack_stat *hnext;
+    stack_frame_t frames[];     // frames[0] 为最内层（系统调用所在处）
+} stack_stat_t;
+
+// 进程的可执行映射（/proc/PID/maps 中带 x 权限的行），按地址升序
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    uint64_t offset;
+    int module;
+} map_entry_t;
+
+typedef struct proc_maps {
+    pid_t tgid;
+    int count;
+    map_entry_t *entries;
+    uint64_t read_ns;
+    struct proc_maps *hnext;
+} proc_maps_t;
+
+// 模块（ELF 文件）及其符号表，符号表在输出报告时才加载
+typedef struct {
+    uint64_t addr;
+    uint64_t size;
+    const char *name;
+} elf_sym_t;
+
+typedef struct {
+    char *path;
+    int loaded;
+    elf_sym_t *syms;            // 按地址升序
+    int sym_count;
+    int load_count;
+    uint64_t load_offset[16];   // PT_LOAD 段：文件偏移 -> 虚拟地址
+    uint64_t load_vaddr[16];
+    uint64_t load_size[16];
+} module_t;
+
+/**
+ * 记录文件（-o）：64 字节文件头 + 定长记录，定长便于 sperf report 按记录边界切块并行解析
+ * 系统调用记录在出口时写入；任务记录在任务出现和 exec 后写入（同一 TID 以最新一条为准）
+ */
+#define TRACE_MAGIC "SPERFTR1"
+#define TRACE_VERSION 1
+#define TRACE_REC_SYSCALL 1
+#define TRACE_REC_TASK    2
+
+// 记录时的架构（ELF e_machine），系统调用号只在同一架构上有意义
+#if defined(__x86_64__)
+#define TRACE_MACHINE EM_X86_64
+#elif defined(__aarch64__)
+#define TRACE_MACHINE EM_AARCH64
+#else
+#define TRACE_MACHINE EM_NONE
+#endif
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t machine;           // 记录时的 ELF e_machine，系统调用号与架构相关
+    uint32_t reserved0;
+    uint64_t start_realtime_ns; // 跟踪开始的墙上时间
+    uint8_t reserved[32];
+} trace_header_t;
+
+typedef struct {
+    uint32_t type;
+    int32_t tid;
+    int32_t tgid;
+    int32_t nr;                 // 系统调用号；任务记录中为父进程号
+    uint64_t ts_ns;             // 相对跟踪开始的时间（系统调用为入口时间）
+    union {
+        struct {
+            uint64_t dur_ns;
+            int64_t ret;
+        } sys;
+        char comm[16];
+    };
+} trace_record_t;
+
+_Static_assert(sizeof(trace_header_t) == 64, "trace header must be 64 bytes");
+_Static_assert(sizeof(trace_record_t) == 40, "trace record must be 40 bytes");
+
+// 带缓冲的写线程：跟踪循环填满一个缓冲区后交给写线程，自己接着填下一个
+typedef struct {
+    FILE *fp;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    trace_record_t *buffers[TRACE_BUFFER_COUNT];
+    int lengths[TRACE_BUFFER_COUNT];
+    uint64_t produced;          // 已提交的缓冲区数（跟踪循环）
+    uint64_t consumed;          // 已写完的缓冲区数（写线程）
+    int used;                   // 当前缓冲区已用记录数
+    int closing;
+    int error;
+} trace_writer_t;
+
+// 进程级汇总（报告时由任务表生成）
+typedef struct {
+    pid_t tgid;
+    pid_t ppid;
+    char comm[16];
+    int threads;
+    uint64_t count;
+    uint64_t self_ns;           // 本进程各线程的系统调用时间
+    uint64_t incl_ns;           // 含全部后代进程
+} proc_summary_t;
+
+// 系统调用统计：下标即系统调用号，syscalls[MAX_SYSCALLS] 收集超出范围的号
+// active_syscalls 按首次出现顺序记录用到的下标，报告时只遍历这些
+syscall_stat_t syscalls[MAX_SYSCALLS + 1];
+int active_syscalls[MAX_SYSCALLS + 1];
+int syscall_count = 0;
+double last_report_time = 0.0;
+int child_pid = -1;
+int use_syscall_info = 1;       // 内核支持 PTRACE_GET_SYSCALL_INFO（5.3+）
+sort_key_t sort_key = SORT_TOTAL;
+int follow_forks = 0;           // -f：跟踪 fork/vfork/clone 出的子进程和线程
+int attach_mode = 0;            // -p：附加到已运行的进程，结束时分离而不是结束进程
+pid_t attach_pids[MAX_ATTACH_PIDS];
+int attach_count = 0;
+volatile sig_atomic_t stop_requested = 0;   // Ctrl+C 或 -d 到时
+uint64_t trace_start_ns = 0;
+uint64_t duration_ns = 0;       // -d，0 表示不限时
+
+// 采样模式（-S WINDOW/PERIOD）：每个周期只在开头的窗口内跟踪系统调用，其余时间任务以 PTRACE_CONT 运行
+uint64_t sample_window_ns = 0;
+uint64_t sample_period_ns = 0;  // 0 表示不采样
+int sampling_on = 1;            // 当前是否在采样窗口内
+uint64_t window_start_ns = 0;
+uint64_t next_switch_ns = 0;
+uint64_t sampled_ns = 0;        // 已结束窗口的总时长
+int window_count = 0;           // 已结束的窗口数
+
+// 任务表：全部任务（含已退出）按出现顺序保存，存活任务另挂在 TID 哈希表上
+trace_task_t **tasks = NULL;
+int task_count = 0;
+int task_capacity = 0;
+trace_task_t *task_hash[TASK_HASH_SIZE];
+
+// 文件 I/O 统计：文件按出现顺序保存，另有按路径和按 (进程, fd) 的哈希表
+file_stat_t **files = NULL;
+int file_count = 0;
+int file_capacity = 0;
+file_stat_t *file_hash[FILE_HASH_SIZE];
+fd_entry_t *fd_hash[FD_HASH_SIZE];
+
+// -o：记录文件；--stats：按时间间隔输出的 NDJSON 统计流
+trace_writer_t *trace_writer = NULL;
+FILE *stats_fp = NULL;
+uint64_t stats_interval_ns = 1000000000ull;
+uint64_t next_stats_ns = 0;
+uint64_t last_stats_ns = 0;
+uint64_t stats_prev_count[MAX_SYSCALLS + 1];
+uint64_t stats_prev_ns[MAX_SYSCALLS + 1];
+uint64_t stats_prev_traced_ns = 0;
+
+// -g：调用栈聚合、各进程的可执行映射和模块表
+const char *stack_output = NULL;        // 折叠栈输出文件
+stack_stat_t **stacks = NULL;
+int stack_count = 0;
+int stack_capacity = 0;
+stack_stat_t *stack_hash[STACK_HASH_SIZE];
+proc_maps_t *maps_hash[MAPS_HASH_SIZE];
+module_t *modules = NULL;
+int module_count = 0;
+int module_capacity = 0;
+
+// 信号处理函数
+static void signal_handler(int signo) {
+    if(signo == SIGINT || signo == SIGTERM) {
+        stop_requested = 1;
+        if(child_pid > 0) {
+            kill(child_pid, SIGTERM);
+        }
+    }
+}
+
+// 获取单调时钟时间（秒）
+static double get_current_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+// 获取单调时钟时间（纳秒）
+static uint64_t get_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 延迟 -> 直方图桶编号
+static int hist_bucket(uint64_t ns) {
+    if(ns < HIST_SUB_COUNT) return (int)ns;
+
+    int exp = 63 - __builtin_clzll(ns);
+    if(exp > HIST_MAX_EXP) return HIST_BUCKETS - 1;
+
+    int sub = (int)((ns >> (exp - HIST_SUB_BITS)) & (HIST_SUB_COUNT - 1));
+    return (exp - HIST_SUB_BITS + 1) * HIST_SUB_COUNT + sub;
+}
+
+// 桶的下界（纳秒）
+static uint64_t hist_bucket_low(int b) {
+    if(b < HIST_SUB_COUNT) return (uint64_t)b;
+
+    int exp = b / HIST_SUB_COUNT + HIST_SUB_BITS - 1;
+    int sub = b % HIST_SUB_COUNT;
+    return (uint64_t)(HIST_SUB_COUNT + sub) << (exp - HIST_SUB_BITS);
+}
+
+// 百分位：所在桶的上界，并限制在 [min, max] 内
+static uint64_t hist_percentile(const syscall_stat_t *st, double pct) {
+    if(st->count == 0) return 0;
+
+    uint64_t rank = (uint64_t)(pct / 100.0 * (double)st->count + 0.5);
+    if(rank < 1) rank = 1;
+    if(rank > st->count) rank = st->count;
+
+    uint64_t seen = 0;
+    for(int b = 0; b < HIST_BUCKETS; b ++) {
+        seen += st->hist[b];
+        if(seen >= rank) {
+            uint64_t high = (b + 1 < HIST_BUCKETS) ? hist_bucket_low(b + 1) - 1 : st->max_ns;
+            if(high > st->max_ns) high = st->max_ns;
+            if(high < st->min_ns) high = st->min_ns;
+            return high;
+        }
+    }
+    return st->max_ns;
+}
+
+// 系统调用号 -> 名字（生成的表中没有的号返回 NULL）
+static const char *syscall_name(long nr) {
+    if(nr < 0 || (unsigned long)nr >= NUM_SYSCALL_NAMES) return NULL;
+    return syscall_names[nr];
+}
+
+/**
+ * 读取系统调用停止点的信息
+ * 优先使用 PTRACE_GET_SYSCALL_INFO（与架构无关，能区分入口/出口），
+ * 老内核不支持时在 x86_64 上退化为读寄存器，按任务的入口/出口状态交替判断
+ *
+ * 返回 SYSCALL_STOP_ENTRY（填写 nr 和 task->args）、SYSCALL_STOP_EXIT（填写 ret）或 SYSCALL_STOP_UNKNOWN
+ */
+static int get_syscall_stop(trace_task_t *task, long *nr, long *ret) {
+    if(use_syscall_info) {
+        struct __ptrace_syscall_info info;
+        if(ptrace(PTRACE_GET_SYSCALL_INFO, task->pid, (void *)sizeof(info), &info) > 0) {
+            if(info.op == PTRACE_SYSCALL_INFO_ENTRY) {
+                *nr = (long)info.entry.nr;
+                memcpy(task->args, info.entry.args, sizeof(task->args));
+                return SYSCALL_STOP_ENTRY;
+            }
+            if(info.op == PTRACE_SYSCALL_INFO_EXIT) {
+                *ret = (long)info.exit.rval;
+                return SYSCALL_STOP_EXIT;
+            }
+            return SYSCALL_STOP_UNKNOWN;
+        }
+        if(errno != EIO) return SYSCALL_STOP_UNKNOWN;
+        use_syscall_info = 0;
+    }
+
+#ifdef __x86_64__
+    struct user_regs_struct regs;
+    if(ptrace(PTRACE_GETREGS, task->pid, NULL, &regs) == -1) return SYSCALL_STOP_UNKNOWN;
+    if(!task->in_syscall) {
+        *nr = (long)regs.orig_rax;
+        task->args[0] = regs.rdi;
+        task->args[1] = regs.rsi;
+        task->args[2] = regs.rdx;
+        task->args[3] = regs.r10;
+        task->args[4] = regs.r8;
+        task->args[5] = regs.r9;
+        return SYSCALL_STOP_ENTRY;
+    }
+    *ret = (long)regs.rax;
+    return SYSCALL_STOP_EXIT;
+#else
+    return SYSCALL_STOP_UNKNOWN;
+#endif
+}
+
+static void *trace_writer_main(void *arg) {
+    trace_writer_t *w = arg;
+
+    pthread_mutex_lock(&w->lock);
+    while(1) {
+        while(w->consumed == w->produced && !w->closing) pthread_cond_wait(&w->not_empty, &w->lock);
+        if(w->consumed == w->produced) break;
+
+        int index = (int)(w->consumed % TRACE_BUFFER_COUNT);
+        pthread_mutex_unlock(&w->lock);
+        size_t n = (size_t)w->lengths[index];
+        if(!w->error && fwrite(w->buffers[index], sizeof(trace_record_t), n, w->fp) != n) w->error = errno;
+        pthread_mutex_lock(&w->lock);
+
+        w->consumed ++;
+        pthread_cond_signal(&w->not_full);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+// 创建记录文件并写入文件头，启动写线程
+static trace_writer_t *trace_writer_open(const char *path) {
+    trace_writer_t *w = calloc(1, sizeof(*w));
+    if(!w) return NULL;
+    w->fp = fopen(path, "wb");
+    if(!w->fp) {
+        fprintf(stderr, "Cannot create %s: %s\n", path, strerror(errno));
+        free(w);
+        return NULL;
+    }
+
+    trace_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(trace_record_t);
+    header.machine = TRACE_MACHINE;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    header.start_realtime_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+
+    int ok = fwrite(&header, sizeof(header), 1, w->fp) == 1;
+    for(int i = 0; ok && i < TRACE_BUFFER_COUNT; i ++) {
+        w->buffers[i] = malloc(TRACE_BUFFER_RECORDS * sizeof(trace_record_t));
+        if(!w->buffers[i]) ok = 0;
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->not_empty, NULL);
+    pthread_cond_init(&w->not_full, NULL);
+    if(!ok || pthread_create(&w->thread, NULL, trace_writer_main, w) != 0) {
+        fprintf(stderr, "Cannot start trace writer for %s\n", path);
+        for(int i = 0; i < TRACE_BUFFER_COUNT; i ++) free(w->buffers[i]);
+        fclose(w->fp);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+// 提交当前缓冲区；写线程落后时（所有缓冲区都在排队）阻塞，保证不丢记录
+static void trace_writer_submit(trace_writer_t *w) {
+    if(w->used == 0) return;
+
+    pthread_mutex_lock(&w->lock);
+    w->lengths[w->produced % TRACE_BUFFER_COUNT] = w->used;
+    w->produced ++;
+    pthread_cond_signal(&w->not_empty);
+    while(w->produced - w->consumed >= TRACE_BUFFER_COUNT) pthread_cond_wait(&w->not_full, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+    w->used = 0;
+}
+
+// 取下一条记录的位置（当前缓冲区满时先提交）
+static trace_record_t *trace_writer_next(trace_writer_t *w) {
+    if(w->used == TRACE_BUFFER_RECORDS) trace_writer_submit(w);
+    trace_record_t *rec = &w->buffers[w->produced % TRACE_BUFFER_COUNT][w->used ++];
+    memset(rec, 0, sizeof(*rec));
+    return rec;
+}
+
+// 写出剩余记录并关闭文件；返回 0 或写入时的 errno
+static int trace_writer_close(trace_writer_t *w) {
+    trace_writer_submit(w);
+
+    pthread_mutex_lock(&w->lock);
+    w->closing = 1;
+    pthread_cond_signal(&w->not_empty);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    int error = w->error;
+    if(fclose(w->fp) != 0 && !error) error = errno;
+    for(int i = 0; i < TRACE_BUFFER_COUNT; i ++) free(w->buffers[i]);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->not_empty);
+    pthread_cond_destroy(&w->not_full);
+    free(w);
+    return error;
+}
+
+static void record_task_info(const trace_task_t *task) {
+    if(!trace_writer) return;
+    trace_record_t *rec = trace_writer_next(trace_writer);
+    rec->type = TRACE_REC_TASK;
+    rec->tid = task->pid;
+    rec->tgid = task->tgid;
+    rec->nr = task->ppid;
+    rec->ts_ns = get_time_ns() - trace_start_ns;
+    memcpy(rec->comm, task->comm, sizeof(rec->comm));
+}
+
+static void record_syscall_event(const trace_task_t *task, long nr, long ret, uint64_t elapsed_ns) {
+    trace_record_t *rec = trace_writer_next(trace_writer);
+    rec->type = TRACE_REC_SYSCALL;
+    rec->tid = task->pid;
+    rec->tgid = task->tgid;
+    rec->nr = (int32_t)nr;
+    rec->ts_ns = task->entry_ns - trace_start_ns;
+    rec->sys.dur_ns = elapsed_ns;
+    rec->sys.ret = ret;
+}
+
+// 从 /proc/TID/status 读取名字、所属进程，with_ppid 时也读父进程
+// （父进程可能已退出，/proc 中的 PPid 会变成收养者，因此新任务的父进程以 fork/clone 事件为准）
+static void read_task_info(trace_task_t *task, int with_ppid) {
+    char path[64], line[256];
+    snprintf(path, sizeof(path), "/proc/%d/status", task->pid);
+    FILE *fp = fopen(path, "r");
+    if(!fp) return;
+
+    while(fgets(line, sizeof(line), fp)) {
+        if(strncmp(line, "Name:", 5) == 0) {
+            sscanf(line + 5, " %15[^\n]", task->comm);
+        } else if(strncmp(line, "Tgid:", 5) == 0) {
+            task->tgid = atoi(line + 5);
+        } else if(strncmp(line, "PPid:", 5) == 0) {
+            if(with_ppid) task->ppid = atoi(line + 5);
+            break;                          // PPid 在 Name、Tgid 之后
+        }
+    }
+    fclose(fp);
+}
+
+static trace_task_t *find_task(pid_t pid) {
+    for(trace_task_t *t = task_hash[(unsigned)pid % TASK_HASH_SIZE]; t; t = t->hnext) {
+        if(t->pid == pid) return t;
+    }
+    return NULL;
+}
+
+// 分配任务并加入任务表（不读 /proc）
+static trace_task_t *alloc_task(pid_t pid) {
+    if(task_count == task_capacity) {
+        int capacity = task_capacity ? task_capacity * 2 : 64;
+        trace_task_t **grown = realloc(tasks, capacity * sizeof(*tasks));
+        if(!grown) return NULL;
+        tasks = grown;
+        task_capacity = capacity;
+    }
+
+    trace_task_t *task = calloc(1, sizeof(*task));
+    if(!task) return NULL;
+    task->per_nr = calloc(NUM_SYSCALL_NAMES, sizeof(task_syscall_t));
+    if(!task->per_nr) {
+        free(task);
+        return NULL;
+    }
+    task->pid = pid;
+    task->tgid = pid;
+    task->nr = -1;
+
+    unsigned h = (unsigned)pid % TASK_HASH_SIZE;
+    task->hnext = task_hash[h];
+    task_hash[h] = task;
+    tasks[task_count ++] = task;
+    return task;
+}
+
+// 新建被跟踪任务；attached 表示该任务的初始停止已经处理过
+static trace_task_t *add_task(pid_t pid, int attached) {
+    trace_task_t *task = alloc_task(pid);
+    if(!task) return NULL;
+    task->attached = attached;
+    read_task_info(task, 1);
+    record_task_info(task);
+    return task;
+}
+
+// 任务退出：从哈希表摘除（TID 之后可能被复用），统计仍保留在任务表中
+static void remove_task(trace_task_t *task) {
+    trace_task_t **pp = &task_hash[(unsigned)task->pid % TASK_HASH_SIZE];
+    while(*pp && *pp != task) pp = &(*pp)->hnext;
+    if(*pp) *pp = task->hnext;
+
+    task->hnext = NULL;
+    task->exited = 1;
+    task->in_syscall = 0;
+}
+
+// I/O 系统调用的方向；这些调用的 fd 都是第一个参数，成功时返回传输的字节数
+static int io_direction(long nr) {
+    switch(nr) {
+    case SYS_read:
+    case SYS_pread64:
+    case SYS_readv:
+    case SYS_preadv:
+#ifdef SYS_preadv2
+    case SYS_preadv2:
+#endif
+    case SYS_recvfrom:
+    case SYS_recvmsg:
+        return IO_READ;
+    case SYS_write:
+    case SYS_pwrite64:
+    case SYS_writev:
+    case SYS_pwritev:
+#ifdef SYS_pwritev2
+    case SYS_pwritev2:
+#endif
+    case SYS_sendto:
+    case SYS_sendmsg:
+    case SYS_sendfile:                      // 计入输出 fd
+        return IO_WRITE;
+    default:
+        return IO_NONE;
+    }
+}
+
+static unsigned hash_string(const char *str) {
+    unsigned h = 5381;
+    while(*str) h = h * 33 + (unsigned char)*str ++;
+    return h;
+}
+
+static file_stat_t *find_or_create_file(const char *path) {
+    unsigned h = hash_string(path) % FILE_HASH_SIZE;
+    for(file_stat_t *f = file_hash[h]; f; f = f->hnext) {
+        if(strcmp(f->path, path) == 0) return f;
+    }
+
+    if(file_count == file_capacity) {
+        int capacity = file_capacity ? file_capacity * 2 : 64;
+        file_stat_t **grown = realloc(files, capacity * sizeof(*files));
+        if(!grown) return NULL;
+        files = grown;
+        file_capacity = capacity;
+    }
+    file_stat_t *file = calloc(1, sizeof(*file));
+    if(!file) return NULL;
+    snprintf(file->path, sizeof(file->path), "%s", path);
+
+    file->hnext = file_hash[h];
+    file_hash[h] = file;
+    files[file_count ++] = file;
+    return file;
+}
+
+static unsigned fd_hash_index(pid_t tgid, int fd) {
+    return ((unsigned)tgid * 31u + (unsigned)fd) % FD_HASH_SIZE;
+}
+
+/**
+ * fd -> 文件统计：先查缓存，未命中时 readlink /proc/TGID/fd/FD（被跟踪任务此时停着，fd 一定有效）
+ * 同一进程的线程共享 fd 表，因此按 tgid 缓存
+ */
+static file_stat_t *resolve_fd(pid_t tgid, int fd) {
+    unsigned h = fd_hash_index(tgid, fd);
+    for(fd_entry_t *e = fd_hash[h]; e; e = e->hnext) {
+        if(e->tgid == tgid && e->fd == fd) return e->file;
+    }
+
+    char link[64], path[256];
+    snprintf(link, sizeof(link), "/proc/%d/fd/%d", tgid, fd);
+    ssize_t len = readlink(link, path, sizeof(path) - 1);
+    if(len < 0) snprintf(path, sizeof(path), "fd %d (unknown)", fd);
+    else path[len] = '\0';
+
+    fd_entry_t *e = malloc(sizeof(*e));
+    if(!e) return NULL;
+    e->tgid = tgid;
+    e->fd = fd;
+    e->file = find_or_create_file(path);
+    e->hnext = fd_hash[h];
+    fd_hash[h] = e;
+    return e->file;
+}
+
+// 使缓存失效：fd 范围 [first, last]，fd 号之后可能指向别的文件
+static void forget_fds(pid_t tgid, int first, int last) {
+    if(first == last) {
+        fd_entry_t **pp = &fd_hash[fd_hash_index(tgid, first)];
+        while(*pp) {
+            fd_entry_t *e = *pp;
+            if(e->tgid == tgid && e->fd == first) {
+                *pp = e->hnext;
+                free(e);
+                return;
+            }
+            pp = &e->hnext;
+        }
+        return;
+    }
+
+    for(int h = 0; h < FD_HASH_SIZE; h ++) {
+        fd_entry_t **pp = &fd_hash[h];
+        while(*pp) {
+            fd_entry_t *e = *pp;
+            if(e->tgid == tgid && e->fd >= first && e->fd <= last) {
+                *pp = e->hnext;
+                free(e);
+            } else {
+                pp = &e->hnext;
+            }
+        }
+    }
+}
+
+// 进程 exec（关闭 CLOEXEC 的 fd）或退出（进程号可能被复用）时丢弃其全部缓存
+static void forget_process_fds(pid_t tgid) {
+    forget_fds(tgid, 0, INT32_MAX);
+}
+
+// 采样窗口之间看不到 close，窗口打开时整体丢弃缓存
+static void forget_all_fds() {
+    for(int h = 0; h < FD_HASH_SIZE; h ++) {
+        while(fd_hash[h]) {
+            fd_entry_t *e = fd_hash[h];
+            fd_hash[h] = e->hnext;
+            free(e);
+        }
+    }
+}
+
+/**
+ * 系统调用出口的 fd 记账：I/O 调用计入对应文件；关闭或被覆盖的 fd 使缓存失效
+ * 新 fd 只能复用已关闭的号，因此只需在 close / dup2 / dup3 / close_range 时失效，首次 I/O 时再解析
+ */
+static void account_fd(trace_task_t *task, long nr, long ret, uint64_t elapsed_ns) {
+    int direction = io_direction(nr);
+    if(direction != IO_NONE) {
+        int fd = (int)task->args[0];
+        file_stat_t *file = (fd >= 0) ? resolve_fd(task->tgid, fd) : NULL;
+        if(!file) return;
+        uint64_t bytes = (ret > 0) ? (uint64_t)ret : 0;
+        if(direction == IO_READ) {
+            file->reads ++;
+            file->read_bytes += bytes;
+        } else {
+            file->writes ++;
+            file->write_bytes += bytes;
+        }
+        file->total_ns += elapsed_ns;
+        return;
+    }
+
+    switch(nr) {
+    case SYS_close:
+        forget_fds(task->tgid, (int)task->args[0], (int)task->args[0]);
+        break;
+#ifdef SYS_dup2
+    case SYS_dup2:
+#endif
+    case SYS_dup3:
+        if(ret >= 0) forget_fds(task->tgid, (int)ret, (int)ret);
+        break;
+#ifdef SYS_close_range
+    case SYS_close_range: {
+        uint64_t last = task->args[1] > INT32_MAX ? INT32_MAX : task->args[1];
+        forget_fds(task->tgid, (int)task->args[0], (int)last);
+        break;
+    }
+#endif
+    default:
+        break;
+    }
+}
+
+static int intern_module(const char *path) {
+    for(int i = 0; i < module_count; i ++) {
+        if(strcmp(modules[i].path, path) == 0) return i;
+    }
+    if(module_count == module_capacity) {
+        int capacity = module_capacity ? module_capacity * 2 : 32;
+        module_t *grown = realloc(modules, capacity * sizeof(*modules));
+        if(!grown) return -1;
+        modules = grown;
+        module_capacity = capacity;
+    }
+    module_t *m = &modules[module_count];
+    memset(m, 0, sizeof(*m));
+    m->path = strdup(path);
+    if(!m->path) return -1;
+    return module_count ++;
+}
+
+// 读取 /proc/TGID/maps 中的可执行映射
+static int read_proc_maps(proc_maps_t *maps) {
+    char path[64], line[4352];
+    snprintf(path, sizeof(path), "/proc/%d/maps", maps->tgid);
+    FILE *fp = fopen(path, "r");
+    if(!fp) return -1;
+
+    int capacity = 0;
+    maps->count = 0;
+    while(fgets(line, sizeof(line), fp)) {
+        unsigned long start, end, offset;
+        char perms[8];
+        int name_pos = 0;
+        if(sscanf(line, "%lx-%lx %7s %lx %*s %*s %n", &start, &end, perms, &offset, &name_pos) < 4) continue;
+        if(perms[2] != 'x') continue;
+
+        char *name = line + name_pos;
+        name[strcspn(name, "\n")] = '\0';
+        if(name_pos == 0 || *name == '\0') name = "[anon]";
+
+        if(maps->count == capacity) {
+            capacity = capacity ? capacity * 2 : 32;
+            map_entry_t *grown = realloc(maps->entries, capacity * sizeof(*grown));
+            if(!grown) break;
+            maps->entries = grown;
+        }
+        map_entry_t *e = &maps->entries[maps->count ++];
+        e->start = start;
+        e->end = end;
+        e->offset = offset;
+        e->module = intern_module(name);
+    }
+    fclose(fp);
+    maps->read_ns = get_time_ns();
+    return 0;
+}
+
+static proc_maps_t *get_proc_maps(pid_t tgid) {
+    unsigned h = (unsigned)tgid % MAPS_HASH_SIZE;
+    for(proc_maps_t *m = maps_hash[h]; m; m = m->hnext) {
+        if(m->tgid == tgid) return m;
+    }
+
+    proc_maps_t *maps = calloc(1, sizeof(*maps));
+    if(!maps) return NULL;
+    maps->tgid = tgid;
+    read_proc_maps(maps);
+    maps->hnext = maps_hash[h];
+    maps_hash[h] = maps;
+    return maps;
+}
+
+// exec 或退出时丢弃进程的映射快照
+static void forget_proc_maps(pid_t tgid) {
+    proc_maps_t **pp = &maps_hash[(unsigned)tgid % MAPS_HASH_SIZE];
+    while(*pp) {
+        proc_maps_t *m = *pp;
+        if(m->tgid == tgid) {
+            *pp = m->hnext;
+            free(m->entries);
+            free(m);
+            return;
+        }
+        pp = &m->hnext;
+    }
+}
+
+// 新映射了可执行代码（加载器、dlopen）：下次地址未命中时立即重读，不受限频约束
+static void invalidate_proc_maps(pid_t tgid) {
+    for(proc_maps_t *m = maps_hash[(unsigned)tgid % MAPS_HASH_SIZE]; m; m = m->hnext) {
+        if(m->tgid == tgid) m->read_ns = 0;
+    }
+}
+
+static const map_entry_t *find_mapping(const proc_maps_t *maps, uint64_t addr) {
+    int lo = 0, hi = maps->count - 1;
+    while(lo <= hi) {
+        int mid = (lo + hi) / 2;
+        const map_entry_t *e = &maps->entries[mid];
+        if(addr < e->start) hi = mid - 1;
+        else if(addr >= e->end) lo = mid + 1;
+        else return e;
+    }
+    return NULL;
+}
+
+// 地址 -> 映射；找不到时（可能是 dlopen 新加载的库）限频重读 maps
+static const map_entry_t *resolve_address(proc_maps_t *maps, uint64_t addr) {
+    const map_entry_t *e = find_mapping(maps, addr);
+    if(!e && get_time_ns() - maps->read_ns >= MAPS_REREAD_NS) {
+        read_proc_maps(maps);
+        e = find_mapping(maps, addr);
+    }
+    return e;
+}
+
+// 从被跟踪任务读内存：优先 process_vm_readv（一次系统调用），失败时退回逐字 PTRACE_PEEKDATA
+static int read_task_memory(pid_t pid, uint64_t addr, void *buf, size_t size) {
+    struct iovec local = { buf, size };
+    struct iovec remote = { (void *)addr, size };
+    if(process_vm_readv(pid, &local, 1, &remote, 1, 0) == (ssize_t)size) return 0;
+
+    for(size_t done = 0; done < size; done += sizeof(long)) {
+        errno = 0;
+        long word = ptrace(PTRACE_PEEKDATA, pid, (void *)(addr + done), NULL);
+        if(errno != 0) return -1;
+        memcpy((char *)buf + done, &word, sizeof(long));
+    }
+    return 0;
+}
+
+static unsigned hash_stack(const char *comm, long nr, const stack_frame_t *frames, int depth) {
+    uint64_t h = 1469598103934665603ull;    // FNV-1a
+    for(const char *c = comm; *c; c ++) h = (h ^ (unsigned char)*c) * 1099511628211ull;
+    h = (h ^ (uint64_t)nr) * 1099511628211ull;
+    for(int i = 0; i < depth; i ++) {
+        h = (h ^ (uint64_t)frames[i].module) * 1099511628211ull;
+        h = (h ^ frames[i].offset) * 1099511628211ull;
+    }
+    return (unsigned)(h % STACK_HASH_SIZE);
+}
+
+static stack_stat_t *find_or_create_stack(const char *comm, long nr, const stack_frame_t *frames, int depth) {
+    unsigned h = hash_stack(comm, nr, frames, depth);
+    for(stack_stat_t *st = stack_hash[h]; st; st = st->hnext) {
+        if(st->nr == nr && st->depth == depth && strcmp(st->comm, comm) == 0 &&
+           memcmp(st->frames, frames, depth * sizeof(stack_frame_t)) == 0) {
+            return st;
+        }
+    }
+
+    if(stack_count == stack_capacity) {
+        int capacity = stack_capacity ? stack_capacity * 2 : 256;
+        stack_stat_t **grown = realloc(stacks, capacity * sizeof(*stacks));
+        if(!grown) return NULL;
+        stacks = grown;
+        stack_capacity = capacity;
+    }
+    stack_stat_t *st = calloc(1, sizeof(*st) + depth * sizeof(stack_frame_t));
+    if(!st) return NULL;
+    memcpy(st->comm, comm, sizeof(st->comm));
+    st->nr = nr;
+    st->depth = depth;
+    memcpy(st->frames, frames, depth * sizeof(stack_frame_t));
+
+    st->hnext = stack_hash[h];
+    stack_hash[h] = st;
+    stacks[stack_count ++] = st;
+    return st;
+}
+
+/**
+ * 在系统调用入口按帧指针回溯用户态调用栈
+ * 第 0 帧为 rip；libc 的系统调用包装函数通常不建栈帧，[rsp] 若指向可执行映射就是直接调用者；
+ * 之后沿 rbp 链读取 (上一帧 rbp, 返回地址)，要求帧指针对齐且单调递增
+ * 返回地址减 1 再换算，使其落在 call 指令内；地址换算成 (模块, 文件偏移) 后按栈聚合
+ */
+static stack_stat_t *capture_stack(trace_task_t *task, long nr) {
+#ifdef __x86_64__
+    struct user_regs_struct regs;
+    if(ptrace(PTRACE_GETREGS, task->pid, NULL, &regs) == -1) return NULL;
+
+    proc_maps_t *maps = get_proc_maps(task->tgid);
+    if(!maps) return NULL;
+
+    uint64_t pcs[MAX_STACK_DEPTH];
+    int depth = 0;
+    resolve_address(maps, regs.rip);
+    pcs[depth ++] = regs.rip;
+
+    uint64_t word;
+    if(read_task_memory(task->pid, regs.rsp, &word, sizeof(word)) == 0 && resolve_address(maps, word)) {
+        pcs[depth ++] = word;
+    }
+
+    uint64_t fp = regs.rbp;
+    while(depth < MAX_STACK_DEPTH && fp >= regs.rsp && (fp & 7) == 0) {
+        uint64_t frame[2];              // [0] 上一帧 rbp，[1] 返回地址
+        if(read_task_memory(task->pid, fp, frame, sizeof(frame)) != 0) break;
+        if(!resolve_address(maps, frame[1])) break;
+        pcs[depth ++] = frame[1];
+        if(frame[0] <= fp) break;
+        fp = frame[0];
+    }
+
+    stack_frame_t frames[MAX_STACK_DEPTH];
+    for(int i = 0; i < depth; i ++) {
+        uint64_t pc = (i == 0) ? pcs[i] : pcs[i] - 1;
+        const map_entry_t *e = find_mapping(maps, pc);
+        if(e) {
+            frames[i].module = e->module;
+            frames[i].offset = pc - e->start + e->offset;
+        } else {
+            frames[i].module = -1;
+            frames[i].offset = pc;
+        }
+    }
+    return find_or_create_stack(task->comm, nr, frames, depth);
+#else
+    (void)task;
+    (void)nr;
+    return NULL;
+#endif
+}
+
+_Static_assert(NUM_SYSCALL_NAMES <= MAX_SYSCALLS, "MAX_SYSCALLS too small for syscall_names");
+
+// 系统调用号 -> 统计槽位，O(1)；首次出现时登记名字
+static syscall_stat_t *get_syscall_stat(long nr) {
+    int index = (nr >= 0 && nr < MAX_SYSCALLS) ? (int)nr : MAX_SYSCALLS;
+    syscall_stat_t *st = &syscalls[index];
+    if(st->name[0] == '\0') {
+        const char *name = syscall_name(nr);
+        if(index == MAX_SYSCALLS) snprintf(st->name, sizeof(st->name), "syscall_other");
+        else if(name) snprintf(st->name, sizeof(st->name), "%s", name);
+        else snprintf(st->name, sizeof(st->name), "syscall_%ld", nr);
+        st->min_ns = UINT64_MAX;
+        active_syscalls[syscall_count ++] = index;
+    }
+    return st;
+}
+
+// 排序键的取值（降序排列）
+static double sort_value(const report_row_t *row) {
+    const syscall_stat_t *st = row->st;
+    switch(sort_key) {
+    case SORT_COUNT: return (double)st->count;
+    case SORT_AVG:   return st->count ? (double)st->total_ns / st->count : 0.0;
+    case SORT_P99:   return (double)row->pct_ns[PCT_P99];
+    case SORT_MAX:   return (double)st->max_ns;
+    default:         return (double)st->total_ns;
+    }
+}
+
+static int compare_rows(const void *a, const void *b) {
+    double va = ((const report_row_t*)a)->key;
+    double vb = ((const report_row_t*)b)->key;
+
+    if(va > vb) return -1;
+    else if(va < vb) return 1;
+    else return 0;
+}
+
+/**
+ * 把排序键最大的 n 行按降序移到 rows 前部，其余行顺序不定
+ * 实时报告只显示前几项，用有界插入选择代替整表排序：O(count * n)
+ */
+static void select_top_rows(report_row_t *rows, int count, int n) {
+    if(n >= count) {
+        qsort(rows, count, sizeof(report_row_t), compare_rows);
+        return;
+    }
+
+    for(int i = 0; i < count; i ++) {
+        int pos;
+        if(i < n) {
+            pos = i;                        // 前 n 项做插入排序
+        } else if(rows[i].key > rows[n - 1].key) {
+            report_row_t evicted = rows[n - 1];     // 第 n 项被换到尾部
+            rows[n - 1] = rows[i];
+            rows[i] = evicted;
+            pos = n - 1;
+        } else {
+            continue;
+        }
+
+        report_row_t row = rows[pos];
+        while(pos > 0 && rows[pos - 1].key < row.key) {
+            rows[pos] = rows[pos - 1];
+            pos --;
+        }
+        rows[pos] = row;
+    }
+}
+
+static int parse_sort_key(const char *s, sort_key_t *key) {
+    if(strcmp(s, "total") == 0) *key = SORT_TOTAL;
+    else if(strcmp(s, "count") == 0) *key = SORT_COUNT;
+    else if(strcmp(s, "avg") == 0) *key = SORT_AVG;
+    else if(strcmp(s, "p99") == 0) *key = SORT_P99;
+    else if(strcmp(s, "max") == 0) *key = SORT_MAX;
+    else return -1;
+    return 0;
+}
+
+// 纳秒 -> 微秒
+static double us(uint64_t ns) {
+    return ns / 1000.0;
+}
+
+// 报告用：任务及其占用时间（已结算时间 + 正在阻塞的系统调用已耗时间）
+typedef struct {
+    const trace_task_t *task;
+    uint64_t busy_ns;
+} task_rank_t;
+
+static int compare_task_ranks(const void *a, const void *b) {
+    uint64_t va = ((const task_rank_t*)a)->busy_ns;
+    uint64_t vb = ((const task_rank_t*)b)->busy_ns;
+
+    if(va > vb) return -1;
+    else if(va < vb) return 1;
+    else return 0;
+}
+
+static const char *syscall_label(long nr, char *buf, size_t size) {
+    const char *name = syscall_name(nr);
+    if(name) return name;
+    snprintf(buf, size, "syscall_%ld", nr);
+    return buf;
+}
+
+// 任务中耗时最多的几个系统调用，如 "futex 1.204s, read 0.013s"
+static void format_top_syscalls(const trace_task_t *task, char *buf, size_t size) {
+    long top[TASK_TOP_SYSCALLS];
+    int n = 0;
+    for(long nr = 0; nr < (long)NUM_SYSCALL_NAMES; nr ++) {
+        if(task->per_nr[nr].count == 0 && task->per_nr[nr].total_ns == 0) continue;
+
+        int pos = n;
+        while(pos > 0 && task->per_nr[top[pos - 1]].total_ns < task->per_nr[nr].total_ns) pos --;
+        if(pos >= TASK_TOP_SYSCALLS) continue;
+        if(n < TASK_TOP_SYSCALLS) n ++;
+        for(int k = n - 1; k > pos; k --) top[k] = top[k - 1];
+        top[pos] = nr;
+    }
+
+    char fallback[32];
+    size_t len = 0;
+    buf[0] = '\0';
+    for(int k = 0; k < n && len < size; k ++) {
+        len += snprintf(buf + len, size - len, "%s%s %.3fs", k ? ", " : "",
+            syscall_label(top[k], fallback, sizeof(fallback)), task->per_nr[top[k]].total_ns / 1e9);
+    }
+}
+
+// 任务当前状态：阻塞在哪个系统调用、已阻塞多久
+static void format_task_state(const trace_task_t *task, uint64_t now_ns, char *buf, size_t size) {
+    char fallback[32];
+    if(task->detached) {
+        snprintf(buf, size, "detached");
+    } else if(task->exited) {
+        snprintf(buf, size, "exited");
+    } else if(task->in_syscall) {
+        snprintf(buf, size, "%s %.3fs", syscall_label(task->nr, fallback, sizeof(fallback)),
+            (now_ns - task->entry_ns) / 1e9);
+    } else if(!sampling_on) {
+        snprintf(buf, size, "untraced");    // 采样窗口之外
+    } else {
+        snprintf(buf, size, "user");
+    }
+}
+
+// 按线程输出：占用时间最多的线程在前，实时报告只显示前几项
+static void print_thread_report(int is_final, uint64_t total_ns) {
+    task_rank_t *ranks = malloc(task_count * sizeof(*ranks));
+    if(!ranks) return;
+
+    uint64_t now_ns = get_time_ns();
+    for(int i = 0; i < task_count; i ++) {
+        const trace_task_t *task = tasks[i];
+        ranks[i].task = task;
+        ranks[i].busy_ns = task->total_ns;
+        if(task->in_syscall && !task->exited) ranks[i].busy_ns += now_ns - task->entry_ns;
+    }
+    qsort(ranks, task_count, sizeof(task_rank_t), compare_task_ranks);
+
+    printf("%-8s %-8s %-16s %10s %12s %8s  %-24s %s\n",
+        "TID", "PID", "Comm", "Calls", "Time(s)", "Pct", "State", "Top syscalls");
+    printf("--------------------------------------------------------------------------------------------------------------------------\n");
+
+    int display_count = task_count;
+    if(!is_final && display_count > LIVE_TASK_COUNT) display_count = LIVE_TASK_COUNT;
+    for(int i = 0; i < display_count; i ++) {
+        const trace_task_t *task = ranks[i].task;
+        char state[64], top[256];
+        format_task_state(task, now_ns, state, sizeof(state));
+        format_top_syscalls(task, top, sizeof(top));
+        double percentage = (total_ns > 0) ? ((double)task->total_ns / total_ns * 100) : 0;
+        printf("%-8d %-8d %-16s %10llu %12.6f %7.2f%%  %-24s %s\n",
+            task->pid, task->tgid, task->comm,
+            (unsigned long long)task->count,
+            task->total_ns / 1e9,
+            percentage,
+            state, top);
+    }
+    printf("--------------------------------------------------------------------------------------------------------------------------\n");
+    free(ranks);
+}
+
+static int compare_proc_tgid(const void *a, const void *b) {
+    pid_t va = ((const proc_summary_t*)a)->tgid;
+    pid_t vb = ((const proc_summary_t*)b)->tgid;
+    return (va > vb) - (va < vb);
+}
+
+// 同一父进程的子进程相邻，组内按含后代时间降序
+static int compare_proc_children(const void *a, const void *b) {
+    const proc_summary_t *pa = *(proc_summary_t *const *)a;
+    const proc_summary_t *pb = *(proc_summary_t *const *)b;
+    if(pa->ppid != pb->ppid) return (pa->ppid > pb->ppid) - (pa->ppid < pb->ppid);
+    return (pa->incl_ns < pb->incl_ns) - (pa->incl_ns > pb->incl_ns);
+}
+
+static proc_summary_t *find_proc(proc_summary_t *procs, int nprocs, pid_t tgid) {
+    proc_summary_t key = { .tgid = tgid };
+    return bsearch(&key, procs, nprocs, sizeof(proc_summary_t), compare_proc_tgid);
+}
+
+static void print_proc_subtree(proc_summary_t **by_parent, int nprocs, const proc_summary_t *proc,
+                               int depth, uint64_t total_ns) {
+    char label[32];
+    snprintf(label, sizeof(label), "%*s%d", depth * 2, "", proc->tgid);
+    double percentage = (total_ns > 0) ? ((double)proc->incl_ns / total_ns * 100) : 0;
+    printf("%-16s %-8d %-16s %8d %10llu %12.6f %12.6f %7.2f%%\n",
+        label, proc->ppid, proc->comm, proc->threads,
+        (unsigned long long)proc->count,
+        proc->self_ns / 1e9,
+        proc->incl_ns / 1e9,
+        percentage);
+    if(depth >= MAX_TREE_DEPTH) return;
+
+    // 二分找到第一个子进程，子进程在 by_parent 中连续
+    int lo = 0, hi = nprocs;
+    while(lo < hi) {
+        int mid = (lo + hi) / 2;
+        if(by_parent[mid]->ppid < proc->tgid) lo = mid + 1;
+        else hi = mid;
+    }
+    for(int i = lo; i < nprocs && by_parent[i]->ppid == proc->tgid; i ++) {
+        if(by_parent[i] != proc) {
+            print_proc_subtree(by_parent, nprocs, by_parent[i], depth + 1, total_ns);
+        }
+    }
+}
+
+/**
+ * 按进程汇总并以进程树输出
+ * Self 为进程自身各线程的系统调用时间，Incl 另含全部后代进程，用于定位是哪个子进程花掉了时间
+ */
+static void print_process_report(uint64_t total_ns) {
+    proc_summary_t *procs = calloc(task_count, sizeof(*procs));
+    proc_summary_t **by_parent = calloc(task_count, sizeof(*by_parent));
+    if(!procs || !by_parent) {
+        free(procs);
+        free(by_parent);
+        return;
+    }
+
+    // 1. 按 tgid 归并线程
+    int nprocs = 0;
+    for(int i = 0; i < task_count; i ++) {
+        const trace_task_t *task = tasks[i];
+        proc_summary_t *proc = NULL;
+        for(int j = nprocs - 1; j >= 0 && !proc; j --) {
+            if(procs[j].tgid == task->tgid) proc = &procs[j];
+        }
+        if(!proc) {
+            proc = &procs[nprocs ++];
+            proc->tgid = task->tgid;
+            proc->ppid = task->ppid;
+            memcpy(proc->comm, task->comm, sizeof(proc->comm));
+        }
+        if(task->pid == task->tgid) {
+            proc->ppid = task->ppid;        // 以主线程为准
+            memcpy(proc->comm, task->comm, sizeof(proc->comm));
+        }
+        proc->threads ++;
+        proc->count += task->count;
+        proc->self_ns += task->total_ns;
+    }
+    if(nprocs < 2) {
+        free(procs);
+        free(by_parent);
+        return;
+    }
+
+    // 2. 自身时间沿祖先链向上累加
+    qsort(procs, nprocs, sizeof(proc_summary_t), compare_proc_tgid);
+    for(int i = 0; i < nprocs; i ++) procs[i].incl_ns += procs[i].self_ns;
+    for(int i = 0; i < nprocs; i ++) {
+        proc_summary_t *p = find_proc(procs, nprocs, procs[i].ppid);
+        for(int depth = 0; p && p != &procs[i] && depth < MAX_TREE_DEPTH; depth ++) {
+            p->incl_ns += procs[i].self_ns;
+            p = find_proc(procs, nprocs, p->ppid);
+        }
+    }
+
+    // 3. 从根（父进程不在跟踪范围内）开始深度优先输出
+    for(int i = 0; i < nprocs; i ++) by_parent[i] = &procs[i];
+    qsort(by_parent, nprocs, sizeof(*by_parent), compare_proc_children);
+
+    printf("%-16s %-8s %-16s %8s %10s %12s %12s %8s\n",
+        "PID", "PPID", "Comm", "Threads", "Calls", "Self(s)", "Incl(s)", "Pct");
+    printf("--------------------------------------------------------------------------------------------------------------------------\n");
+    for(int i = 0; i < nprocs; i ++) {
+        if(!find_proc(procs, nprocs, by_parent[i]->ppid)) {
+            print_proc_subtree(by_parent, nprocs, by_parent[i], 0, total_ns);
+        }
+    }
+    printf("--------------------------------------------------------------------------------------------------------------------------\n");
+
+    free(procs);
+    free(by_parent);
+}
+
+static int compare_files(const void *a, const void *b) {
+    uint64_t va = (*(file_stat_t *const *)a)->total_ns;
+    uint64_t vb = (*(file_stat_t *const *)b)->total_ns;
+
+    if(va > vb) return -1;
+    else if(va < vb) return 1;
+    else return 0;
+}
+
+/**
+ * 按文件输出 I/O：次数、字节数、平均每次 I/O 大小、系统调用内的时间与吞吐
+ * 平均大小很小而次数很多的文件通常缺少缓冲
+ */
+static void print_file_report() {
+    if(file_count == 0) return;
+
+    file_stat_t **order = malloc(file_count * sizeof(*order));
+    if(!order) return;
+    memcpy(order, files, file_count * sizeof(*order));
+    qsort(order, file_count, sizeof(*order), compare_files);
+
+    printf("%-40s %10s %10s %12s %12s %10s %12s %10s\n",
+        "File", "Reads", "Writes", "Read(B)", "Written(B)", "AvgIO(B)", "Time(s)", "MB/s");
+    printf("--------------------------------------------------------------------------------------------------------------------------\n");
+
+    int display_count = file_count < FILE_REPORT_COUNT ? file_count : FILE_REPORT_COUNT;
+    for(int i = 0; i < display_count; i ++) {
+        const file_stat_t *f = order[i];
+        uint64_t calls = f->reads + f->writes;
+        uint64_t bytes = f->read_bytes + f->write_bytes;
 
-// 信号处理函数
-static void signal_handler(int signo) {
-    if(signo == SIGINT || signo == SIGTERM) {
-        if(child_pid > 0) {
-            kill(child_pid, SIGTERM);
-        }
+        // 路径过长时保留末尾
+        size_t len = strlen(f->path);
+        const char *path = (len > 40) ? f->path + len - 40 : f->path;
+        printf("%-40s %10llu %10llu %12llu %12llu %10.1f %12.6f %10.2f\n",
+            path,
+            (unsigned long long)f->reads,
+            (unsigned long long)f->writes,
+            (unsigned long long)f->read_bytes,
+            (unsigned long long)f->write_bytes,
+            calls ? (double)bytes / calls : 0.0,
+            f->total_ns / 1e9,
+            f->total_ns ? (double)bytes / 1e6 / (f->total_ns / 1e9) : 0.0);
     }
+    if(file_count > display_count) {
+        printf("... %d more files\n", file_count - display_count);
+    }
+    printf("--------------------------------------------------------------------------------------------------------------------------\n");
+    free(order);
 }
 
-// 获取当前的系统时间
-static double get_current_time() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec + tv.tv_usec / 1000000.0;
+// 采样放大倍数：总时长 / 已采样时长（不采样时为 1）
+static double sample_scale(uint64_t now_ns) {
+    if(!sample_period_ns) return 1.0;
+    uint64_t traced_ns = sampled_ns + (sampling_on ? now_ns - window_start_ns : 0);
+    return traced_ns ? (double)(now_ns - trace_start_ns) / traced_ns : 1.0;
 }
 
-int parse_strace_line(const char* line, char *syscall_name, double *time) {
-    const char *paren = strchr(line, '(');
-    if(!paren) return 0;
+/**
+ * 时间估计的 95% 置信区间半宽（相对值，%），把每个完整窗口内的时间视为独立同分布的样本
+ * 结束时未满的最后一个窗口长度不同，不作为样本（其时间仍计入总量）；完整窗口不足 2 个时无法估计，返回 -1
+ */
+static double sample_ci95(const syscall_stat_t *st) {
+    if(window_count < 2) return -1.0;
 
-    const char *start = line;
-    while(*start == ' '|| *start == '\t') start ++;
+    double k = window_count;
+    double mean = (double)st->sum_win_ns / k;
+    if(mean <= 0.0) return -1.0;
+    double var = (st->sumsq_win_ns - k * mean * mean) / (k - 1);
+    if(var < 0.0) var = 0.0;
+    return 1.96 * sqrt(var / k) / mean * 100.0;
+}
 
-    int syscall_line = paren - start;
-    if(syscall_line <= 0 || syscall_line >= 64) return 0;
+static int compare_syms(const void *a, const void *b) {
+    uint64_t va = ((const elf_sym_t*)a)->addr;
+    uint64_t vb = ((const elf_sym_t*)b)->addr;
+    return (va > vb) - (va < vb);
+}
 
-    strncpy(syscall_name, start, syscall_line);
-    syscall_name[syscall_line] = '\0';
+/**
+ * 加载模块的 PT_LOAD 段和函数符号（优先 .symtab，没有时用 .dynsym），仅支持 64 位 ELF
+ * 文件保持映射，符号名直接指向映射内的字符串表
+ */
+static void load_module(module_t *m) {
+    m->loaded = 1;
+    if(m->path[0] != '/') return;           // [vdso]、[anon] 等
 
-    const char *time_start = strchr(line, '<');
-    const char *time_end = strchr(line, '>');
-    if(time_start && time_end && time_end > time_start) {
-        *time = atof(time_start + 1);
-        return 1;
+    int fd = open(m->path, O_RDONLY);
+    if(fd < 0) return;
+    struct stat sb;
+    if(fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(Elf64_Ehdr)) {
+        close(fd);
+        return;
     }
+    const unsigned char *base = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED) return;
 
-    return 0;
+    size_t size = sb.st_size;
+    const Elf64_Ehdr *eh = (const Elf64_Ehdr *)base;
+    if(memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 || eh->e_ident[EI_CLASS] != ELFCLASS64 ||
+       eh->e_phoff + (uint64_t)eh->e_phnum * sizeof(Elf64_Phdr) > size ||
+       eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Elf64_Shdr) > size) {
+        munmap((void *)base, size);
+        return;
+    }
+
+    const Elf64_Phdr *ph = (const Elf64_Phdr *)(base + eh->e_phoff);
+    for(int i = 0; i < eh->e_phnum && m->load_count < 16; i ++) {
+        if(ph[i].p_type != PT_LOAD) continue;
+        m->load_offset[m->load_count] = ph[i].p_offset;
+        m->load_vaddr[m->load_count] = ph[i].p_vaddr;
+        m->load_size[m->load_count] = ph[i].p_filesz;
+        m->load_count ++;
+    }
+
+    const Elf64_Shdr *sh = (const Elf64_Shdr *)(base + eh->e_shoff);
+    const Elf64_Shdr *symtab = NULL;
+    for(int i = 0; i < eh->e_shnum; i ++) {
+        if(sh[i].sh_type == SHT_SYMTAB) symtab = &sh[i];
+        else if(sh[i].sh_type == SHT_DYNSYM && !symtab) symtab = &sh[i];
+    }
+    if(!symtab || symtab->sh_link >= eh->e_shnum) return;
+    const Elf64_Shdr *strtab = &sh[symtab->sh_link];
+    if(symtab->sh_offset + symtab->sh_size > size || strtab->sh_offset + strtab->sh_size > size) return;
+
+    const Elf64_Sym *syms = (const Elf64_Sym *)(base + symtab->sh_offset);
+    size_t nsyms = symtab->sh_size / sizeof(Elf64_Sym);
+    const char *strs = (const char *)(base + strtab->sh_offset);
+
+    m->syms = malloc(nsyms * sizeof(elf_sym_t));
+    if(!m->syms) return;
+    for(size_t i = 0; i < nsyms; i ++) {
+        if(ELF64_ST_TYPE(syms[i].st_info) != STT_FUNC || syms[i].st_value == 0) continue;
+        if(syms[i].st_name >= strtab->sh_size) continue;
+        elf_sym_t *sym = &m->syms[m->sym_count ++];
+        sym->addr = syms[i].st_value;
+        sym->size = syms[i].st_size;
+        sym->name = strs + syms[i].st_name;
+    }
+    qsort(m->syms, m->sym_count, sizeof(elf_sym_t), compare_syms);
 }
 
-syscall_stat_t *find_or_create_syscall(const char *name) {
-    for(int i = 0; i < syscall_count; i ++) {
-        if(strcmp(syscalls[i].name, name) == 0) {
-            return &syscalls[i];
+// 一帧 -> 函数名；没有符号时为 [模块名+0x偏移]
+static void symbolize_frame(const stack_frame_t *frame, char *buf, size_t size) {
+    if(frame->module < 0) {
+        snprintf(buf, size, "[unknown 0x%llx]", (unsigned long long)frame->offset);
+        return;
+    }
+
+    module_t *m = &modules[frame->module];
+    if(!m->loaded) load_module(m);
+
+    // 文件偏移 -> 虚拟地址
+    int found = 0;
+    uint64_t vaddr = 0;
+    for(int i = 0; i < m->load_count && !found; i ++) {
+        if(frame->offset >= m->load_offset[i] && frame->offset < m->load_offset[i] + m->load_size[i]) {
+            vaddr = frame->offset - m->load_offset[i] + m->load_vaddr[i];
+            found = 1;
         }
     }
 
-    if(syscall_count < MAX_SYSCALLS) {
-        strncpy(syscalls[syscall_count].name, name, 63);
-        syscalls[syscall_count].name[63] = '\0';
-        syscalls[syscall_count].count = 0;
-        syscalls[syscall_count].total_time = 0.0;
-        return &syscalls[syscall_count++];
+    if(found && m->sym_count > 0) {
+        int lo = 0, hi = m->sym_count - 1, best = -1;
+        while(lo <= hi) {
+            int mid = (lo + hi) / 2;
+            if(m->syms[mid].addr <= vaddr) {
+                best = mid;
+                lo = mid + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        if(best >= 0 && (m->syms[best].size == 0 || vaddr < m->syms[best].addr + m->syms[best].size)) {
+            snprintf(buf, size, "%s", m->syms[best].name);
+            return;
+        }
     }
-    return NULL;
+
+    const char *name = strrchr(m->path, '/');
+    snprintf(buf, size, "[%s+0x%llx]", name ? name + 1 : m->path, (unsigned long long)frame->offset);
 }
 
-static int compare_syscalls(const void *a, const void *b) {
-    syscall_stat_t *sa = (syscall_stat_t*)a;
-    syscall_stat_t *sb = (syscall_stat_t*)b;
+static int compare_stacks(const void *a, const void *b) {
+    uint64_t va = (*(stack_stat_t *const *)a)->total_ns;
+    uint64_t vb = (*(stack_stat_t *const *)b)->total_ns;
 
-    if(sb->total_time > sa->total_time) return -1;
-    else if(sb->total_time < sa->total_time) return 1;
+    if(va > vb) return -1;
+    else if(va < vb) return 1;
     else return 0;
-    
+}
+
+/**
+ * 输出调用栈：耗时最多的几个栈打印到报告里，全部栈按折叠格式写入文件
+ * 折叠格式每行 "进程名;最外层;...;最内层;系统调用 微秒数"，可直接交给 flamegraph.pl 等工具
+ */
+static void print_stack_report() {
+    if(!stack_output || stack_count == 0) return;
+
+    stack_stat_t **order = malloc(stack_count * sizeof(*order));
+    if(!order) return;
+    memcpy(order, stacks, stack_count * sizeof(*order));
+    qsort(order, stack_count, sizeof(*order), compare_stacks);
+
+    char name[256], fallback[32];
+    printf("Top syscall stacks (innermost first):\n");
+    printf("--------------------------------------------------------------------------------------------------------------------------\n");
+    int display_count = stack_count < TOP_STACK_COUNT ? stack_count : TOP_STACK_COUNT;
+    for(int i = 0; i < display_count; i ++) {
+        const stack_stat_t *st = order[i];
+        printf("%-20s %12.6f s %10llu calls  [%s]\n    ",
+            syscall_label(st->nr, fallback, sizeof(fallback)),
+            st->total_ns / 1e9, (unsigned long long)st->count, st->comm);
+        int frames = st->depth < TOP_STACK_FRAMES ? st->depth : TOP_STACK_FRAMES;
+        for(int f = 0; f < frames; f ++) {
+            symbolize_frame(&st->frames[f], name, sizeof(name));
+            printf("%s%s", f ? " <- " : "", name);
+        }
+        printf("%s\n", st->depth > frames ? " <- ..." : "");
+    }
+    printf("--------------------------------------------------------------------------------------------------------------------------\n");
+
+    FILE *fp = fopen(stack_output, "w");
+    if(!fp) {
+        fprintf(stderr, "Cannot write %s: %s\n", stack_output, strerror(errno));
+        free(order);
+        return;
+    }
+    for(int i = 0; i < stack_count; i ++) {
+        const stack_stat_t *st = order[i];
+        uint64_t value_us = (st->total_ns + 500) / 1000;
+        if(value_us == 0) value_us = 1;
+
+        fprintf(fp, "%s", st->comm);
+        for(int f = st->depth - 1; f >= 0; f --) {
+            symbolize_frame(&st->frames[f], name, sizeof(name));
+            fprintf(fp, ";%s", name);
+        }
+        fprintf(fp, ";%s %llu\n", syscall_label(st->nr, fallback, sizeof(fallback)), (unsigned long long)value_us);
+    }
+    fclose(fp);
+    printf("Folded stacks written to %s (%d stacks, values in microseconds)\n", stack_output, stack_count);
+    free(order);
 }
 
 void print_report(int is_final) {
     if(syscall_count == 0) return ;
 
-    qsort(syscalls, syscall_count, sizeof(syscall_stat_t), compare_syscalls);
+    // 在快照上选出要显示的行，不改动聚合数组
+    // 百分位只为参与排序或要显示的行计算
+    static report_row_t rows[MAX_SYSCALLS + 1];
+    uint64_t total_ns = 0;
+    unsigned long long total_calls = 0;
+    for(int i = 0; i < syscall_count; i ++) {
+        report_row_t *row = &rows[i];
+        row->st = &syscalls[active_syscalls[i]];
+        if(sort_key == SORT_P99) row->pct_ns[PCT_P99] = hist_percentile(row->st, percentiles[PCT_P99]);
+        row->key = sort_value(row);
+        total_ns += row->st->total_ns;
+        total_calls += row->st->count;
+    }
 
-    // 计算总时间
-    double total_time = 0.0;
-    for(int i = 0; i < syscall_count; i ++) total_time += syscalls[i].total_time;
+    int display_count = syscall_count;
+    if(!is_final && display_count > LIVE_DISPLAY_COUNT) display_count = LIVE_DISPLAY_COUNT;
+    select_top_rows(rows, syscall_count, display_count);
+    for(int i = 0; i < display_count; i ++) {
+        for(int p = 0; p < PCT_COUNT; p ++) {
+            rows[i].pct_ns[p] = hist_percentile(rows[i].st, percentiles[p]);
+        }
+    }
 
     // 清屏并输出表头
     if (!is_final) {
@@ -106,134 +1622,1003 @@ void print_report(int is_final) {
         printf("\n");
     }
     
-    printf("================================================================================\n");
+    printf("==========================================================================================================================\n");
     if (is_final) {
-        printf("                         Final Performance Report\n");
+        printf("                                              Final Performance Report\n");
     } else {
-        printf("                      Real-time Performance Report\n");
+        printf("                                           Real-time Performance Report\n");
+    }
+    printf("==========================================================================================================================\n");
+
+    // 采样时 Count、Time 为放大后的估计值，±95% 为时间估计的置信区间；延迟分布来自样本本身，不放大
+    double scale = sample_scale(get_time_ns());
+    if(sample_period_ns) {
+        printf("Sampling %.0fms of every %.0fms, %d full windows, %.1f%% of run traced; Count and Time scaled x%.2f\n",
+            sample_window_ns / 1e6, sample_period_ns / 1e6, window_count, 100.0 / scale, scale);
     }
-    printf("================================================================================\n");
-    printf("%-20s %10s %12s %10s\n", "Syscall", "Count", "Time(s)", "Percentage");
-    printf("--------------------------------------------------------------------------------\n");
+    printf("%-20s %10s %12s %8s %10s %10s %10s %10s %10s %10s %10s%s\n",
+        "Syscall", "Count", "Time(s)", "Pct", "Avg(us)", "Min(us)", "p50", "p90", "p99", "p99.9", "Max(us)",
+        sample_period_ns ? "    ±95%" : "");
+    printf("--------------------------------------------------------------------------------------------------------------------------\n");
 
-    // 输出数据
-    int display_count = syscall_count >= 10 ? 10 : syscall_count;
+    // 输出数据（实时报告只显示前几项）
     for(int i = 0; i < display_count; i ++) {
-        double percentage = (total_time > 0) ? (syscalls[i].total_time / total_time * 100) : 0;
-        printf("%-20s %10d %12.6f %9.2f%%\n",
-            syscalls[i].name,
-            syscalls[i].count,
-            syscalls[i].total_time,
-            percentage
+        const report_row_t *row = &rows[i];
+        const syscall_stat_t *st = row->st;
+        double percentage = (total_ns > 0) ? ((double)st->total_ns / total_ns * 100) : 0;
+        printf("%-20s %10llu %12.6f %7.2f%% %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f",
+            st->name,
+            (unsigned long long)(st->count * scale + 0.5),
+            st->total_ns * scale / 1e9,
+            percentage,
+            st->count ? us(st->total_ns) / st->count : 0.0,
+            st->count ? us(st->min_ns) : 0.0,
+            us(row->pct_ns[PCT_P50]),
+            us(row->pct_ns[PCT_P90]),
+            us(row->pct_ns[PCT_P99]),
+            us(row->pct_ns[PCT_P999]),
+            us(st->max_ns)
         );
+        if(sample_period_ns) {
+            double ci = sample_ci95(st);
+            if(ci >= 0.0) printf(" %6.1f%%", ci);
+            else printf(" %7s", "n/a");
+        }
+        printf("\n");
+    }
+
+    printf("--------------------------------------------------------------------------------------------------------------------------\n");
+    printf("Total Time: %.6f seconds\n", total_ns * scale / 1e9);
+    printf("Total Syscalls: %d types, %llu calls\n", syscall_count, (unsigned long long)(total_calls * scale + 0.5));
+    if(sample_period_ns && (is_final || task_count > 1)) {
+        printf("(file, process and thread tables below show sampled values, not scaled)\n");
     }
+    printf("==========================================================================================================================\n");
 
-    printf("--------------------------------------------------------------------------------\n");
-    printf("Total Time: %.6f seconds\n", total_time);
-    printf("Total Syscalls: %d types, ", syscall_count);
+    if(is_final) {
+        print_file_report();
+        print_stack_report();
+    }
 
-    int total_calls = 0;
-    for(int i = 0; i < syscall_count; i ++) total_calls += syscalls[i].count;
-    printf("%d calls\n", total_calls);
-    printf("================================================================================\n");
+    // 多任务时按进程（仅最终报告）和线程分解
+    if(task_count > 1) {
+        if(is_final) print_process_report(total_ns);
+        print_thread_report(is_final, total_ns);
+    }
 
     if(!is_final) {
         fflush(stdout);
     }
 }
 
-int main(int argc, char *argv[]) {
-    if(argc < 2) {
-        fprintf(stderr, "Usage: %s <command> [args...]\n", argv[0]);
-        fprintf(stderr, "Example: %s ls -l\n", argv[0]);
+// 在系统调用出口结算一次调用（全局按系统调用统计，同时计入所属任务），均为按号直接索引
+static void record_syscall(trace_task_t *task, long nr, uint64_t elapsed_ns) {
+    syscall_stat_t *stat = get_syscall_stat(nr);
+    stat->count ++;
+    stat->total_ns += elapsed_ns;
+    if(elapsed_ns < stat->min_ns) stat->min_ns = elapsed_ns;
+    if(elapsed_ns > stat->max_ns) stat->max_ns = elapsed_ns;
+    stat->hist[hist_bucket(elapsed_ns)] ++;
+    stat->win_ns += elapsed_ns;
+
+    task->count ++;
+    task->total_ns += elapsed_ns;
+    if(nr >= 0 && (unsigned long)nr < NUM_SYSCALL_NAMES) {
+        task->per_nr[nr].count ++;
+        task->per_nr[nr].total_ns += elapsed_ns;
+    }
+}
+
+// 处理一次系统调用停止（入口打时间戳，出口累计耗时）
+static void handle_syscall_stop(trace_task_t *task) {
+    long nr = -1, ret = 0;
+    uint64_t now_ns = get_time_ns();
+
+    switch(get_syscall_stop(task, &nr, &ret)) {
+    case SYSCALL_STOP_ENTRY:
+        if(!sampling_on) break;             // 窗口外：随后以 PTRACE_CONT 放行，不会有出口停止
+        task->in_syscall = 1;
+        task->nr = nr;
+        task->entry_ns = now_ns;
+        if(stack_output) task->stack = capture_stack(task, nr);
+        break;
+    case SYSCALL_STOP_EXIT:
+        if(task->in_syscall) {
+            record_syscall(task, task->nr, now_ns - task->entry_ns);
+            account_fd(task, task->nr, ret, now_ns - task->entry_ns);
+            if(trace_writer) record_syscall_event(task, task->nr, ret, now_ns - task->entry_ns);
+            if(task->stack) {
+                task->stack->count ++;
+                task->stack->total_ns += now_ns - task->entry_ns;
+            }
+            if(stack_output && (task->nr == SYS_mmap || task->nr == SYS_mprotect) && (task->args[2] & PROT_EXEC)) {
+                invalidate_proc_maps(task->tgid);
+            }
+        }
+        task->stack = NULL;
+        task->in_syscall = 0;
+        break;
+    default:
+        break;
+    }
+
+    double now = now_ns / 1e9;
+    if(now - last_report_time >= REPORT_INTERVAL) {
+        print_report(0);
+        last_report_time = now;
+    }
+}
+
+// fork/clone 事件中新任务的父进程：CLONE_THREAD / CLONE_PARENT 继承调用者的父进程，否则为调用者所属进程
+static pid_t event_parent(const trace_task_t *task) {
+    uint64_t flags = 0;
+    if(task->in_syscall && task->nr == SYS_clone) {
+        flags = task->args[0];
+#ifdef SYS_clone3
+    } else if(task->in_syscall && task->nr == SYS_clone3) {
+        // clone_args 的第一个字段是 flags
+        if(read_task_memory(task->pid, task->args[0], &flags, sizeof(flags)) != 0) flags = 0;
+#endif
+    }
+    return (flags & (CLONE_THREAD | CLONE_PARENT)) ? task->ppid : task->tgid;
+}
+
+// 处理 PTRACE_EVENT_* 停止
+static void handle_event(trace_task_t *task, pid_t tid, int event) {
+    unsigned long msg = 0;
+
+    switch(event) {
+    case PTRACE_EVENT_FORK:
+    case PTRACE_EVENT_VFORK:
+    case PTRACE_EVENT_CLONE:
+        // 新任务已被自动附加；它的初始停止可能已先于本事件报告过
+        if(ptrace(PTRACE_GETEVENTMSG, tid, NULL, &msg) == 0) {
+            trace_task_t *child = find_task((pid_t)msg);
+            if(!child) {
+                child = alloc_task((pid_t)msg);
+                if(!child) break;
+                read_task_info(child, 1);
+                if(task) child->ppid = event_parent(task);
+                record_task_info(child);
+            } else if(task && child->ppid != event_parent(task)) {
+                child->ppid = event_parent(task);
+                record_task_info(child);
+            }
+        }
+        break;
+    case PTRACE_EVENT_EXEC:
+        // 非主线程 exec 后以进程号继续运行，原 TID 不会再报告退出
+        if(ptrace(PTRACE_GETEVENTMSG, tid, NULL, &msg) == 0 && (pid_t)msg != tid) {
+            trace_task_t *former = find_task((pid_t)msg);
+            if(former) {
+                if(task) {
+                    task->in_syscall = former->in_syscall;
+                    task->nr = former->nr;
+                    task->entry_ns = former->entry_ns;
+                }
+                remove_task(former);
+            }
+        }
+        if(task) {
+            read_task_info(task, 0);        // exec 后名字改变，父进程保持 fork 时记录的值
+            record_task_info(task);
+            forget_process_fds(task->tgid);
+            forget_proc_maps(task->tgid);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static int is_stop_signal(int sig) {
+    return sig == SIGSTOP || sig == SIGTSTP || sig == SIGTTIN || sig == SIGTTOU;
+}
+
+// 跟踪选项：附加模式总是跟踪新线程，且不能设 EXITKILL（sperf 异常退出时不能连累目标进程）
+static long trace_options() {
+    long options = PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEEXEC;
+    if(!attach_mode) options |= PTRACE_O_EXITKILL;
+    if(attach_mode || follow_forks) options |= PTRACE_O_TRACECLONE;
+    if(follow_forks) options |= PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK;
+    return options;
+}
+
+/**
+ * 附加到运行中进程的全部线程
+ * PTRACE_SEIZE 不会停止目标，随后 PTRACE_INTERRUPT 让各线程进入首次停止（PTRACE_EVENT_STOP），
+ * 在主循环中从那里开始系统调用跟踪；扫描期间可能有新线程创建，重复扫描 /proc/PID/task 直到没有新线程
+ * 返回附加的线程数，失败返回 -1
+ */
+static int attach_process(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+
+    int attached = 0;
+    int found_new;
+    do {
+        found_new = 0;
+        DIR *dir = opendir(path);
+        if(!dir) {
+            if(attached) break;             // 进程在附加过程中退出
+            fprintf(stderr, "Cannot attach to %d: %s\n", pid, strerror(errno));
+            return -1;
+        }
+
+        struct dirent *ent;
+        while((ent = readdir(dir)) != NULL) {
+            pid_t tid = (pid_t)atoi(ent->d_name);
+            if(tid <= 0 || find_task(tid)) continue;
+
+            if(ptrace(PTRACE_SEIZE, tid, NULL, (void *)trace_options()) == -1) {
+                if(errno == ESRCH) continue;    // 线程刚好退出
+                fprintf(stderr, "Cannot attach to %d: %s\n", tid, strerror(errno));
+                if(!attached) {
+                    closedir(dir);
+                    return -1;
+                }
+                continue;
+            }
+            add_task(tid, 0);
+            ptrace(PTRACE_INTERRUPT, tid, NULL, NULL);
+            attached ++;
+            found_new = 1;
+        }
+        closedir(dir);
+    } while(found_new);
+
+    return attached;
+}
+
+// 中断全部存活任务，使其尽快进入一次 PTRACE_EVENT_STOP
+static void interrupt_tasks() {
+    for(int i = 0; i < task_count; i ++) {
+        if(!tasks[i]->exited) ptrace(PTRACE_INTERRUPT, tasks[i]->pid, NULL, NULL);
+    }
+}
+
+/**
+ * 采样窗口结束：累计采样时长；complete 为真时把各系统调用本窗口的时间并入样本和（用于估计置信区间），
+ * 跟踪结束时未满的窗口只计入采样时长
+ * 跨越窗口边界的系统调用只把窗口内的部分计入时间（不计次数和延迟分布），其出口不再结算；
+ * 下个窗口打开时 PTRACE_INTERRUPT 会让阻塞的调用重启，从那里重新计时
+ */
+static void close_sample_window(uint64_t now_ns, int complete) {
+    for(int i = 0; i < task_count; i ++) {
+        trace_task_t *task = tasks[i];
+        if(task->exited || !task->in_syscall) continue;
+
+        uint64_t elapsed_ns = now_ns - task->entry_ns;
+        syscall_stat_t *stat = get_syscall_stat(task->nr);
+        stat->total_ns += elapsed_ns;
+        stat->win_ns += elapsed_ns;
+        task->total_ns += elapsed_ns;
+        if(task->nr >= 0 && (unsigned long)task->nr < NUM_SYSCALL_NAMES) {
+            task->per_nr[task->nr].total_ns += elapsed_ns;
+        }
+        if(task->stack) task->stack->total_ns += elapsed_ns;
+        task->stack = NULL;
+        task->in_syscall = 0;
+    }
+
+    sampled_ns += now_ns - window_start_ns;
+    if(complete) window_count ++;
+    for(int i = 0; i < syscall_count; i ++) {
+        syscall_stat_t *st = &syscalls[active_syscalls[i]];
+        if(complete) {
+            st->sum_win_ns += st->win_ns;
+            st->sumsq_win_ns += (double)st->win_ns * (double)st->win_ns;
+        }
+        st->win_ns = 0;
+    }
+}
+
+/**
+ * --stats：每个间隔输出一行 NDJSON，给出该间隔内各系统调用的次数和耗时增量
+ * 采样时为窗口内的原始值（不放大），traced_ns 为该间隔内实际跟踪的时间
+ */
+static void emit_stats(uint64_t now_ns) {
+    uint64_t calls = 0, time_ns = 0;
+    for(int i = 0; i < syscall_count; i ++) {
+        int index = active_syscalls[i];
+        calls += syscalls[index].count - stats_prev_count[index];
+        time_ns += syscalls[index].total_ns - stats_prev_ns[index];
+    }
+
+    int live = 0;
+    for(int i = 0; i < task_count; i ++) {
+        if(!tasks[i]->exited) live ++;
+    }
+
+    fprintf(stats_fp, "{\"t\":%.3f,\"interval\":%.3f,\"tasks\":%d,\"calls\":%llu,\"time_ns\":%llu",
+        (now_ns - trace_start_ns) / 1e9, (now_ns - last_stats_ns) / 1e9, live,
+        (unsigned long long)calls, (unsigned long long)time_ns);
+    if(sample_period_ns) {
+        uint64_t traced_ns = sampled_ns + (sampling_on ? now_ns - window_start_ns : 0);
+        fprintf(stats_fp, ",\"traced_ns\":%llu", (unsigned long long)(traced_ns - stats_prev_traced_ns));
+        stats_prev_traced_ns = traced_ns;
+    }
+    fprintf(stats_fp, ",\"syscalls\":{");
+
+    int first = 1;
+    for(int i = 0; i < syscall_count; i ++) {
+        int index = active_syscalls[i];
+        const syscall_stat_t *st = &syscalls[index];
+        uint64_t count = st->count - stats_prev_count[index];
+        uint64_t ns = st->total_ns - stats_prev_ns[index];
+        if(count == 0 && ns == 0) continue;
+        fprintf(stats_fp, "%s\"%s\":{\"count\":%llu,\"time_ns\":%llu}", first ? "" : ",",
+            st->name, (unsigned long long)count, (unsigned long long)ns);
+        stats_prev_count[index] = st->count;
+        stats_prev_ns[index] = st->total_ns;
+        first = 0;
+    }
+    fprintf(stats_fp, "}}\n");
+    fflush(stats_fp);                       // 每行立即可见，便于 tail -f 或仪表盘读取
+    last_stats_ns = now_ns;
+}
+
+/**
+ * 处理定时事件（-d 到时、统计间隔、采样窗口切换），在每次 waitpid 前调用
+ * 窗口关闭后任务在下一次停止时改用 PTRACE_CONT 放行，不再产生系统调用停止；
+ * 窗口打开时中断全部任务，让它们在下一次停止时恢复 PTRACE_SYSCALL
+ */
+static void check_timers() {
+    if(!duration_ns && !sample_period_ns && !stats_fp) return;
+
+    uint64_t now_ns = get_time_ns();
+    if(duration_ns && now_ns - trace_start_ns >= duration_ns) stop_requested = 1;
+    if(stats_fp && now_ns >= next_stats_ns) {
+        emit_stats(now_ns);
+        next_stats_ns += stats_interval_ns;
+        if(next_stats_ns <= now_ns) next_stats_ns = now_ns + stats_interval_ns;
+    }
+    if(!sample_period_ns || now_ns < next_switch_ns) return;
+
+    if(sampling_on) {
+        close_sample_window(now_ns, 1);
+        sampling_on = 0;
+        next_switch_ns = window_start_ns + sample_period_ns;
+        if(next_switch_ns <= now_ns) next_switch_ns = now_ns + (sample_period_ns - sample_window_ns);
+    } else {
+        sampling_on = 1;
+        window_start_ns = now_ns;
+        next_switch_ns = now_ns + sample_window_ns;
+        forget_all_fds();
+        interrupt_tasks();
+    }
+}
+
+/**
+ * 结束跟踪：附加模式下中断所有线程，在各自下一次停止时分离，目标继续运行；
+ * 启动模式下结束全部被跟踪进程（跟踪到的子进程不一定会收到终端信号）
+ */
+static void stop_tracing() {
+    if(attach_mode) {
+        interrupt_tasks();
+        return;
+    }
+    for(int i = 0; i < task_count; i ++) {
+        if(!tasks[i]->exited && tasks[i]->pid == tasks[i]->tgid) {
+            kill(tasks[i]->pid, SIGTERM);
+        }
+    }
+}
+
+/**
+ * 跟踪主循环
+ * 所有任务都以 PTRACE_SEIZE 附加，由 PTRACE_INTERRUPT（或启动时的组停止）进入首次停止；pid 为启动的子进程（附加模式为 -1）
+ * 每个系统调用停两次（入口、出口），循环内只做时间戳和计数，不产生文本；采样窗口之外用 PTRACE_CONT 放行
+ * 被跟踪任务用 waitpid(-1, __WALL) 统一等待，全部退出或分离后返回；返回值为启动的子进程的 wait 状态
+ */
+static int trace_loop(pid_t pid) {
+    int status = 0, main_status = 0;
+    int detaching = 0;
+    pid_t tid = -1;
+    int sig = 0;
+    while(1) {
+        if(tid > 0) {
+            int request = sampling_on ? PTRACE_SYSCALL : PTRACE_CONT;
+            if(ptrace(request, tid, NULL, (void *)(long)sig) == -1 && errno != ESRCH) {
+                perror("ptrace(PTRACE_SYSCALL)");
+            }
+        }
+        sig = 0;
+
+        do {
+            check_timers();
+            if(stop_requested && !detaching) {
+                stop_tracing();
+                detaching = 1;
+            }
+            tid = waitpid(-1, &status, __WALL);
+        } while(tid == -1 && errno == EINTR);
+        if(tid == -1) {
+            if(errno != ECHILD) perror("waitpid");
+            break;                          // 没有被跟踪的任务了
+        }
+
+        trace_task_t *task = find_task(tid);
+        if(WIFEXITED(status) || WIFSIGNALED(status)) {
+            if(task) {
+                task->exit_status = status;
+                if(task->pid == task->tgid) {
+                    forget_process_fds(task->tgid);
+                    forget_proc_maps(task->tgid);
+                }
+                remove_task(task);
+            }
+            if(tid == pid) main_status = status;
+            tid = -1;
+            continue;
+        }
+        if(!WIFSTOPPED(status)) {
+            tid = -1;
+            continue;
+        }
+
+        if(!task) {
+            // 自动附加的新任务，其首次停止先于父任务的 fork/clone 事件到达
+            task = add_task(tid, 0);
+        }
+
+        int stopsig = WSTOPSIG(status);
+        int event = status >> 16;
+        if(stopsig == (SIGTRAP | 0x80)) {
+            if(task) handle_syscall_stop(task);
+        } else if(event == PTRACE_EVENT_STOP) {
+            // PTRACE_SEIZE 语义下的停止：首次停止（含自动附加的新任务）、PTRACE_INTERRUPT 或组停止
+            if(task && !task->attached) {
+                task->attached = 1;
+            } else if(is_stop_signal(stopsig) && !detaching) {
+                // 组停止：用 PTRACE_LISTEN 让目标保持停止，又能继续报告事件
+                ptrace(PTRACE_LISTEN, tid, NULL, NULL);
+                tid = -1;
+                continue;
+            }
+        } else if(event) {
+            // PTRACE_EVENT_* 事件停止：不转发信号
+            // exec 成功后 execve 的出口仍会报告
+            handle_event(task, tid, event);
+        } else {
+            // 普通信号：原样转发给被跟踪任务
+            sig = stopsig;
+        }
+
+        if(detaching && attach_mode) {
+            // 在任意停止处分离，待递送的信号一并交还
+            ptrace(PTRACE_DETACH, tid, NULL, (void *)(long)sig);
+            if(task) {
+                task->detached = 1;
+                remove_task(task);
+            }
+            tid = -1;
+        }
+    }
+    return main_status;
+}
+
+/**
+ * sperf report：离线重新聚合 -o 记录的文件
+ * 文件整体 mmap，记录区按记录边界切成若干块，每块一个线程在私有表中聚合，最后按块合并到全局表，
+ * 再复用实时跟踪的 print_report 输出（文件与调用栈表需要跟踪时的 /proc 信息，离线不可用）
+ */
+typedef struct report_task {
+    pid_t tid, tgid, ppid;
+    char comm[16];
+    int has_info;               // 块内见过任务记录；记录按写出顺序排列，靠后的信息更新
+    uint64_t count, total_ns;
+    task_syscall_t *per_nr;
+    struct report_task *hnext;
+} report_task_t;
+
+typedef struct {
+    const trace_record_t *records;
+    size_t count;
+    syscall_stat_t *stats;      // 长度 MAX_SYSCALLS + 1，下标同全局 syscalls
+    report_task_t **hash;
+    report_task_t **list;
+    int task_count, task_capacity;
+    int error;
+} report_chunk_t;
+
+static report_task_t *chunk_task(report_chunk_t *chunk, pid_t tid) {
+    unsigned h = (unsigned)tid % TASK_HASH_SIZE;
+    for(report_task_t *t = chunk->hash[h]; t; t = t->hnext) {
+        if(t->tid == tid) return t;
+    }
+
+    if(chunk->task_count == chunk->task_capacity) {
+        int capacity = chunk->task_capacity ? chunk->task_capacity * 2 : 64;
+        report_task_t **grown = realloc(chunk->list, capacity * sizeof(*grown));
+        if(!grown) return NULL;
+        chunk->list = grown;
+        chunk->task_capacity = capacity;
+    }
+    report_task_t *t = calloc(1, sizeof(*t));
+    if(!t) return NULL;
+    t->per_nr = calloc(NUM_SYSCALL_NAMES, sizeof(task_syscall_t));
+    if(!t->per_nr) {
+        free(t);
+        return NULL;
+    }
+    t->tid = tid;
+    t->tgid = tid;
+    t->hnext = chunk->hash[h];
+    chunk->hash[h] = t;
+    chunk->list[chunk->task_count ++] = t;
+    return t;
+}
+
+static void *report_chunk_main(void *arg) {
+    report_chunk_t *chunk = arg;
+    for(size_t i = 0; i < chunk->count; i ++) {
+        const trace_record_t *rec = &chunk->records[i];
+        report_task_t *t = chunk_task(chunk, rec->tid);
+        if(!t) {
+            chunk->error = ENOMEM;
+            return NULL;
+        }
+
+        if(rec->type == TRACE_REC_TASK) {
+            t->has_info = 1;
+            t->tgid = rec->tgid;
+            t->ppid = rec->nr;
+            memcpy(t->comm, rec->comm, sizeof(t->comm));
+            t->comm[sizeof(t->comm) - 1] = '\0';
+            continue;
+        }
+        if(rec->type != TRACE_REC_SYSCALL) continue;
+
+        long nr = rec->nr;
+        uint64_t elapsed_ns = rec->sys.dur_ns;
+        syscall_stat_t *st = &chunk->stats[(nr >= 0 && nr < MAX_SYSCALLS) ? nr : MAX_SYSCALLS];
+        if(st->count == 0) st->min_ns = UINT64_MAX;
+        st->count ++;
+        st->total_ns += elapsed_ns;
+        if(elapsed_ns < st->min_ns) st->min_ns = elapsed_ns;
+        if(elapsed_ns > st->max_ns) st->max_ns = elapsed_ns;
+        st->hist[hist_bucket(elapsed_ns)] ++;
+
+        if(!t->has_info) t->tgid = rec->tgid;
+        t->count ++;
+        t->total_ns += elapsed_ns;
+        if(nr >= 0 && (unsigned long)nr < NUM_SYSCALL_NAMES) {
+            t->per_nr[nr].count ++;
+            t->per_nr[nr].total_ns += elapsed_ns;
+        }
+    }
+    return NULL;
+}
+
+// 把一块的聚合结果并入全局系统调用表和任务表；按块顺序调用，后面块的任务信息覆盖前面的
+static int merge_report_chunk(const report_chunk_t *chunk) {
+    for(int nr = 0; nr <= MAX_SYSCALLS; nr ++) {
+        const syscall_stat_t *src = &chunk->stats[nr];
+        if(src->count == 0) continue;
+        syscall_stat_t *st = get_syscall_stat(nr == MAX_SYSCALLS ? -1 : nr);
+        st->count += src->count;
+        st->total_ns += src->total_ns;
+        if(src->min_ns < st->min_ns) st->min_ns = src->min_ns;
+        if(src->max_ns > st->max_ns) st->max_ns = src->max_ns;
+        for(int b = 0; b < HIST_BUCKETS; b ++) st->hist[b] += src->hist[b];
+    }
+
+    for(int i = 0; i < chunk->task_count; i ++) {
+        const report_task_t *t = chunk->list[i];
+        trace_task_t *task = find_task(t->tid);
+        if(!task) {
+            task = alloc_task(t->tid);
+            if(!task) return -1;
+            task->exited = 1;
+            task->tgid = t->tgid;
+            snprintf(task->comm, sizeof(task->comm), "?");
+        }
+        if(t->has_info) {
+            task->tgid = t->tgid;
+            task->ppid = t->ppid;
+            memcpy(task->comm, t->comm, sizeof(task->comm));
+        }
+        task->count += t->count;
+        task->total_ns += t->total_ns;
+        for(unsigned long nr = 0; nr < NUM_SYSCALL_NAMES; nr ++) {
+            task->per_nr[nr].count += t->per_nr[nr].count;
+            task->per_nr[nr].total_ns += t->per_nr[nr].total_ns;
+        }
+    }
+    return 0;
+}
+
+static void free_report_chunk(report_chunk_t *chunk) {
+    for(int i = 0; i < chunk->task_count; i ++) {
+        free(chunk->list[i]->per_nr);
+        free(chunk->list[i]);
+    }
+    free(chunk->list);
+    free(chunk->hash);
+    free(chunk->stats);
+}
+
+static int report_main(int argc, char *argv[]) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    char *end;
+    int opt;
+    optind = 1;
+    while((opt = getopt(argc, argv, "s:j:h")) != -1) {
+        switch(opt) {
+        case 's':
+            if(parse_sort_key(optarg, &sort_key) != 0) {
+                fprintf(stderr, "Unknown sort key: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'j':
+            threads = strtol(optarg, &end, 10);
+            if(*end != '\0' || threads <= 0) {
+                fprintf(stderr, "Invalid thread count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            fprintf(stderr, "Usage: sperf report [-s KEY] [-j THREADS] FILE\n");
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if(optind != argc - 1) {
+        fprintf(stderr, "Usage: sperf report [-s KEY] [-j THREADS] FILE\n");
+        return 1;
+    }
+    const char *path = argv[optind];
+
+    int fd = open(path, O_RDONLY);
+    struct stat sb;
+    if(fd == -1 || fstat(fd, &sb) == -1) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    if((size_t)sb.st_size < sizeof(trace_header_t)) {
+        fprintf(stderr, "%s: not a sperf trace file\n", path);
+        close(fd);
+        return 1;
+    }
+    void *map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    const trace_header_t *header = map;
+    if(memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version != TRACE_VERSION || header->record_size != sizeof(trace_record_t)) {
+        fprintf(stderr, "%s: not a sperf trace file (or unsupported version)\n", path);
+        munmap(map, sb.st_size);
+        return 1;
+    }
+    if(header->machine != TRACE_MACHINE) {
+        // 系统调用号因架构而异，按本机的名字表解释会得到错误的名字
+        fprintf(stderr, "%s: recorded on a different architecture (e_machine %u, this build %u); "
+            "report it with sperf built for that architecture\n", path, header->machine, (unsigned)TRACE_MACHINE);
+        munmap(map, sb.st_size);
         return 1;
     }
+    const trace_record_t *records = (const trace_record_t *)(header + 1);
+    size_t record_count = (sb.st_size - sizeof(*header)) / sizeof(trace_record_t);
+    if((sb.st_size - sizeof(*header)) % sizeof(trace_record_t)) {
+        fprintf(stderr, "%s: truncated, ignoring trailing partial record\n", path);
+    }
+    madvise(map, sb.st_size, MADV_SEQUENTIAL);
 
-    gettimeofday(&program_start, NULL);  // 记录程序开始时间
+    // 块数：不超过线程上限，且每块至少一个缓冲区的记录，小文件不值得开线程
+    if(threads > REPORT_MAX_THREADS) threads = REPORT_MAX_THREADS;
+    size_t max_chunks = record_count / TRACE_BUFFER_RECORDS + 1;
+    int nchunks = (size_t)threads < max_chunks ? (int)threads : (int)max_chunks;
 
-    int pipefd[2];
-    if(pipe(pipefd) == -1) {             // 创建进程管道
-        perror("pipe");
+    report_chunk_t chunks[REPORT_MAX_THREADS];
+    pthread_t tids[REPORT_MAX_THREADS];
+    int started[REPORT_MAX_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+    int status = 0;
+    for(int i = 0; i < nchunks; i ++) {
+        size_t first = record_count * i / nchunks;
+        size_t last = record_count * (i + 1) / nchunks;
+        chunks[i].records = records + first;
+        chunks[i].count = last - first;
+        chunks[i].stats = calloc(MAX_SYSCALLS + 1, sizeof(syscall_stat_t));
+        chunks[i].hash = calloc(TASK_HASH_SIZE, sizeof(report_task_t *));
+        started[i] = chunks[i].stats && chunks[i].hash &&
+            pthread_create(&tids[i], NULL, report_chunk_main, &chunks[i]) == 0;
+        if(!started[i]) status = 1;
+    }
+    for(int i = 0; i < nchunks; i ++) {
+        if(started[i]) pthread_join(tids[i], NULL);
+        if(chunks[i].error) status = 1;
+    }
+
+    // 按块顺序合并，结果与单线程顺序解析一致
+    for(int i = 0; i < nchunks && status == 0; i ++) {
+        if(merge_report_chunk(&chunks[i]) != 0) status = 1;
+    }
+    for(int i = 0; i < nchunks; i ++) free_report_chunk(&chunks[i]);
+    time_t started_at = (time_t)(header->start_realtime_ns / 1000000000ull);
+    munmap(map, sb.st_size);
+    if(status != 0) {
+        fprintf(stderr, "Failed to aggregate %s\n", path);
         return 1;
     }
 
-    child_pid = fork();
-    if(child_pid == -1) {
+    char when[64];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&started_at));
+    printf("Trace %s: %zu records, recorded %s, parsed with %d thread%s\n",
+        path, record_count, when, nchunks, nchunks == 1 ? "" : "s");
+    print_report(1);
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <command> [args...]\n", prog);
+    fprintf(stderr, "       %s [options] -p PID [-p PID ...]\n", prog);
+    fprintf(stderr, "       %s report [-s KEY] [-j THREADS] FILE\n", prog);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -p, --pid=PID       attach to a running process (all threads), detach on exit\n");
+    fprintf(stderr, "  -d, --duration=SEC  stop after SEC seconds (default: until interrupted or exited)\n");
+    fprintf(stderr, "  -S, --sample=W/P    trace only a W ms window out of every P ms and scale the\n");
+    fprintf(stderr, "                      estimates up (e.g. 100/1000); tasks run untraced in between\n");
+    fprintf(stderr, "  -g, --stacks=FILE   capture user stacks (frame pointers) at syscall entry and write\n");
+    fprintf(stderr, "                      folded stacks for flame graphs to FILE\n");
+    fprintf(stderr, "  -o, --record=FILE   record every syscall to a binary trace FILE (see 'report')\n");
+    fprintf(stderr, "      --stats=FILE    append per-interval syscall deltas to FILE as NDJSON\n");
+    fprintf(stderr, "      --stats-interval=SEC  interval for --stats (default: 1)\n");
+    fprintf(stderr, "  -f, --follow        also trace forked child processes and threads\n");
+    fprintf(stderr, "  -s, --sort=KEY      sort by total (default), count, avg, p99 or max\n");
+    fprintf(stderr, "  -h, --help          show this help\n");
+    fprintf(stderr, "Example: %s -f --sort=p99 make -j4\n", prog);
+    fprintf(stderr, "         %s -p 1234 -d 10\n", prog);
+    fprintf(stderr, "         %s -p 1234 -S 100/1000\n", prog);
+    fprintf(stderr, "         %s -o trace.bin --stats=stats.ndjson make && %s report trace.bin\n", prog, prog);
+}
+
+/**
+ * 启动模式：fork 出子进程，停在 exec 之前，再像附加模式一样 PTRACE_SEIZE
+ * （采样需要 PTRACE_INTERRUPT，只对 SEIZE 附加的任务有效）
+ * 返回子进程号，失败返回 -1
+ */
+static pid_t start_command(char **command) {
+    pid_t pid = fork();
+    if(pid == -1) {
         perror("fork");
-        return 1;
+        return -1;
     }
 
-    if(child_pid == 0){
+    if(pid == 0) {
         // ========== 子进程 ==========
-        close(pipefd[0]);
+        raise(SIGSTOP);                     // 等父进程附加并设置好跟踪选项
+
+        execvp(command[0], command);
+        perror("execvp");
+        exit(127);
+    }
 
-        // 将 stderr 重定向到管道写端（strace 默认输出到 stderr）
-        dup2(pipefd[1], STDERR_FILENO);
-        close(pipefd[1]);
+    int status;
+    if(waitpid(pid, &status, WUNTRACED) == -1 || !WIFSTOPPED(status) ||
+       ptrace(PTRACE_SEIZE, pid, NULL, (void *)trace_options()) == -1 || !add_task(pid, 0)) {
+        fprintf(stderr, "Failed to start tracing %s: %s\n", command[0], strerror(errno));
+        kill(pid, SIGKILL);
+        return -1;
+    }
+    // 附加到处于组停止的任务会报告一次 PTRACE_EVENT_STOP，从那里开始跟踪；SIGCONT 解除组停止
+    kill(pid, SIGCONT);
+    return pid;
+}
 
-        char** strace_args = malloc(sizeof(char *)*(argc + 2));
-        if(!strace_args) {
-            perror("malloc");
-            exit(1);
+// 附加模式的结束信息：每个 -p 目标是被分离还是自己退出了
+static void print_attach_summary() {
+    printf("\n");
+    for(int i = 0; i < attach_count; i ++) {
+        const trace_task_t *leader = NULL;
+        for(int j = task_count - 1; j >= 0 && !leader; j --) {
+            if(tasks[j]->pid == attach_pids[i]) leader = tasks[j];
         }
-        strace_args[0] = "strace";
-        strace_args[1] = "-T";
+        if(!leader) continue;
 
-        for(int i = 1; i < argc; i ++) {
-            strace_args[i + 1] = argv[i];
+        if(leader->detached || !leader->exited) {
+            printf("Detached from process %d\n", attach_pids[i]);
+        } else if(WIFSIGNALED(leader->exit_status)) {
+            printf("Process %d killed by signal: %d\n", attach_pids[i], WTERMSIG(leader->exit_status));
+        } else {
+            printf("Process %d exited with status: %d\n", attach_pids[i], WEXITSTATUS(leader->exit_status));
         }
-        strace_args[argc + 1] = NULL;
+    }
+}
 
-        extern char **environ;
-        execve("/usr/bin/strace", strace_args, environ);
-        perror("execve strace");
-        exit(1);
-    } else {
-        // ========== 父进程 ==========
-        signal(SIGINT, signal_handler);
-        signal(SIGTERM, signal_handler);
+// 只有长选项的选项
+enum {
+    OPT_STATS = 256,
+    OPT_STATS_INTERVAL,
+};
 
-        close(pipefd[1]);
+int main(int argc, char *argv[]) {
+    if(argc > 1 && strcmp(argv[1], "report") == 0) {
+        return report_main(argc - 1, argv + 1);
+    }
 
-        FILE *fp = fdopen(pipefd[0], "r");
-        if(!fp) {
-            perror("fdopen");
-            close(pipefd[0]);
-            kill(child_pid, SIGTERM);
+    static const struct option long_options[] = {
+        { "pid",      required_argument, NULL, 'p' },
+        { "duration", required_argument, NULL, 'd' },
+        { "sample",   required_argument, NULL, 'S' },
+        { "stacks",   required_argument, NULL, 'g' },
+        { "record",   required_argument, NULL, 'o' },
+        { "stats",    required_argument, NULL, OPT_STATS },
+        { "stats-interval", required_argument, NULL, OPT_STATS_INTERVAL },
+        { "follow",   no_argument,       NULL, 'f' },
+        { "sort",     required_argument, NULL, 's' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL,       0,                 NULL, 0   }
+    };
+
+    double duration = 0.0;
+    const char *record_path = NULL;
+    const char *stats_path = NULL;
+    char *end;
+    int opt;
+    while((opt = getopt_long(argc, argv, "+p:d:S:g:o:fs:h", long_options, NULL)) != -1) {
+        switch(opt) {
+        case 'p': {
+            long pid = strtol(optarg, &end, 10);
+            if(*end != '\0' || pid <= 0) {
+                fprintf(stderr, "Invalid pid: %s\n", optarg);
+                return 1;
+            }
+            if(attach_count == MAX_ATTACH_PIDS) {
+                fprintf(stderr, "Too many -p options (max %d)\n", MAX_ATTACH_PIDS);
+                return 1;
+            }
+            attach_pids[attach_count ++] = (pid_t)pid;
+            attach_mode = 1;
+            break;
+        }
+        case 'd':
+            duration = strtod(optarg, &end);
+            if(*end != '\0' || duration <= 0.0) {
+                fprintf(stderr, "Invalid duration: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'S': {
+            double window_ms = strtod(optarg, &end);
+            double period_ms = (*end == '/') ? strtod(end + 1, &end) : 0.0;
+            if(*end != '\0' || window_ms <= 0.0 || period_ms <= window_ms) {
+                fprintf(stderr, "Invalid sampling spec: %s (expected WINDOW_MS/PERIOD_MS, e.g. 100/1000)\n", optarg);
+                return 1;
+            }
+            sample_window_ns = (uint64_t)(window_ms * 1e6);
+            sample_period_ns = (uint64_t)(period_ms * 1e6);
+            break;
+        }
+        case 'g':
+#ifndef __x86_64__
+            fprintf(stderr, "Stack capture is only supported on x86_64\n");
+            return 1;
+#endif
+            stack_output = optarg;
+            break;
+        case 'o':
+            record_path = optarg;
+            break;
+        case OPT_STATS:
+            stats_path = optarg;
+            break;
+        case OPT_STATS_INTERVAL: {
+            double interval = strtod(optarg, &end);
+            if(*end != '\0' || interval < TIMER_TICK_US / 1e6) {
+                fprintf(stderr, "Invalid stats interval: %s\n", optarg);
+                return 1;
+            }
+            stats_interval_ns = (uint64_t)(interval * 1e9);
+            break;
+        }
+        case 'f':
+            follow_forks = 1;
+            break;
+        case 's':
+            if(parse_sort_key(optarg, &sort_key) != 0) {
+                fprintf(stderr, "Unknown sort key: %s\n", optarg);
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
             return 1;
         }
+    }
 
-        char line[MAX_LINE];
-        char syscall_name[64];
-        double syscall_time;
+    // 要么启动命令，要么附加到 -p 指定的进程
+    if((optind >= argc) == !attach_mode) {
+        usage(argv[0]);
+        return 1;
+    }
+    char **command = &argv[optind];
+
+    if(stats_path) {
+        stats_fp = fopen(stats_path, "w");
+        if(!stats_fp) {
+            fprintf(stderr, "Cannot create %s: %s\n", stats_path, strerror(errno));
+            return 1;
+        }
+    }
+    if(record_path) {
+        trace_writer = trace_writer_open(record_path);
+        if(!trace_writer) return 1;
+    }
 
-        printf("Starting performance monitoring...\n");
-        printf("Press Ctrl+C to stop\n\n");
+    // 不设 SA_RESTART：让 waitpid 被中断，以便结束跟踪
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_handler;
+    sigemptyset(&sa.sa_mask);
 
-        last_report_time = get_current_time();
+    // 记录文件中的时间戳都相对这一时刻，附加和启动时写出的任务记录也用到它
+    trace_start_ns = get_time_ns();
 
-        while (fgets(line, sizeof(line), fp) != NULL) {
-            if(parse_strace_line(line, syscall_name, &syscall_time)) {
-                syscall_stat_t* stat = find_or_create_syscall(syscall_name);
-                if(stat) {
-                    stat->count ++;
-                    stat->total_time += syscall_time;
-                }
+    int status = 0;
+    if(attach_mode) {
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
 
-                double current_time = get_current_time();
-                if(current_time - last_report_time >= REPORT_INTERVAL) {
-                    print_report(0);
-                    last_report_time = current_time;
-                }
-            }
+        int attached = 0;
+        for(int i = 0; i < attach_count; i ++) {
+            if(attach_process(attach_pids[i]) > 0) attached ++;
         }
-        fclose(fp);
+        if(attached == 0) return 1;
+    } else {
+        child_pid = start_command(command);
+        if(child_pid == -1) return 1;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+    }
 
-        int status;
-        waitpid(child_pid, &status, 0);         // 等待子进程结束
-        print_report(1);                        // 输出最终报告
+    window_start_ns = trace_start_ns;
+    next_switch_ns = trace_start_ns + sample_window_ns;
+    duration_ns = (uint64_t)(duration * 1e9);
+    last_stats_ns = trace_start_ns;
+    next_stats_ns = trace_start_ns + stats_interval_ns;
 
+    // 定时节拍：采样窗口之外没有停止，靠 SIGALRM 打断 waitpid 来检查窗口切换和 -d
+    if(duration_ns || sample_period_ns || stats_fp) {
+        struct itimerval timer;
+        memset(&timer, 0, sizeof(timer));
+        timer.it_interval.tv_usec = TIMER_TICK_US;
+        timer.it_value.tv_usec = TIMER_TICK_US;
+        sigaction(SIGALRM, &sa, NULL);
+        setitimer(ITIMER_REAL, &timer, NULL);
+    }
+
+    printf("Starting performance monitoring...\n");
+    printf("Press Ctrl+C to stop\n\n");
+
+    last_report_time = get_current_time();
+    status = trace_loop(attach_mode ? -1 : child_pid);
+    if(sample_period_ns && sampling_on) close_sample_window(get_time_ns(), 0);
+    if(stats_fp) {
+        emit_stats(get_time_ns());          // 最后一个不完整的间隔
+        fclose(stats_fp);
+    }
+    if(trace_writer) {
+        int error = trace_writer_close(trace_writer);
+        if(error) fprintf(stderr, "Error writing %s: %s\n", record_path, strerror(error));
+    }
+    print_report(1);                        // 输出最终报告
+
+    if(attach_mode) {
+        print_attach_summary();
+    } else if(WIFSIGNALED(status)) {
+        printf("\nProgram killed by signal: %d\n", WTERMSIG(status));
+    } else {
         printf("\nProgram exited with status: %d\n", WEXITSTATUS(status));
     }
     return 0;
-}
\ No newline at end of file
+}